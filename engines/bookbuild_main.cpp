@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "fatpup/game_codec.h"
+#include "fatpup/mapped_file.h"
+#include "fatpup/pgn_reader.h"
+#include "fatpup/polyglot.h"
+#include "parallel.h"
+
+namespace
+{
+
+// PGN files are cut into pieces of about this size at game boundaries, every piece is a work item
+constexpr size_t pgnChunkSize = 1 << 20;
+
+// lets PgnReader read a part of a mapped file with no copying
+class MemoryBuffer: public std::streambuf
+{
+public:
+    MemoryBuffer(const unsigned char* data, size_t size)
+    {
+        char* begin = (char*)data;
+        setg(begin, begin, begin + size);
+    }
+};
+
+struct BuildStats
+{
+    unsigned long long games = 0;
+    unsigned long long errors = 0;
+};
+
+struct Options
+{
+    int maxPlies = 20;
+    bool resultWeights = true;
+};
+
+// Polyglot's scheme: 2 for a win, 1 for a draw (or an unknown result), 0 for a loss
+void resultWeights(const std::string& result, bool useResult, unsigned int* whiteWeight, unsigned int* blackWeight)
+{
+    *whiteWeight = 1;
+    *blackWeight = 1;
+    if (!useResult)
+        return;
+
+    if (result == "1-0")
+    {
+        *whiteWeight = 2;
+        *blackWeight = 0;
+    }
+    else if (result == "0-1")
+    {
+        *whiteWeight = 0;
+        *blackWeight = 2;
+    }
+}
+
+// offsets of the PGN pieces: every piece but the first one starts with an "[Event " tag
+std::vector<size_t> splitPgn(const unsigned char* data, size_t size)
+{
+    static const char eventTag[] = "\n[Event ";
+    const size_t tagLength = sizeof(eventTag) - 1;
+
+    std::vector<size_t> offsets(1, 0);
+    size_t offset = pgnChunkSize;
+    while (offset < size)
+    {
+        const unsigned char* found = std::search(data + offset, data + size, eventTag, eventTag + tagLength);
+        if (found == data + size)
+            break;
+
+        offsets.push_back((size_t)(found - data) + 1);
+        offset = offsets.back() + pgnChunkSize;
+    }
+    offsets.push_back(size);
+
+    return offsets;
+}
+
+void processPgn(const fatpup::MappedFile& file, const Options& options, unsigned int numThreads,
+                std::vector<fatpup::PolyglotBookBuilder>* builders, std::vector<BuildStats>* stats)
+{
+    const auto offsets = splitPgn(file.data(), file.size());
+
+    fatpup::ParallelFor(offsets.size() - 1, numThreads, [&](size_t chunkIdx, unsigned int threadIdx)
+    {
+        MemoryBuffer buffer(file.data() + offsets[chunkIdx], offsets[chunkIdx + 1] - offsets[chunkIdx]);
+        std::istream in(&buffer);
+        fatpup::PgnReader reader(in);
+        reader.setMaxPlies((size_t)options.maxPlies);
+
+        std::vector<fatpup::PgnTag> tags;
+        fatpup::Position startPos;
+        std::vector<fatpup::Move> moves;
+        std::string result;
+        while (reader.readGame(&tags, &startPos, &moves, &result))
+        {
+            unsigned int whiteWeight, blackWeight;
+            resultWeights(result, options.resultWeights, &whiteWeight, &blackWeight);
+            (*builders)[threadIdx].addGame(startPos, moves, options.maxPlies, whiteWeight, blackWeight);
+        }
+
+        (*stats)[threadIdx].games += reader.gameCount();
+        (*stats)[threadIdx].errors += reader.errorCount();
+    });
+}
+
+void processArchive(const fatpup::GameArchiveReader& archive, const Options& options, unsigned int numThreads,
+                    std::vector<fatpup::PolyglotBookBuilder>* builders, std::vector<BuildStats>* stats)
+{
+    // archives don't store results, every move counts the same
+    fatpup::ParallelFor(archive.gameCount(), numThreads, [&](size_t gameIdx, unsigned int threadIdx)
+    {
+        fatpup::GameDecoder decoder;
+        if (!archive.gameDecoder(gameIdx, &decoder))
+        {
+            ++(*stats)[threadIdx].errors;
+            return;
+        }
+
+        fatpup::Move move;
+        for (int ply = 0; ply < options.maxPlies; ++ply)
+        {
+            const fatpup::Position pos = decoder.position();
+            if (!decoder.nextMove(&move))
+                break;
+            (*builders)[threadIdx].addMove(pos, move);
+        }
+
+        ++(*stats)[threadIdx].games;
+        if (decoder.isCorrupted())
+            ++(*stats)[threadIdx].errors;
+    });
+}
+
+void usage()
+{
+    std::cerr << "usage: fatpup_bookbuild [-t threads] [-p max_plies] [-m min_weight] [-u] -o book.bin games.pgn|games.fpga...\n"
+                 "  -p  only the first max_plies plies of every game go into the book (20)\n"
+                 "  -m  drop the moves with smaller total weight (1)\n"
+                 "  -u  count every move as 1 instead of weighting by the game result (2 win, 1 draw, 0 loss)\n";
+}
+
+}   // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned int numThreads = fatpup::DefaultThreadCount();
+    Options options;
+    unsigned long long minWeight = 1;
+    std::string outPath;
+    std::vector<std::string> inputs;
+
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string arg = argv[a];
+        if (arg == "-t" && a + 1 < argc)
+            numThreads = (unsigned int)std::max(1, std::atoi(argv[++a]));
+        else if (arg == "-p" && a + 1 < argc)
+            options.maxPlies = std::max(0, std::atoi(argv[++a]));
+        else if (arg == "-m" && a + 1 < argc)
+            minWeight = std::strtoull(argv[++a], nullptr, 10);
+        else if (arg == "-u")
+            options.resultWeights = false;
+        else if (arg == "-o" && a + 1 < argc)
+            outPath = argv[++a];
+        else if (!arg.empty() && arg[0] != '-')
+            inputs.push_back(arg);
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (outPath.empty() || inputs.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    // map: every thread fills its own builder, no locking on the hot path
+    std::vector<fatpup::PolyglotBookBuilder> builders(numThreads);
+    std::vector<BuildStats> stats(numThreads);
+    const auto start = std::chrono::steady_clock::now();
+
+    for (const auto& input: inputs)
+    {
+        fatpup::MappedFile file;
+        if (!file.open(input))
+        {
+            std::cerr << "cannot read " << input << "\n";
+            return 1;
+        }
+
+        fatpup::GameArchiveReader archive;
+        if (archive.open(file.data(), file.size()))
+            processArchive(archive, options, numThreads, &builders, &stats);
+        else
+            processPgn(file, options, numThreads, &builders, &stats);
+    }
+
+    // reduce
+    for (unsigned int t = 1; t < numThreads; ++t)
+    {
+        builders[0].merge(builders[t]);
+        builders[t] = fatpup::PolyglotBookBuilder();
+    }
+
+    std::ofstream out(outPath, std::ios::binary);
+    if (!out || !builders[0].write(out, minWeight))
+    {
+        std::cerr << "cannot write " << outPath << "\n";
+        return 1;
+    }
+
+    BuildStats total;
+    for (const auto& threadStats: stats)
+    {
+        total.games += threadStats.games;
+        total.errors += threadStats.errors;
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << total.games << " games (" << total.errors << " with errors), " << builders[0].entryCount() <<
+        " distinct moves, " << (unsigned long long)(seconds * 1000) << " ms, " <<
+        (unsigned long long)(seconds > 0 ? total.games / seconds : 0) << " games/s, threads " << numThreads << "\n";
+
+    return 0;
+}
@@ -11,6 +11,16 @@ Engine* Engine::Create(const std::string& engineName)
 {
     if (engineName == "minimax")
         return new MinimaxEngine();
+    if (engineName == "nnue")
+    {
+        MinimaxEngine* engine = new MinimaxEngine();
+        if (engine->SetOption("EvalFile", NnueNetwork::defaultFile))
+            return engine;
+
+        delete engine;
+        std::cerr << "Cannot load " << NnueNetwork::defaultFile << "\n";
+        return nullptr;
+    }
 
     std::cerr << "Unknown engine (" << engineName << ")\n";
 
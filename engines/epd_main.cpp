@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fatpup/engine.h"
+#include "fatpup/epd.h"
+#include "parallel.h"
+
+namespace
+{
+
+struct PositionResult
+{
+    fatpup::Move bestMove;
+    std::string bestMoveSan;
+    bool solved = false;
+    unsigned long long nodes = 0;
+    double ms = 0;
+};
+
+std::string jsonEscape(const std::string& text)
+{
+    std::string result;
+    for (const char c: text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if ((unsigned char)c < 0x20)
+            result += ' ';
+        else
+            result += c;
+    }
+    return result;
+}
+
+double percentile(std::vector<double> values, double fraction)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    const size_t idx = std::min(values.size() - 1, (size_t)(fraction * (values.size() - 1) + 0.5));
+    return values[idx];
+}
+
+void usage()
+{
+    std::cerr << "usage: fatpup_epd [-t threads] [-e engine] [-j report.json] suite.epd\n";
+}
+
+}   // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned int numThreads = fatpup::DefaultThreadCount();
+    std::string engineName = "minimax";
+    std::string jsonPath;
+    std::string epdPath;
+
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string arg = argv[a];
+        if (arg == "-t" && a + 1 < argc)
+            numThreads = (unsigned int)std::max(1, std::atoi(argv[++a]));
+        else if (arg == "-e" && a + 1 < argc)
+            engineName = argv[++a];
+        else if (arg == "-j" && a + 1 < argc)
+            jsonPath = argv[++a];
+        else if (epdPath.empty() && arg[0] != '-')
+            epdPath = arg;
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (epdPath.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    std::ifstream epdFile(epdPath);
+    if (!epdFile)
+    {
+        std::cerr << "cannot open " << epdPath << "\n";
+        return 1;
+    }
+
+    std::vector<fatpup::EpdRecord> records;
+    size_t errorLine = 0;
+    if (!fatpup::readEpd(epdFile, &records, &errorLine))
+    {
+        std::cerr << epdPath << ":" << errorLine << ": invalid EPD record\n";
+        return 1;
+    }
+
+    // one engine per thread, created up front so that a bad engine name fails early
+    std::vector<std::unique_ptr<fatpup::Engine>> engines;
+    for (unsigned int t = 0; t < numThreads; ++t)
+    {
+        engines.emplace_back(fatpup::Engine::Create(engineName));
+        if (!engines.back())
+            return 1;
+    }
+
+    std::vector<PositionResult> results(records.size());
+    const auto start = std::chrono::steady_clock::now();
+
+    fatpup::ParallelFor(records.size(), numThreads, [&](size_t recordIdx, unsigned int threadIdx)
+    {
+        const auto& record = records[recordIdx];
+        auto& result = results[recordIdx];
+        fatpup::Engine* engine = engines[threadIdx].get();
+
+        const auto searchStart = std::chrono::steady_clock::now();
+        engine->SetPosition(record.pos);
+        result.bestMove = engine->GetBestMove();
+        const auto searchFinish = std::chrono::steady_clock::now();
+
+        result.ms = std::chrono::duration<double, std::milli>(searchFinish - searchStart).count();
+        result.nodes = engine->GetNodeCount();
+        result.solved = !result.bestMove.isEmpty() && record.isSolvedBy(result.bestMove);
+        result.bestMoveSan = result.bestMove.isEmpty() ? "none" : record.pos.moveToStringPGN(result.bestMove);
+    });
+
+    const auto finish = std::chrono::steady_clock::now();
+    const double totalMs = std::chrono::duration<double, std::milli>(finish - start).count();
+
+    size_t solved = 0;
+    unsigned long long totalNodes = 0;
+    double latencySum = 0;
+    std::vector<double> latencies;
+    for (size_t r = 0; r < records.size(); ++r)
+    {
+        const auto& record = records[r];
+        const auto& result = results[r];
+        solved += result.solved ? 1 : 0;
+        totalNodes += result.nodes;
+        latencySum += result.ms;
+        latencies.push_back(result.ms);
+
+        std::cout << (result.solved ? "solved  " : "FAILED  ") << (record.id.empty() ? record.fen : record.id) <<
+            "  move " << result.bestMoveSan << "  nodes " << result.nodes << "  time " << (unsigned long long)result.ms << " ms\n";
+    }
+
+    const unsigned long long nps = totalMs > 0 ? (unsigned long long)(totalNodes * 1000.0 / totalMs) : 0;
+    const double avgMs = records.empty() ? 0 : latencySum / records.size();
+    std::cout << "solved " << solved << "/" << records.size() << ", threads " << numThreads << ", total time " <<
+        (unsigned long long)totalMs << " ms, nodes " << totalNodes << ", nps " << nps << ", latency ms avg " << avgMs <<
+        " p50 " << percentile(latencies, 0.5) << " p95 " << percentile(latencies, 0.95) << " max " << percentile(latencies, 1.0) << "\n";
+
+    if (!jsonPath.empty())
+    {
+        std::ofstream jsonFile;
+        if (jsonPath != "-")
+        {
+            jsonFile.open(jsonPath);
+            if (!jsonFile)
+            {
+                std::cerr << "cannot write " << jsonPath << "\n";
+                return 1;
+            }
+        }
+        std::ostream& json = (jsonPath == "-") ? std::cout : jsonFile;
+
+        json << "{\n  \"suite\": \"" << jsonEscape(epdPath) << "\",\n  \"engine\": \"" << jsonEscape(engineName) <<
+            "\",\n  \"threads\": " << numThreads << ",\n  \"positions\": [\n";
+        for (size_t r = 0; r < records.size(); ++r)
+        {
+            const auto& record = records[r];
+            const auto& result = results[r];
+            json << "    { \"id\": \"" << jsonEscape(record.id) << "\", \"fen\": \"" << jsonEscape(record.fen) <<
+                "\", \"move\": \"" << result.bestMoveSan << "\", \"solved\": " << (result.solved ? "true" : "false") <<
+                ", \"nodes\": " << result.nodes << ", \"ms\": " << result.ms << " }" << (r + 1 < records.size() ? "," : "") << "\n";
+        }
+        json << "  ],\n  \"summary\": { \"solved\": " << solved << ", \"total\": " << records.size() << ", \"ms\": " << totalMs <<
+            ", \"nodes\": " << totalNodes << ", \"nps\": " << nps << ", \"avg_ms\": " << avgMs << ", \"p50_ms\": " << percentile(latencies, 0.5) <<
+            ", \"p95_ms\": " << percentile(latencies, 0.95) << ", \"max_ms\": " << percentile(latencies, 1.0) << " }\n}\n";
+    }
+
+    return (solved == records.size()) ? 0 : 2;
+}
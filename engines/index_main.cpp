@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "fatpup/game_codec.h"
+#include "fatpup/mapped_file.h"
+#include "fatpup/position_index.h"
+#include "parallel.h"
+
+namespace
+{
+
+void usage()
+{
+    std::cerr << "usage: fatpup_index build [-t threads] -o index.fppi games.fpga...\n"
+                 "       fatpup_index query index.fppi \"<fen>\"...\n"
+                 "game ids are numbered through all the archives in the order given\n";
+}
+
+int build(int argc, char* argv[])
+{
+    unsigned int numThreads = fatpup::DefaultThreadCount();
+    std::string outPath;
+    std::vector<std::string> inputs;
+
+    for (int a = 2; a < argc; ++a)
+    {
+        const std::string arg = argv[a];
+        if (arg == "-t" && a + 1 < argc)
+            numThreads = (unsigned int)std::max(1, std::atoi(argv[++a]));
+        else if (arg == "-o" && a + 1 < argc)
+            outPath = argv[++a];
+        else if (!arg.empty() && arg[0] != '-')
+            inputs.push_back(arg);
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (outPath.empty() || inputs.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<fatpup::PositionIndexBuilder> builders(numThreads);
+    std::vector<size_t> corrupted(numThreads, 0);
+    unsigned int firstGameId = 0;
+
+    for (const auto& input: inputs)
+    {
+        fatpup::MappedFile file;
+        fatpup::GameArchiveReader archive;
+        if (!file.open(input) || !archive.open(file.data(), file.size()))
+        {
+            std::cerr << "cannot read game archive " << input << "\n";
+            return 1;
+        }
+
+        fatpup::ParallelFor(archive.gameCount(), numThreads, [&](size_t gameIdx, unsigned int threadIdx)
+        {
+            fatpup::Position startPos;
+            std::vector<fatpup::Move> moves;
+            if (!archive.readGame(gameIdx, &startPos, &moves))
+                ++corrupted[threadIdx];
+            builders[threadIdx].addGame(firstGameId + (unsigned int)gameIdx, startPos, moves);
+        });
+
+        std::cout << input << ": games " << firstGameId << ".." << firstGameId + archive.gameCount() << "\n";
+        firstGameId += (unsigned int)archive.gameCount();
+    }
+
+    for (unsigned int t = 1; t < numThreads; ++t)
+        builders[0].merge(builders[t]);
+
+    std::ofstream out(outPath, std::ios::binary);
+    const size_t entryCount = builders[0].entryCount();
+    if (!out || !builders[0].write(out))
+    {
+        std::cerr << "cannot write " << outPath << "\n";
+        return 1;
+    }
+
+    size_t corruptedTotal = 0;
+    for (const auto c: corrupted)
+        corruptedTotal += c;
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << firstGameId << " games (" << corruptedTotal << " corrupted), " << entryCount << " positions, " <<
+        (unsigned long long)out.tellp() << " bytes, " << (unsigned long long)(seconds * 1000) << " ms\n";
+
+    return 0;
+}
+
+int query(int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        usage();
+        return 1;
+    }
+
+    fatpup::MappedFile file;
+    fatpup::PositionIndexReader index;
+    if (!file.open(argv[2]) || !index.open(file.data(), file.size()))
+    {
+        std::cerr << "cannot read position index " << argv[2] << "\n";
+        return 1;
+    }
+
+    for (int a = 3; a < argc; ++a)
+    {
+        fatpup::Position pos;
+        if (!pos.setFEN(argv[a]))
+        {
+            std::cerr << "invalid FEN: " << argv[a] << "\n";
+            return 1;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto entries = index.find(pos);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << argv[a] << ": " << entries.size() << " occurrences, " << ms << " ms\n";
+        for (const auto& entry: entries)
+            std::cout << "  game " << entry.game_id << " ply " << entry.ply << "\n";
+    }
+
+    return 0;
+}
+
+}   // namespace
+
+int main(int argc, char* argv[])
+{
+    const std::string mode = (argc > 1) ? argv[1] : "";
+    if (mode == "build")
+        return build(argc, argv);
+    if (mode == "query")
+        return query(argc, argv);
+
+    usage();
+    return 1;
+}
@@ -1,5 +1,12 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <limits>
+#include <thread>
+
+#include "fatpup/polyglot.h"
 
 #include "minimax.h"
 
@@ -9,62 +16,351 @@ namespace fatpup
 // we use / 2 here in order to avoid int overflows when flipping the sign
 static constexpr int maxEvaluation = std::numeric_limits<int>::max() / 2;
 static constexpr int minEvaluation = -maxEvaluation;
+// evaluations beyond this are mates, see MinimaxEngine::Search()
+static constexpr int mateThreshold = maxEvaluation - 1024;
+
+// MinimaxPosition::materialWeight, the evaluation of a pawn is reported as 100 centipawns
+static constexpr int centipawnWeight = 32;
+
+// quiescence search: a capture is skipped if even winning the piece for free
+// (plus this many pawns for positional gains) doesn't get the score up to alpha
+static constexpr int deltaMargin = 2;
+// the evasions of a check are all searched for this many plies into the quiescence search,
+// further on a side in check stands pat or captures like any other, so that checks and
+// cross-checks can't go on forever
+static constexpr int quiesceCheckPlies = 6;
+
+// selective search, see MinimaxEngine::Search(). Draft is the number of plies searched
+// below the node's moves before the quiescence search takes over
+// null move: the reply to a pass is searched this many plies shallower than a real move's
+static constexpr int nullMoveReduction = 2;
+static constexpr int nullMoveMinDraft = 2;
+// late move reductions: the quiet moves after the first few are searched a ply shallower,
+// two plies after the first many. A move with a history of cutoffs or in a PV node gets a ply
+// back, and so do all but the late moves at the lowest draft reduced
+static constexpr int lmrFullDepthMoves = 3;
+static constexpr int lmrLateMoves = 8;
+static constexpr int lmrMinDraft = 2;
+// futility: quiet moves are skipped at the frontier nodes if the static evaluation is this
+// many pawns below alpha, and a node near the leaves is cut off right away if the evaluation
+// is this many pawns per ply above beta (reverse futility)
+static constexpr int futilityMargin = 2;
+static constexpr int reverseFutilityMargin = 2;
+static constexpr int reverseFutilityMaxDraft = 2;
+
+// aspiration windows: from this depth on, an iteration is first searched with a window this
+// wide either side of the previous iteration's score. A fail widens it twice as far on that side
+static constexpr int aspirationMinDepth = 4;
+static constexpr int aspirationWindow = centipawnWeight / 2;
+
+// time kept in reserve for the GUI/network lag, ms
+static constexpr int moveOverhead = 30;
+
+// compile-time integer sequences for the tables below, std::index_sequence is C++14
+template <int... I> struct IndexList {};
+template <int N, int... I> struct MakeIndexList: MakeIndexList<N - 1, N - 1, I...> {};
+template <int... I> struct MakeIndexList<0, I...> { typedef IndexList<I...> type; };
 
 class MinimaxPosition:
     public Position
 {
 public:
-    MinimaxPosition(const Position& prevPos, Move move):
-        Position(prevPos)
+    // only the squares the move changes are re-evaluated, see Evaluate()
+    MinimaxPosition(const MinimaxPosition& prevPos, Move move):
+        Position(prevPos),
+        _pieceSquareEval(prevPos._pieceSquareEval),
+        _pawnKey(prevPos._pawnKey)
+    {
+        DoMove(move);
+    }
+
+    explicit MinimaxPosition(const Position& pos):
+        Position(pos),
+        _pieceSquareEval(PieceSquareEval()),
+        _pawnKey(polyglotPawnKey(pos))
     {
-        moveDone(move);
     }
 
-    MinimaxPosition() : Position() {}
+    MinimaxPosition() : Position(), _pieceSquareEval(0), _pawnKey(0) {}
 
+    // the side to move passes: only the turn changes and the en passant squares are gone
+    struct NullMove {};
+    MinimaxPosition(const MinimaxPosition& prevPos, NullMove):
+        Position(prevPos),
+        _pieceSquareEval(prevPos._pieceSquareEval),
+        _pawnKey(prevPos._pawnKey)
+    {
+        toggleTurn();
+        for (int col = COLA; col <= COLH; ++col)
+        {
+            m_board[rowColToIdx(ROW3, col)].setFlagToZero(EnPassant);
+            m_board[rowColToIdx(ROW6, col)].setFlagToZero(EnPassant);
+        }
+    }
+
+    // a rook, a queen or two minor pieces: a pass is worth trying only with those,
+    // zugzwangs are rare then. A lone minor piece often has no safe move
+    bool HasPieces(bool white) const;
+
+    // pawns is the position's EvaluatePawnStructure(), normally from the pawn table
+    int Evaluate(const PawnTable::Entry& pawns) const;
     int Evaluate() const;
+    // the same from scratch, Evaluate() is checked against it in the debug builds
+    int EvaluateFull() const;
+
+    // polyglotPawnKey(), kept up to date by DoMove()
+    unsigned long long PawnKey() const { return _pawnKey; }
+    // the score and the passed pawns of a pawn table entry, the key is left alone
+    void EvaluatePawnStructure(PawnTable::Entry* pawns) const;
+
+    // the squares changed by the move that made the position, for the NNUE accumulator
+    const SquareChange* Changes() const { return _changes; }
+    int NumChanges() const { return _numChanges; }
 
 protected:
     static constexpr int materialWeight = 32;
     static constexpr int protectWeight = 1;
     static constexpr int mobilityWeight = 2;
     static constexpr int attackWeight = 8;
+    static constexpr int doubledPawnWeight = 6;
+    static constexpr int isolatedPawnWeight = 4;
+    // by the row counted from the pawn's side, halved if an enemy piece blocks the pawn
+    static constexpr int passedPawnBonus[BOARD_SIZE] = { 0, 2, 4, 8, 14, 24, 40, 0 };
+
+    // material and placement of a piece, the part of the evaluation that
+    // depends on nothing else on the board. White's point of view
+    static int PieceSquareValue(const int piece, const int s_idx) { return pieceSquareTable.rows[piece].values[s_idx]; }
+    int PieceSquareEval() const;
+    void DoMove(Move move);
 
     int EvaluateWhitePawnAttackSquare(const int s_idx) const;
     int EvaluateBlackPawnAttackSquare(const int s_idx) const;
-    int EvaluatePawn(const int color, const int s_idx) const;
+    int EvaluatePawnAttacks(const int color, const int s_idx) const;
+    // the enemy pieces in front of the passed pawns, the part of the pawn
+    // structure evaluation that can't be cached with the pawns
+    int EvaluatePassedPawnBlockers(const PawnTable::Entry& pawns) const;
+
+    // PieceSquareValue() is looked up in a table generated at compile time, indexed by
+    // [piece | color][square]. Pawns are worth more as they advance (and the more central the
+    // more so), knights and bishops as they get farther from the edges
+    struct PieceSquareRow
+    {
+        int values[BOARD_SIZE * BOARD_SIZE];
+    };
+    struct PieceSquareTable
+    {
+        PieceSquareRow rows[(PieceMask | ColorMask) + 1];
+    };
+    static const PieceSquareTable pieceSquareTable;
+
+    static constexpr int EdgeDistance(const int idx) { return (idx < BOARD_SIZE - 1 - idx) ? idx : BOARD_SIZE - 1 - idx; }
+    static constexpr int WhitePieceSquareValue(const int piece, const int s_idx);
+    static constexpr int PieceSquareTableValue(const int piece, const int s_idx);
+    template <int... S> static constexpr PieceSquareRow MakePieceSquareRow(const int piece, IndexList<S...>);
+    template <int... P> static constexpr PieceSquareTable MakePieceSquareTable(IndexList<P...>);
 
-    int EvaluateKnight(const int color, const int s_idx) const;
-    int EvaluateBishop(const int color, const int s_idx) const;
-    int EvaluateRook(const int color, const int s_idx) const;
-    int EvaluateQueen(const int color, const int s_idx) const;
-    int EvaluateKing(const int color, const int s_idx) const;
+    // PieceSquareValue() of all the pieces, kept up to date by DoMove()
+    int _pieceSquareEval;
+    unsigned long long _pawnKey;
+    SquareChange _changes[maxSquareChanges];
+    int _numChanges = 0;
 };
 
+int MinimaxPosition::Evaluate(const PawnTable::Entry& pawns) const
+{
+    // the pawns' protection and attacks are the only terms that
+    // depend on the neighbours, they are the ones left to count
+    int eval = _pieceSquareEval + pawns.score + EvaluatePassedPawnBlockers(pawns);
+    for (int s_idx = BOARD_SIZE; s_idx < BOARD_SIZE * (BOARD_SIZE - 1); ++s_idx)
+    {
+        const auto piece = m_board[s_idx].pieceWithColor();
+        if ((piece & PieceMask) == Pawn)
+            eval += EvaluatePawnAttacks(piece & ColorMask, s_idx);
+    }
+
+    assert(eval == EvaluateFull());
+    return eval;
+}
+
 int MinimaxPosition::Evaluate() const
 {
-    int eval = 0;
+    PawnTable::Entry pawns;
+    EvaluatePawnStructure(&pawns);
+    return Evaluate(pawns);
+}
+
+bool MinimaxPosition::HasPieces(bool white) const
+{
+    int pieces = 0;
+    for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+    {
+        const auto piece = m_board[s_idx].piece();
+        if (piece != Empty && piece != Pawn && piece != King && (m_board[s_idx].isWhite() != 0) == white)
+        {
+            if (piece >= Rook || ++pieces > 1)
+                return true;
+        }
+    }
+    return false;
+}
+
+int MinimaxPosition::EvaluateFull() const
+{
+    PawnTable::Entry pawns;
+    EvaluatePawnStructure(&pawns);
+    assert(polyglotPawnKey(*this) == _pawnKey);
+
+    int eval = pawns.score + EvaluatePassedPawnBlockers(pawns);
     for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
     {
         const auto piece = m_board[s_idx].pieceWithColor();
-        if (piece != Empty)
+        eval += PieceSquareValue(piece, s_idx);
+        if ((piece & PieceMask) == Pawn)
+            eval += EvaluatePawnAttacks(piece & ColorMask, s_idx);
+    }
+
+    return eval;
+}
+
+void MinimaxPosition::EvaluatePawnStructure(PawnTable::Entry* pawns) const
+{
+    // pawns per file, and the rows of the most advanced black pawn and the least
+    // advanced white one on each file: the ones a passed pawn must be past
+    int whiteCount[BOARD_SIZE] = {};
+    int blackCount[BOARD_SIZE] = {};
+    int whiteLowest[BOARD_SIZE];
+    int blackHighest[BOARD_SIZE];
+    std::fill(whiteLowest, whiteLowest + BOARD_SIZE, (int)ROW8);
+    std::fill(blackHighest, blackHighest + BOARD_SIZE, (int)ROW1);
+    for (int s_idx = BOARD_SIZE; s_idx < BOARD_SIZE * (BOARD_SIZE - 1); ++s_idx)
+    {
+        const auto rc = idxToRowCol(s_idx);
+        const auto piece = m_board[s_idx].pieceWithColor();
+        if (piece == (Pawn | White))
         {
-            const auto color = piece & ColorMask;
-            switch (piece & PieceMask)
+            ++whiteCount[rc.col];
+            whiteLowest[rc.col] = std::min(whiteLowest[rc.col], rc.row);
+        }
+        else if (piece == (Pawn | Black))
+        {
+            ++blackCount[rc.col];
+            blackHighest[rc.col] = std::max(blackHighest[rc.col], rc.row);
+        }
+    }
+
+    pawns->score = 0;
+    pawns->whitePassed = 0;
+    pawns->blackPassed = 0;
+    for (int col = COLA; col <= COLH; ++col)
+    {
+        if (whiteCount[col] > 1)
+            pawns->score -= doubledPawnWeight * (whiteCount[col] - 1);
+        if (blackCount[col] > 1)
+            pawns->score += doubledPawnWeight * (blackCount[col] - 1);
+        if ((col == COLA || !whiteCount[col - 1]) && (col == COLH || !whiteCount[col + 1]))
+            pawns->score -= isolatedPawnWeight * whiteCount[col];
+        if ((col == COLA || !blackCount[col - 1]) && (col == COLH || !blackCount[col + 1]))
+            pawns->score += isolatedPawnWeight * blackCount[col];
+    }
+
+    for (int s_idx = BOARD_SIZE; s_idx < BOARD_SIZE * (BOARD_SIZE - 1); ++s_idx)
+    {
+        const auto rc = idxToRowCol(s_idx);
+        const auto piece = m_board[s_idx].pieceWithColor();
+        const int left = std::max(rc.col - 1, (int)COLA);
+        const int right = std::min(rc.col + 1, (int)COLH);
+        if (piece == (Pawn | White))
+        {
+            bool passed = true;
+            for (int col = left; col <= right; ++col)
+                passed = passed && blackHighest[col] <= rc.row;
+            if (passed)
             {
-                case Pawn: eval += EvaluatePawn(color, s_idx); break;
-                case Knight: eval += EvaluateKnight(color, s_idx); break;
-                case Bishop: eval += EvaluateBishop(color, s_idx); break;
-                case Rook: eval += EvaluateRook(color, s_idx); break;
-                case Queen: eval += EvaluateQueen(color, s_idx); break;
-                default: eval += EvaluateKing(color, s_idx); break;
+                pawns->score += passedPawnBonus[rc.row];
+                pawns->whitePassed |= 1ULL << s_idx;
+            }
+        }
+        else if (piece == (Pawn | Black))
+        {
+            bool passed = true;
+            for (int col = left; col <= right; ++col)
+                passed = passed && whiteLowest[col] >= rc.row;
+            if (passed)
+            {
+                pawns->score -= passedPawnBonus[ROW8 - rc.row];
+                pawns->blackPassed |= 1ULL << s_idx;
             }
         }
     }
+}
 
+int MinimaxPosition::EvaluatePassedPawnBlockers(const PawnTable::Entry& pawns) const
+{
+    int eval = 0;
+    int s_idx = 0;
+    for (unsigned long long passed = pawns.whitePassed; passed; passed >>= 1, ++s_idx)
+    {
+        if ((passed & 1) && m_board[s_idx + BOARD_SIZE].piece() != Empty && !m_board[s_idx + BOARD_SIZE].isWhite())
+            eval -= passedPawnBonus[s_idx / BOARD_SIZE] / 2;
+    }
+    s_idx = 0;
+    for (unsigned long long passed = pawns.blackPassed; passed; passed >>= 1, ++s_idx)
+    {
+        if ((passed & 1) && m_board[s_idx - BOARD_SIZE].isWhite())
+            eval += passedPawnBonus[ROW8 - s_idx / BOARD_SIZE] / 2;
+    }
+    return eval;
+}
+
+int MinimaxPosition::PieceSquareEval() const
+{
+    int eval = 0;
+    for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+        eval += PieceSquareValue(m_board[s_idx].pieceWithColor(), s_idx);
     return eval;
 }
 
+void MinimaxPosition::DoMove(Move move)
+{
+    // the squares a move can change: the source, the destination, the pawn taken
+    // en passant (next to the source) and the castling rook's ones
+    const int row = move.fields.src_row;
+    const int candidates[] =
+    {
+        rowColToIdx(row, move.fields.src_col),
+        rowColToIdx(move.fields.dst_row, move.fields.dst_col),
+        rowColToIdx(row, move.fields.dst_col),
+        rowColToIdx(row, move.fields.rook_src_col),
+        rowColToIdx(row, move.fields.rook_dst_col)
+    };
+    const int numCandidates = (move.fields.rook_src_col != move.fields.rook_dst_col) ? 5 : 3;
+
+    int squares[maxSquareChanges];
+    unsigned char before[maxSquareChanges];
+    int numSquares = 0;
+    for (int c = 0; c < numCandidates; ++c)
+    {
+        if (std::find(squares, squares + numSquares, candidates[c]) == squares + numSquares)
+        {
+            before[numSquares] = m_board[candidates[c]].pieceWithColor();
+            squares[numSquares++] = candidates[c];
+        }
+    }
+
+    moveDone(move);
+
+    for (int i = 0; i < numSquares; ++i)
+    {
+        const unsigned char after = m_board[squares[i]].pieceWithColor();
+        if (after == before[i])
+            continue;
+
+        _pieceSquareEval += PieceSquareValue(after, squares[i]) - PieceSquareValue(before[i], squares[i]);
+        _pawnKey ^= polyglotPawnSquareKey(before[i], squares[i]) ^ polyglotPawnSquareKey(after, squares[i]);
+        _changes[_numChanges++] = SquareChange{ (unsigned char)squares[i], before[i], after };
+    }
+}
+
 int MinimaxPosition::EvaluateWhitePawnAttackSquare(const int s_idx) const
 {
     const auto square = m_board[s_idx];
@@ -91,162 +387,994 @@ int MinimaxPosition::EvaluateBlackPawnAttackSquare(const int s_idx) const
     return 0;
 }
 
-int MinimaxPosition::EvaluatePawn(const int color, const int s_idx) const
+int MinimaxPosition::EvaluatePawnAttacks(const int color, const int s_idx) const
 {
     const auto rc = idxToRowCol(s_idx);
+    int value = 0;
     if (color == Black)
     {
-        int value = -materialWeight * PawnValue;
-        value -= ((ROW7 - rc.row) + 1) * (std::min(rc.col - COLA, COLH - rc.col) + 1);
         if (rc.col > COLA)
             value += EvaluateBlackPawnAttackSquare(rowColToIdx(rc.row - 1, rc.col - 1));
         if (rc.col < COLH)
             value += EvaluateBlackPawnAttackSquare(rowColToIdx(rc.row - 1, rc.col + 1));
-
-        //std::cerr << "black pawn at " << (char)((int)('a') + rc.col) << (char)((int)('1') + rc.row) << ", value: " << value << "\n";
         return value;
     }
 
-    int value = materialWeight * PawnValue;
-    value += ((rc.row - ROW2) + 1) * (std::min(rc.col - COLA, COLH - rc.col) + 1);
-
     if (rc.col > COLA)
         value += EvaluateWhitePawnAttackSquare(rowColToIdx(rc.row + 1, rc.col - 1));
     if (rc.col < COLH)
         value += EvaluateWhitePawnAttackSquare(rowColToIdx(rc.row + 1, rc.col + 1));
-
     return value;
 }
 
-int MinimaxPosition::EvaluateKnight(const int color, const int s_idx) const
+constexpr int MinimaxPosition::WhitePieceSquareValue(const int piece, const int s_idx)
 {
-    const auto rc = idxToRowCol(s_idx);
-    auto value = materialWeight * KnightValue;
-    value += mobilityWeight * (std::min(rc.row - ROW1, ROW8 - rc.row) + std::min(rc.col - COLA, COLH - rc.col));
-    return (color == Black) ? -value : value;
+    return (piece == Pawn) ? materialWeight * PawnValue + (s_idx / BOARD_SIZE - ROW2 + 1) * (EdgeDistance(s_idx % BOARD_SIZE) + 1) :
+        (piece == Knight) ? materialWeight * KnightValue + mobilityWeight * (EdgeDistance(s_idx / BOARD_SIZE) + EdgeDistance(s_idx % BOARD_SIZE)) :
+        (piece == Bishop) ? materialWeight * BishopValue + mobilityWeight * (EdgeDistance(s_idx / BOARD_SIZE) + EdgeDistance(s_idx % BOARD_SIZE)) :
+        (piece == Rook) ? materialWeight * RookValue :
+        (piece == Queen) ? materialWeight * QueenValue :
+        (piece == King) ? materialWeight * KingValue : 0;
 }
 
-int MinimaxPosition::EvaluateBishop(const int color, const int s_idx) const
+// black pieces are worth the same as the white ones on the square mirrored across the board
+constexpr int MinimaxPosition::PieceSquareTableValue(const int piece, const int s_idx)
 {
-    const auto rc = idxToRowCol(s_idx);
-    auto value = materialWeight * BishopValue;
-    value += mobilityWeight * (std::min(rc.row - ROW1, ROW8 - rc.row) + std::min(rc.col - COLA, COLH - rc.col));
-    return (color == Black) ? -value : value;
+    return (piece & ColorMask) ? WhitePieceSquareValue(piece & PieceMask, s_idx) :
+        -WhitePieceSquareValue(piece & PieceMask, s_idx ^ ((BOARD_SIZE - 1) * BOARD_SIZE));
 }
 
-int MinimaxPosition::EvaluateRook(const int color, const int s_idx) const
+template <int... S>
+constexpr MinimaxPosition::PieceSquareRow MinimaxPosition::MakePieceSquareRow(const int piece, IndexList<S...>)
 {
-    return (color == Black) ? -materialWeight * RookValue : materialWeight * RookValue;
+    return PieceSquareRow{ { PieceSquareTableValue(piece, S)... } };
 }
 
-int MinimaxPosition::EvaluateQueen(const int color, const int s_idx) const
+template <int... P>
+constexpr MinimaxPosition::PieceSquareTable MinimaxPosition::MakePieceSquareTable(IndexList<P...>)
 {
-    return (color == Black) ? -materialWeight * QueenValue : materialWeight * QueenValue;
+    return PieceSquareTable{ { MakePieceSquareRow(P, MakeIndexList<BOARD_SIZE * BOARD_SIZE>::type())... } };
 }
 
-int MinimaxPosition::EvaluateKing(const int color, const int s_idx) const
-{
-    return (color == Black) ? -materialWeight * KingValue : materialWeight * KingValue;
-}
+constexpr MinimaxPosition::PieceSquareTable MinimaxPosition::pieceSquareTable =
+    MinimaxPosition::MakePieceSquareTable(MakeIndexList<(PieceMask | ColorMask) + 1>::type());
 
 // end of MinimaxPosition methods
 
 
+// std::min() and the like bind them to references, so C++11 wants them defined
+constexpr int MinimaxEngine::defaultSearchDepth;
+constexpr int MinimaxEngine::maxSearchDepth;
+constexpr int MinimaxPosition::passedPawnBonus[BOARD_SIZE];
+
+
 int MinimaxEngine::SetPosition(const Position& pos)
 {
     _pos = pos;
+    _ponderMove = Move();
     return 0;
 }
 
 void MinimaxEngine::MoveDone(Move move)
 {
     _pos += move;
+    _ponderMove = Move();
+}
+
+// Splits the clock into a soft budget (don't start a new iteration past it) and a
+// hard one (abort the search). Returns false if the limits don't restrict time
+static bool timeBudget(const SearchLimits& limits, bool whiteTurn, int* softMs, int* hardMs)
+{
+    if (limits.movetime > 0)
+    {
+        *softMs = *hardMs = limits.movetime;
+        return true;
+    }
+
+    const int time = whiteTurn ? limits.wtime : limits.btime;
+    const int inc = whiteTurn ? limits.winc : limits.binc;
+    if (time <= 0)
+        return false;
+
+    const int movesToGo = (limits.movestogo > 0) ? std::min(limits.movestogo, 40) : 30;
+    const int available = std::max(1, time - moveOverhead);
+    *softMs = std::min(available, time / movesToGo + inc * 3 / 4);
+    *hardMs = std::min(available, *softMs * 3);
+    return true;
 }
 
 Move MinimaxEngine::GetBestMove()
 {
-    int eval = 0;
+    PrepareSearch();
+    return IterativeDeepening();
+}
+
+void MinimaxEngine::Start(std::function<void(Move)> onBestMove)
+{
+    Stop();
 
-    _bestMove = FindBestMove(_pos, eval, 1);
+    _stopCalled = false;
+    PrepareSearch();
+    _searchThread = std::thread([this, onBestMove]
+    {
+        const Move bestMove = IterativeDeepening();
+        {
+            // UCI wants no bestmove before "stop" (or "ponderhit") even if the search has
+            // nothing more to do
+            std::unique_lock<std::mutex> lock(_stopMutex);
+            _searchEvent.wait(lock, [this] { return _stopCalled || !(_limits.infinite || Pondering()); });
+        }
+        onBestMove(bestMove);
+    });
+}
+
+void MinimaxEngine::Stop()
+{
+    if (!_searchThread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(_stopMutex);
+        _stopCalled = true;
+    }
+    _stop->store(true);
+    _searchEvent.notify_all();
+    _searchThread.join();
+}
+
+void MinimaxEngine::PonderHit()
+{
+    // the clock first, the search thread looks at it once it sees that pondering is over
+    _clockStart.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(_stopMutex);
+        _pondering.store(false, std::memory_order_release);
+    }
+    _searchEvent.notify_all();
+}
+
+void MinimaxEngine::PrepareSearch()
+{
+    _stop->store(false);
+    _clockStart.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    _pondering.store(_limits.ponder, std::memory_order_release);
+}
+
+long long MinimaxEngine::ClockMs() const
+{
+    const std::chrono::steady_clock::time_point clockStart(std::chrono::steady_clock::duration(_clockStart.load(std::memory_order_relaxed)));
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - clockStart).count();
+}
+
+Move MinimaxEngine::IterativeDeepening()
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    _softMs = _hardMs = 0;
+    _hasDeadline = !_limits.infinite && timeBudget(_limits, _pos.isWhiteTurn(), &_softMs, &_hardMs);
+
+    // with no limits at all it's a fixed depth search, as it always was. Pondering goes on
+    // until "ponderhit", only then the depth limit and the clock apply
+    _depthLimit = std::min(_limits.depth, maxSearchDepth);
+    if (_depthLimit <= 0)
+        _depthLimit = (_hasDeadline || _limits.nodes || _limits.infinite) ? maxSearchDepth : defaultSearchDepth;
+    const int maxDepth = Pondering() ? maxSearchDepth : _depthLimit;
+    _completedDepth = 0;
+
+    _nodes = 0;
+    _bestMove = Move();
+    _principalVariation.clear();
+    _bestLines.clear();
+    _stats = SearchStats();
+    _tt->NewSearch();
+    NewSearch();
+    const MinimaxPosition rootPos(_pos);
+    const unsigned long long rootKey = polyglotKey(_pos);
+    RefreshAccumulator(rootPos, 1);
+
+    std::vector<std::thread> helperThreads;
+    for (size_t h = 0; h < _helpers.size(); ++h)
+    {
+        MinimaxEngine* helper = _helpers[h].get();
+        helper->_pos = _pos;
+        helper->_nodes = 0;
+        helperThreads.emplace_back([helper, maxDepth, h] { helper->HelperSearch(maxDepth, (int)h); });
+    }
+
+    // with the root in the tablebases, the first iteration's scores are exact already
+    int rootWdl = 0;
+    int rootDistance = 0;
+    const bool rootInTablebases = _tablebases && _tablebases->probe(_pos, &rootWdl, &rootDistance);
+
+    // MultiPV: each line is the best one among the root moves the lines before it don't start with
+    const int numLines = std::max(1, std::min(_multiPv, (int)_pos.possibleMoves().size()));
+    std::vector<RootLine> lines;
+    for (int depth = 1; depth <= maxDepth; ++depth)
+    {
+        // the first iteration always completes, so that there's a move to return
+        _checkLimits = (depth > 1);
+
+        std::vector<RootLine> iterationLines;
+        _excludedRootMoves.clear();
+        for (int lineIdx = 0; lineIdx < numLines; ++lineIdx)
+        {
+            const bool hasPrevLine = (lineIdx < (int)lines.size() && !lines[lineIdx].pv.empty());
+            Move lineBestMove = hasPrevLine ? lines[lineIdx].pv.front() : Move();
+            const int eval = SearchRoot(rootPos, rootKey, depth, hasPrevLine ? lines[lineIdx].eval : 0, &lineBestMove);
+            if (_checkLimits && Stopped())
+                break;
+
+            RootLine line;
+            line.eval = eval;
+            line.pv.assign(_pv[1], _pv[1] + _pvLength[1]);
+            if (line.pv.empty() && !lineBestMove.isEmpty())
+                line.pv.push_back(lineBestMove);
+            if (rootInTablebases)
+                ExtendPvFromTablebases(&line.pv);
+            iterationLines.push_back(line);
+            if (lineBestMove.isEmpty())
+                break;
+            _excludedRootMoves.push_back(lineBestMove);
+        }
+        _excludedRootMoves.clear();
+        if (_checkLimits && Stopped())
+            break;
+
+        // a later line may score better than an earlier one, the search is not that exact
+        std::stable_sort(iterationLines.begin(), iterationLines.end(), [](const RootLine& a, const RootLine& b) { return a.eval > b.eval; });
+        lines = iterationLines;
+        const int eval = lines.front().eval;
+        _principalVariation = lines.front().pv;
+        _bestMove = _principalVariation.empty() ? Move() : _principalVariation.front();
+        _completedDepth = depth;
+        const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+        _bestLines.clear();
+        for (size_t lineIdx = 0; lineIdx < lines.size(); ++lineIdx)
+        {
+            SearchInfo info;
+            info.depth = depth;
+            info.nodes = GetNodeCount();
+            info.time = (unsigned long long)elapsedMs;
+            info.hashfull = _tt->HashFull();
+            if (lines[lineIdx].eval > mateThreshold)
+                info.mate = (maxEvaluation - lines[lineIdx].eval + 1) / 2;
+            else if (lines[lineIdx].eval < -mateThreshold)
+                info.mate = -(maxEvaluation + lines[lineIdx].eval + 1) / 2;
+            else
+                info.score = lines[lineIdx].eval * 100 / (centipawnWeight * PawnValue);
+            info.multipv = (_multiPv > 1) ? (int)lineIdx + 1 : 0;
+            info.pv = lines[lineIdx].pv;
+            _bestLines.push_back(info);
+            if (_infoCallback)
+                _infoCallback(info);
+        }
+
+        // a deeper search can't find a shorter mate nor know more than the tablebases, and
+        // there's no point to go on if the next iteration is unlikely to finish in time
+        if (_bestMove.isEmpty() || eval > mateThreshold || eval < -mateThreshold || rootInTablebases)
+            break;
+        if (!Pondering() && (depth >= _depthLimit || (_hasDeadline && ClockMs() >= _softMs)))
+            break;
+    }
+
+    _checkLimits = false;
+    _stop->store(true);
+    for (auto& thread: helperThreads)
+        thread.join();
+
+    // the expected reply is the next move of the PV, or the hash table's best move in the
+    // position after ours if the PV ends there
+    _ponderMove = Move();
     if (!_bestMove.isEmpty())
+    {
         _pos += _bestMove;
 
+        TranspositionTable::Entry entry;
+        if (_principalVariation.size() > 1)
+            _ponderMove = _principalVariation[1];
+        else if (_tt->Probe(polyglotKey(_pos), &entry) && !entry.move.isEmpty())
+        {
+            const Move reply = entry.move.toMove();
+            const auto replies = _pos.possibleMoves();
+            if (std::find(replies.begin(), replies.end(), reply) != replies.end())
+                _ponderMove = reply;
+        }
+    }
+
     return _bestMove;
 }
 
-Move MinimaxEngine::FindBestMove(const Position& position, int& afterMoveEval, int currentDepth)
+int MinimaxEngine::SearchRoot(const MinimaxPosition& rootPos, unsigned long long rootKey, int depth, int prevEval, Move* bestMove)
+{
+    // the window is widened until the score falls inside it, the root's move is the one to try
+    // first again: it's still the best one after a fail low, the one that beat beta after a fail high
+    int alphaDelta = aspirationWindow;
+    int betaDelta = aspirationWindow;
+    int alpha = (depth >= aspirationMinDepth) ? std::max(prevEval - alphaDelta, minEvaluation) : minEvaluation;
+    int beta = (depth >= aspirationMinDepth) ? std::min(prevEval + betaDelta, maxEvaluation) : maxEvaluation;
+    for (;;)
+    {
+        const int eval = Search(rootPos, rootKey, alpha, beta, 1, depth, bestMove, *bestMove);
+        if (_checkLimits && Stopped())
+            return eval;
+
+        if (eval <= alpha && alpha > minEvaluation)
+        {
+            alphaDelta *= 2;
+            alpha = (eval - alphaDelta > -mateThreshold) ? eval - alphaDelta : minEvaluation;
+        }
+        else if (eval >= beta && beta < maxEvaluation)
+        {
+            betaDelta *= 2;
+            beta = (eval + betaDelta < mateThreshold) ? eval + betaDelta : maxEvaluation;
+        }
+        else
+            return eval;
+    }
+}
+
+void MinimaxEngine::HelperSearch(int maxDepth, int helperIdx)
 {
-    const auto moves = position.possibleMoves();
-    const bool searchForMin = !position.isWhiteTurn();
+    _stats = SearchStats();
+    NewSearch();
+    _checkLimits = true;
+    const MinimaxPosition rootPos(_pos);
+    const unsigned long long rootKey = polyglotKey(_pos);
+    RefreshAccumulator(rootPos, 1);
 
+    // every other helper runs a ply ahead of the main thread, so that the helpers
+    // fill the hash table for its next iteration rather than repeat its work
     Move bestMove;
-    int bestMoveEval = searchForMin ? maxEvaluation : minEvaluation;
+    for (int depth = 1 + (helperIdx + 1) % 2; depth <= maxDepth && !Stopped(); ++depth)
+    {
+        Move iterationBestMove;
+        Search(rootPos, rootKey, minEvaluation, maxEvaluation, 1, depth, &iterationBestMove, bestMove);
+        if (Stopped())
+            break;
+        bestMove = iterationBestMove;
+    }
+}
 
-    // check moves in this order, otherwise it will postpone capturing
-    // or promotion forever because promoting a pawn right away gives
-    // you exactly the same evaluation as promoting in three moves as
-    // long as it's inevitable
-    enum MoveType { Capture = 0, Promotion, Other };
+unsigned long long MinimaxEngine::GetNodeCount() const
+{
+    unsigned long long nodes = _nodes.load(std::memory_order_relaxed);
+    for (const auto& helper: _helpers)
+        nodes += helper->_nodes.load(std::memory_order_relaxed);
+    return nodes;
+}
 
-    for (int moveType = Capture; moveType <= Other; ++moveType)
+bool MinimaxEngine::SetOption(const std::string& name, const std::string& value)
+{
+    if (name == "Hash")
+    {
+        char* end = nullptr;
+        const long sizeMb = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end || sizeMb < 0 || sizeMb > (long)TranspositionTable::maxSizeMb)
+            return false;
+        _tt->Resize((unsigned int)sizeMb);
+        return true;
+    }
+    if (name == "Clear Hash")
     {
-        for (auto move: moves)
+        _tt->Clear();
+        return true;
+    }
+    if (name == "Threads")
+    {
+        char* end = nullptr;
+        const long threads = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end || threads < 1 || threads > maxThreads)
+            return false;
+
+        _helpers.clear();
+        for (long t = 1; t < threads; ++t)
+        {
+            _helpers.emplace_back(new MinimaxEngine(_tt, &_stopFlag));
+            _helpers.back()->SetNetwork(_network);
+            _helpers.back()->_tablebases = _tablebases;
+            _helpers.back()->_selectivity = _selectivity;
+        }
+        return true;
+    }
+    if (name == "NullMove" || name == "LateMoveReductions" || name == "Futility")
+    {
+        if (value != "true" && value != "false")
+            return false;
+
+        bool& enabled = (name == "NullMove") ? _selectivity.nullMove :
+            (name == "LateMoveReductions") ? _selectivity.lateMoveReductions : _selectivity.futility;
+        enabled = (value == "true");
+        for (auto& helper: _helpers)
+            helper->_selectivity = _selectivity;
+        return true;
+    }
+    if (name == "MultiPV")
+    {
+        char* end = nullptr;
+        const long numLines = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end || numLines < 1 || numLines > maxMultiPv)
+            return false;
+        _multiPv = (int)numLines;
+        return true;
+    }
+    if (name == "EvalFile")
+    {
+        if (value.empty() || value == "<empty>")
         {
-            const bool isMoveCapture = position.isMoveCapture(move);
-            const bool isPromotion = (move.fields.promoted_to > Pawn);
-            if (moveType == Capture)
+            SetNetwork(nullptr);
+            return true;
+        }
+
+        std::shared_ptr<NnueNetwork> network = std::make_shared<NnueNetwork>();
+        if (!network->Load(value))
+            return false;
+        SetNetwork(network);
+        return true;
+    }
+    if (name == "TablebasePath")
+    {
+        std::shared_ptr<Tablebases> tablebases;
+        if (!value.empty() && value != "<empty>")
+        {
+            tablebases = std::make_shared<Tablebases>();
+            if (!tablebases->open(value))
+                return false;
+        }
+
+        _tablebases = tablebases;
+        for (auto& helper: _helpers)
+            helper->_tablebases = tablebases;
+        return true;
+    }
+
+    return false;
+}
+
+void MinimaxEngine::ExtendPvFromTablebases(std::vector<Move>* pv) const
+{
+    Position pos = _pos;
+    for (const auto move: *pv)
+        pos += move;
+
+    int wdl = 0;
+    int distance = 0;
+    while (pv->size() < (size_t)maxSearchDepth)
+    {
+        const Move move = _tablebases->bestMove(pos, &wdl, &distance);
+        if (move.isEmpty() || !wdl)
+            break;
+        pv->push_back(move);
+        pos += move;
+    }
+}
+
+void MinimaxEngine::CheckLimits()
+{
+    // summing up the helpers' counters on every node would be a waste
+    const unsigned long long nodes = _nodes.load(std::memory_order_relaxed);
+    const bool checkNow = (nodes % timeCheckInterval) == 0;
+    if (_limits.nodes && (_helpers.empty() || checkNow) && GetNodeCount() >= _limits.nodes)
+        _stop->store(true);
+    else if (checkNow && !Pondering() && (_completedDepth >= _depthLimit || (_hasDeadline && ClockMs() >= _hardMs)))
+        _stop->store(true);
+}
+
+Move MinimaxEngine::FindBestMove(const Position& position, int& afterMoveEval, int currentDepth, int maxDepth)
+{
+    Move bestMove;
+    maxDepth = std::min(maxDepth, maxSearchDepth);
+    _tt->NewSearch();
+    NewSearch();
+    const MinimaxPosition rootPos(position);
+    RefreshAccumulator(rootPos, currentDepth);
+    const int eval = Search(rootPos, polyglotKey(position), minEvaluation, maxEvaluation, currentDepth, maxDepth, &bestMove);
+    afterMoveEval = position.isWhiteTurn() ? eval : -eval;
+    return bestMove;
+}
+
+int MinimaxEngine::Evaluate(const Position& position)
+{
+    return MinimaxPosition(position).Evaluate();
+}
+
+void MinimaxEngine::SetNetwork(std::shared_ptr<const NnueNetwork> network)
+{
+    _network = network;
+    _accumulators.assign(network ? accumulatorPlies : 0, NnueNetwork::Accumulator());
+    for (auto& helper: _helpers)
+        helper->SetNetwork(network);
+}
+
+void MinimaxEngine::RefreshAccumulator(const MinimaxPosition& position, int currentDepth)
+{
+    if (_network && currentDepth - 1 < (int)_accumulators.size())
+        _network->Refresh(position, &_accumulators[currentDepth - 1]);
+}
+
+void MinimaxEngine::UpdateAccumulator(const MinimaxPosition& afterMovePos, int currentDepth)
+{
+    if (_network && currentDepth < (int)_accumulators.size())
+        _network->Update(_accumulators[currentDepth - 1], afterMovePos.Changes(), afterMovePos.NumChanges(), &_accumulators[currentDepth]);
+}
+
+const PawnTable::Entry& MinimaxEngine::PawnStructure(const MinimaxPosition& position)
+{
+    ++_stats.pawnProbes;
+    PawnTable::Entry* entry = nullptr;
+    if (_pawnTable.Probe(position.PawnKey(), &entry))
+    {
+        ++_stats.pawnHits;
+        return *entry;
+    }
+
+    position.EvaluatePawnStructure(entry);
+    entry->key = position.PawnKey();
+    entry->used = true;
+    return *entry;
+}
+
+int MinimaxEngine::StaticEvaluation(const MinimaxPosition& position, int currentDepth)
+{
+    if (!_network)
+    {
+        const int eval = position.Evaluate(PawnStructure(position));
+        return position.isWhiteTurn() ? eval : -eval;
+    }
+
+    // the quiescence search may get deeper than the accumulator stack
+    if (currentDepth - 1 >= (int)_accumulators.size())
+    {
+        NnueNetwork::Accumulator accumulator;
+        _network->Refresh(position, &accumulator);
+        return _network->Evaluate(accumulator, position.isWhiteTurn());
+    }
+
+    const NnueNetwork::Accumulator& accumulator = _accumulators[currentDepth - 1];
+#ifndef NDEBUG
+    NnueNetwork::Accumulator fullAccumulator;
+    _network->Refresh(position, &fullAccumulator);
+    assert(std::memcmp(&fullAccumulator, &accumulator, sizeof(accumulator)) == 0);
+#endif
+    return _network->Evaluate(accumulator, position.isWhiteTurn());
+}
+
+// mate scores are stored relative to the position rather than to the root of the search
+static int ScoreToTT(int score, int currentDepth)
+{
+    if (score > mateThreshold)
+        return score + currentDepth;
+    if (score < -mateThreshold)
+        return score - currentDepth;
+    return score;
+}
+
+static int ScoreFromTT(int score, int currentDepth)
+{
+    if (score > mateThreshold)
+        return score - currentDepth;
+    if (score < -mateThreshold)
+        return score + currentDepth;
+    return score;
+}
+
+// a tablebase result as a search score: the mate distance plies later than the position
+static int TablebaseScore(int wdl, int distance, int currentDepth)
+{
+    if (wdl > 0)
+        return maxEvaluation - (currentDepth + distance - 1);
+    if (wdl < 0)
+        return -(maxEvaluation - (currentDepth + distance - 1));
+    return 0;
+}
+
+int MinimaxEngine::Search(const MinimaxPosition& position, unsigned long long key, int alpha, int beta, int currentDepth, int maxDepth,
+                          Move* bestMove, Move pvMove, bool nullMoveAllowed)
+{
+    // the result only depends on how many plies are left, so it can
+    // be reused for any transposition searched as deep or shallower
+    const int draft = maxDepth - currentDepth;
+
+    // principal variation search: the nodes searched with an open window make the PV, the
+    // others only have to tell whether a move beats alpha (null window, beta = alpha + 1)
+    const bool pvNode = (beta - alpha > 1);
+    _pvLength[currentDepth] = 0;
+
+    TranspositionTable::Entry ttEntry;
+    if (_tt->Probe(key, &ttEntry))
+    {
+        if (pvMove.isEmpty())
+            pvMove = ttEntry.move.toMove();
+
+        // the root must always come up with a move, and a PV node's line would be cut short
+        if (!bestMove && !pvNode && ttEntry.draft >= draft)
+        {
+            const int ttScore = ScoreFromTT(ttEntry.score, currentDepth);
+            if (ttEntry.bound == TranspositionTable::ExactBound ||
+                (ttEntry.bound == TranspositionTable::LowerBound && ttScore >= beta) ||
+                (ttEntry.bound == TranspositionTable::UpperBound && ttScore <= alpha))
             {
-                if (!isMoveCapture)
-                    continue;
+                return ttScore;
             }
-            else if (moveType == Promotion)
+        }
+    }
+
+    // the endings the tablebases have are not searched, the root must come up with a move though
+    int tbWdl = 0;
+    int tbDistance = 0;
+    if (!bestMove && _tablebases && _tablebases->probe(position, &tbWdl, &tbDistance))
+        return TablebaseScore(tbWdl, tbDistance, currentDepth);
+
+    // the selective search relies on the static evaluation, which means nothing in check.
+    // The root is searched in full, it must come up with a move
+    const bool selective = !bestMove && !position.isCheck();
+    const int staticEval = selective ? StaticEvaluation(position, currentDepth) : 0;
+    if (selective)
+    {
+        // reverse futility: too far above beta for the few plies left to bring it down
+        const int reverseFutilityEval = staticEval - reverseFutilityMargin * centipawnWeight * (draft + 1);
+        if (_selectivity.futility && draft <= reverseFutilityMaxDraft && beta > -mateThreshold && beta < mateThreshold &&
+            reverseFutilityEval >= beta)
+        {
+            return reverseFutilityEval;
+        }
+
+        // null move: if even passing (searched shallower) fails high, a real move would too.
+        // Not twice in a row, and not in the endings (see HasPieces()) where passing may well be the best move
+        if (_selectivity.nullMove && nullMoveAllowed && draft >= nullMoveMinDraft && staticEval >= beta && beta < mateThreshold &&
+            position.HasPieces(position.isWhiteTurn()))
+        {
+            const MinimaxPosition nullPos(position, MinimaxPosition::NullMove());
+            UpdateAccumulator(nullPos, currentDepth);
+            CountNode();
+
+            const int nullMaxDepth = maxDepth - nullMoveReduction;
+            const int eval = (currentDepth < nullMaxDepth) ?
+                -Search(nullPos, polyglotKey(nullPos), -beta, -beta + 1, currentDepth + 1, nullMaxDepth, nullptr, Move(), false) :
+                -Quiesce(nullPos, -beta, -beta + 1, currentDepth + 1, false);
+            if (_checkLimits && Stopped())
+                return 0;
+            if (eval >= beta)
+                return (eval < mateThreshold) ? eval : beta;
+        }
+    }
+
+    // futility: quiet moves can't get a hopeless frontier node up to alpha
+    const bool futile = selective && _selectivity.futility && draft == 0 && alpha > -mateThreshold &&
+        staticEval + futilityMargin * centipawnWeight <= alpha;
+
+    std::vector<ScoredMove> moves;
+    // the root moves the lines before this one start with (MultiPV) are left out
+    auto possibleMoves = position.possibleMoves();
+    const bool excludeMoves = bestMove && !_excludedRootMoves.empty();
+    if (excludeMoves)
+    {
+        possibleMoves.erase(std::remove_if(possibleMoves.begin(), possibleMoves.end(), [this](Move move) {
+            return std::find(_excludedRootMoves.begin(), _excludedRootMoves.end(), move) != _excludedRootMoves.end();
+        }), possibleMoves.end());
+    }
+
+    // the parent's getState() tells the mates and the stalemates, but the null move child comes
+    // here without it: a side with no moves is mated or stalemated, not just out of options
+    if (possibleMoves.empty() && !excludeMoves)
+        return position.isCheck() ? -(maxEvaluation - (currentDepth - 1)) : 0;
+    ScoreMoves(position, possibleMoves, pvMove, currentDepth, &moves);
+
+    const int originalAlpha = alpha;
+    int bestMoveEval = minEvaluation;
+    Move nodeBestMove;
+
+    for (size_t moveIdx = 0; moveIdx < moves.size(); ++moveIdx)
+    {
+        const Move move = PickNext(&moves, moveIdx);
+        const bool isMoveCapture = position.isMoveCapture(move);
+        const bool isMoveQuiet = !isMoveCapture && move.fields.promoted_to <= Pawn;
+
+        const MinimaxPosition afterMovePos(position, move);
+        if (futile && isMoveQuiet && moveIdx > 0 && !afterMovePos.isCheck())
+        {
+            bestMoveEval = std::max(bestMoveEval, staticEval + futilityMargin * centipawnWeight);
+            continue;
+        }
+
+        const auto state = afterMovePos.getState();
+        UpdateAccumulator(afterMovePos, currentDepth);
+        CountNode();
+
+        if (_checkLimits)
+        {
+            CheckLimits();
+            if (Stopped())
+                return 0;
+        }
+
+        // nothing beats a mate right away. Mates found deeper in the tree score
+        // less, so that the shortest one is preferred
+        _pvLength[currentDepth + 1] = 0;
+        if (state == Position::State::Checkmate)
+        {
+            bestMoveEval = maxEvaluation - currentDepth;
+            nodeBestMove = move;
+            UpdatePv(currentDepth, move);
+            break;
+        }
+
+        int eval = 0;
+        if (state != Position::State::Stalemate)
+        {
+            const unsigned long long afterMoveKey = polyglotKeyAfterMove(position, key, move, afterMovePos);
+
+            // late move reductions: a quiet move this far down the list most likely fails low,
+            // a null window search a ply or two shallower tells. If it doesn't, the move gets a full search
+            int reduction = 0;
+            if (selective && _selectivity.lateMoveReductions && isMoveQuiet && state == Position::State::Normal &&
+                draft >= lmrMinDraft && moveIdx >= lmrFullDepthMoves && moves[moveIdx].score <= historyLimit)
             {
-                // captures are already checked in the first run, skip
-                if (isMoveCapture || !isPromotion)
-                    continue;
+                reduction = (moveIdx >= lmrLateMoves && draft > lmrMinDraft) ? 2 : 1;
+                if (moves[moveIdx].score >= (draft + 1) * (draft + 1) || pvNode || (draft == lmrMinDraft && moveIdx < lmrLateMoves))
+                    --reduction;
             }
-            else
+            if (reduction > 0)
             {
-                // captures and promotions are already checked, skip
-                if (isMoveCapture || isPromotion)
-                    continue;
+                eval = (currentDepth < maxDepth - reduction) ?
+                    -Search(afterMovePos, afterMoveKey, -alpha - 1, -alpha, currentDepth + 1, maxDepth - reduction, nullptr) :
+                    -Quiesce(afterMovePos, -alpha - 1, -alpha, currentDepth + 1, false);
+                if (_checkLimits && Stopped())
+                    return 0;
             }
 
-            const MinimaxPosition afterMovePos(position, move);
-            const auto state = afterMovePos.getState();
-
-            int eval = 0;
-            if (state == Position::State::Checkmate)
+            // in a PV node the moves after the first one are expected to fail low, a null window
+            // proves it cheaper. Only a move that beats alpha after all is searched with the full window
+            bool fullWindow = (reduction == 0 || eval > alpha);
+            if (fullWindow && pvNode && moveIdx > 0)
             {
-                afterMoveEval = searchForMin ? minEvaluation + 1 : maxEvaluation - 1;
-                return move;
+                eval = (currentDepth < maxDepth) ?
+                    -Search(afterMovePos, afterMoveKey, -alpha - 1, -alpha, currentDepth + 1, maxDepth, nullptr) :
+                    -Quiesce(afterMovePos, -alpha - 1, -alpha, currentDepth + 1, state == Position::State::Check);
+                if (_checkLimits && Stopped())
+                    return 0;
+                fullWindow = (eval > alpha && eval < beta);
             }
 
-            if (state != Position::State::Stalemate)
+            if (fullWindow)
             {
-                auto depthLimit = isMoveCapture ? 5 : (state == Position::State::Check ? 4 : 3);
-                if (currentDepth < depthLimit)
-                    FindBestMove(afterMovePos, eval, currentDepth + 1);
+                if (currentDepth < maxDepth)
+                    eval = -Search(afterMovePos, afterMoveKey, -beta, -alpha, currentDepth + 1, maxDepth, nullptr);
                 else
-                    eval = afterMovePos.Evaluate();
+                    eval = -Quiesce(afterMovePos, -beta, -alpha, currentDepth + 1, state == Position::State::Check);
+                if (_checkLimits && Stopped())
+                    return 0;
             }
+        }
+
+        if (eval > bestMoveEval)
+        {
+            bestMoveEval = eval;
+            nodeBestMove = move;
 
-            /*
+            if (eval > alpha)
             {
-                auto moveStr = position.moveToString(move);
-                std::cerr << currentDepth << " " << moveStr << " " << eval << "\n";
-            */
+                alpha = eval;
+                if (pvNode)
+                    UpdatePv(currentDepth, move);
+                if (alpha >= beta)
+                {
+                    ++_stats.cutoffs;
+                    if (moveIdx == 0)
+                        ++_stats.firstMoveCutoffs;
+                    if (isMoveQuiet)
+                        UpdateQuietCutoff(position, move, currentDepth, draft);
+                    break;
+                }
+            }
+        }
+    }
+
+    TranspositionTable::Bound bound = TranspositionTable::ExactBound;
+    if (bestMoveEval <= originalAlpha)
+        bound = TranspositionTable::UpperBound;
+    else if (bestMoveEval >= beta)
+        bound = TranspositionTable::LowerBound;
+    if (!excludeMoves)
+        _tt->Store(key, PackedMove(nodeBestMove), ScoreToTT(bestMoveEval, currentDepth), draft, bound);
+
+    if (bestMove)
+        *bestMove = nodeBestMove;
+    return bestMoveEval;
+}
+
+// MVV-LVA: the most valuable victims first, the cheapest attackers first among them.
+// Queen promotions go with the captures of a queen
+static int MvvLva(const Position& position, Move move)
+{
+    const int victim = position.isMoveCapture(move) ?
+        std::max((int)Pawn, (int)position.square(move.fields.dst_row, move.fields.dst_col).piece()) : (int)Empty;
+    const int attacker = position.square(move.fields.src_row, move.fields.src_col).piece();
+    return victim * 8 - attacker + (move.fields.promoted_to == Queen ? Queen * 8 : 0);
+}
+
+// selection sort step: moves the best of the moves not tried yet to moveIdx. Most nodes
+// cut off after a move or two, so sorting the whole list up front would mostly be wasted
+Move MinimaxEngine::PickNext(std::vector<ScoredMove>* moves, size_t moveIdx)
+{
+    size_t bestIdx = moveIdx;
+    for (size_t m = moveIdx + 1; m < moves->size(); ++m)
+    {
+        if ((*moves)[m].score > (*moves)[bestIdx].score)
+            bestIdx = m;
+    }
+    std::swap((*moves)[moveIdx], (*moves)[bestIdx]);
+    return (*moves)[moveIdx].move;
+}
+
+void MinimaxEngine::ScoreMoves(const Position& position, const std::vector<Move>& moves, Move pvMove, int currentDepth,
+                               std::vector<ScoredMove>* scoredMoves) const
+{
+    // bands, from the first tried to the last: the hash/PV move, captures, promotions,
+    // killers and the other quiet moves by history. Captures and promotions go before the
+    // quiet moves, otherwise the search would postpone them forever as promoting right away
+    // evaluates the same as promoting in three moves. The captures losing material (by SEE)
+    // come after the other ones. Putting them after the quiet moves was tried, it costs nodes
+    // as those are often the tactical shots
+    static constexpr int pvMoveScore = 1 << 30;
+    static constexpr int captureScore = 1 << 24;
+    static constexpr int promotionScore = 1 << 23;
+    static constexpr int killerScore = 1 << 22;
+    static constexpr int goodCaptureBonus = 1 << 16;     // SEE >= 0
+
+    const int side = position.isWhiteTurn() ? 1 : 0;
+    const Move* killers = _killers[std::min(currentDepth, maxSearchDepth)];
+
+    scoredMoves->clear();
+    scoredMoves->reserve(moves.size());
+    for (const auto move: moves)
+    {
+        int score = 0;
+        if (move == pvMove)
+            score = pvMoveScore;
+        else if (position.isMoveCapture(move))
+            score = captureScore + (position.see(move) < 0 ? 0 : goodCaptureBonus) + MvvLva(position, move);
+        else if (move.fields.promoted_to > Pawn)
+            score = promotionScore + move.fields.promoted_to;
+        else if (move == killers[0])
+            score = killerScore;
+        else if (move == killers[1])
+            score = killerScore - 1;
+        else
+            score = _history[side][rowColToIdx(move.fields.src_row, move.fields.src_col)][rowColToIdx(move.fields.dst_row, move.fields.dst_col)];
+
+        scoredMoves->push_back(ScoredMove{ move, score });
+    }
+}
+
+void MinimaxEngine::UpdateQuietCutoff(const Position& position, Move move, int currentDepth, int draft)
+{
+    Move* killers = _killers[std::min(currentDepth, maxSearchDepth)];
+    if (killers[0] != move)
+    {
+        killers[1] = killers[0];
+        killers[0] = move;
+    }
+
+    // deeper cutoffs say more about the move. The table is scaled down before the scores
+    // can get anywhere near the killers
+    const int side = position.isWhiteTurn() ? 1 : 0;
+    int& history = _history[side][rowColToIdx(move.fields.src_row, move.fields.src_col)][rowColToIdx(move.fields.dst_row, move.fields.dst_col)];
+    history += (draft + 1) * (draft + 1);
+    if (history > historyLimit)
+        AgeHistory();
+}
+
+void MinimaxEngine::UpdatePv(int currentDepth, Move move)
+{
+    const Move* childPv = _pv[currentDepth + 1];
+    _pv[currentDepth][0] = move;
+    std::copy(childPv, childPv + _pvLength[currentDepth + 1], _pv[currentDepth] + 1);
+    _pvLength[currentDepth] = _pvLength[currentDepth + 1] + 1;
+}
+
+void MinimaxEngine::AgeHistory()
+{
+    for (auto& side: _history)
+    {
+        for (auto& src: side)
+        {
+            for (auto& entry: src)
+                entry /= 2;
+        }
+    }
+}
+
+void MinimaxEngine::NewSearch()
+{
+    for (auto& killers: _killers)
+        killers[0] = killers[1] = Move();
+    AgeHistory();
+}
 
-            if ((searchForMin && eval < bestMoveEval) || (!searchForMin && eval > bestMoveEval))
+int MinimaxEngine::Quiesce(const MinimaxPosition& position, int alpha, int beta, int currentDepth, bool inCheck, int quiescePly)
+{
+    int tbWdl = 0;
+    int tbDistance = 0;
+    if (_tablebases && _tablebases->probe(position, &tbWdl, &tbDistance))
+        return TablebaseScore(tbWdl, tbDistance, currentDepth);
+
+    // in check every evasion is searched and there's no standing pat, otherwise
+    // the side to move can take the static evaluation or try to improve it with a capture
+    inCheck = inCheck && quiescePly < quiesceCheckPlies && currentDepth < maxSearchDepth;
+    int bestEval = minEvaluation;
+    int standPat = 0;
+    std::vector<Move> moves;
+    if (inCheck)
+    {
+        moves = position.possibleMoves();
+        if (moves.empty())
+            return -(maxEvaluation - (currentDepth - 1));
+    }
+    else
+    {
+        standPat = StaticEvaluation(position, currentDepth);
+        if (standPat >= beta)
+            return standPat;
+        if (standPat > alpha)
+            alpha = standPat;
+        bestEval = standPat;
+
+        moves = position.possibleCaptures();
+    }
+
+    std::vector<ScoredMove> scoredMoves;
+    scoredMoves.reserve(moves.size());
+    for (const auto move: moves)
+        scoredMoves.push_back(ScoredMove{ move, MvvLva(position, move) });
+
+    for (size_t moveIdx = 0; moveIdx < scoredMoves.size(); ++moveIdx)
+    {
+        const Move move = PickNext(&scoredMoves, moveIdx);
+        if (!inCheck)
+        {
+            const int attacker = position.square(move.fields.src_row, move.fields.src_col).piece();
+            const int victim = std::max((int)Pawn, (int)position.square(move.fields.dst_row, move.fields.dst_col).piece());
+            const int promotionGain = (move.fields.promoted_to > Pawn) ? exchangeValue(move.fields.promoted_to) - PawnValue : 0;
+
+            // delta pruning: hopeless even if the piece comes for free
+            if (standPat + (exchangeValue(victim) + promotionGain + deltaMargin) * centipawnWeight <= alpha)
+                continue;
+
+            // captures losing material are not worth a look, only the ones by a more
+            // valuable piece can lose anything
+            if (exchangeValue(attacker) > exchangeValue(victim) && position.see(move) < 0)
+                continue;
+        }
+
+        const MinimaxPosition afterMovePos(position, move);
+        UpdateAccumulator(afterMovePos, currentDepth);
+        CountNode();
+
+        if (_checkLimits)
+        {
+            CheckLimits();
+            if (Stopped())
+                return 0;
+        }
+
+        const int eval = -Quiesce(afterMovePos, -beta, -alpha, currentDepth + 1, afterMovePos.isCheck(), quiescePly + 1);
+        if (_checkLimits && Stopped())
+            return 0;
+
+        if (eval > bestEval)
+        {
+            bestEval = eval;
+            if (eval > alpha)
             {
-                bestMoveEval = eval;
-                bestMove = move;
+                alpha = eval;
+                if (alpha >= beta)
+                    break;
             }
         }
     }
 
-    afterMoveEval = bestMoveEval;
-    return bestMove;
+    return bestEval;
 }
 
 }   // namespace fatpup
@@ -1,29 +1,224 @@
 #ifndef FATPUP_MINIMAX_H
 #define FATPUP_MINIMAX_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "fatpup/engine.h"
+#include "fatpup/tablebase.h"
+#include "nnue.h"
+#include "pawn_table.h"
+#include "transposition_table.h"
 
 namespace fatpup
 {
 
+class MinimaxPosition;
+
 class MinimaxEngine: public Engine
 {
 public:
     MinimaxEngine() {}
+    ~MinimaxEngine() override { Stop(); }
+    MinimaxEngine(const MinimaxEngine&) = delete;
+    MinimaxEngine& operator = (const MinimaxEngine&) = delete;
 
     int SetPosition(const Position& pos) override;
 
-    //void Start() override {}
-    //void Stop() override {}
-
     Move GetBestMove() override;
+    void Start(std::function<void(Move)> onBestMove) override;
+    void Stop() override;
+    void PonderHit() override;
+    Move GetPonderMove() const override { return _ponderMove; }
+    std::vector<SearchInfo> GetBestLines() const override { return _bestLines; }
     void MoveDone(Move move) override;
 
+    // all the search threads together
+    unsigned long long GetNodeCount() const override;
+
+    void SetSearchLimits(const SearchLimits& limits) override { _limits = limits; }
+    void SetInfoCallback(std::function<void(const SearchInfo&)> callback) override { _infoCallback = callback; }
+
+    // "Hash" (transposition table size in MB, 0 turns it off), "Clear Hash", "Threads", "MultiPV"
+    // (the number of lines GetBestMove() searches), "EvalFile" (NNUE network file, empty for the
+    // classic evaluation), "TablebasePath" (the directory of the endgame tables, empty for none)
+    // and the Selectivity switches
+    bool SetOption(const std::string& name, const std::string& value) override;
+
+    // all the moves are searched maxDepth (maxSearchDepth at most) plies deep, then the captures are followed until the
+    // position is quiet (see Quiesce()). afterMoveEval is from white's point of view, just like MinimaxPosition::Evaluate()
+    static constexpr int defaultSearchDepth = 3;
+    static constexpr int maxSearchDepth = 64;
+    static constexpr int maxThreads = 256;
+    static constexpr int maxMultiPv = 256;
+    Move FindBestMove(const Position& position, int& afterMoveEval, int currentDepth = 1, int maxDepth = defaultSearchDepth);
+
+    // the static evaluation the search takes at its leaves, white's point of view
+    static int Evaluate(const Position& position);
+
+    // move ordering quality: the share of the beta cutoffs produced by the first move tried,
+    // and the pawn table hit rate. Reset by GetBestMove(), accumulated over FindBestMove()
+    // calls just like the node count. Only the main search thread is accounted for
+    struct SearchStats
+    {
+        unsigned long long cutoffs = 0;
+        unsigned long long firstMoveCutoffs = 0;
+        unsigned long long pawnProbes = 0;
+        unsigned long long pawnHits = 0;
+    };
+    const SearchStats& GetSearchStats() const { return _stats; }
+
+    // the best line found by the last completed iteration of GetBestMove(), starting with the best move
+    const std::vector<Move>& GetPrincipalVariation() const { return _principalVariation; }
+
+    // the selective search techniques, each one can be turned off with SetOption() ("NullMove",
+    // "LateMoveReductions" and "Futility", "true" or "false") to see what it saves
+    struct Selectivity
+    {
+        bool nullMove = true;
+        bool lateMoveReductions = true;
+        bool futility = true;       // reverse futility included
+    };
+
 private:
-    static Move FindBestMove(const Position& position, int& afterMoveEval, int currentDepth);
+    // Lazy SMP helper: searches the same root as the engine that created it, sharing its
+    // hash table and stop flag. The helpers' results only reach the main thread through
+    // the hash table
+    MinimaxEngine(std::shared_ptr<TranspositionTable> tt, std::atomic<bool>* stop):
+        _tt(tt),
+        _stop(stop)
+    {
+    }
+
+    // GetBestMove() but the preparation, which Start() does before the thread is launched so
+    // that an early Stop() or PonderHit() is not lost
+    void PrepareSearch();
+    Move IterativeDeepening();
+    // one iteration of a root line, with an aspiration window around prevEval. bestMove is
+    // tried first, then set to the line's move
+    int SearchRoot(const MinimaxPosition& rootPos, unsigned long long rootKey, int depth, int prevEval, Move* bestMove);
+    // iterative deepening of a helper thread until maxDepth or the stop flag
+    void HelperSearch(int maxDepth, int helperIdx);
+
+    bool Stopped() const { return _stop->load(std::memory_order_relaxed); }
+    bool Pondering() const { return _pondering.load(std::memory_order_acquire); }
+    // time on the clock for this move, pondering doesn't count
+    long long ClockMs() const;
+    // only this thread writes its counter, the others just read it
+    void CountNode() { _nodes.store(_nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+    struct ScoredMove
+    {
+        Move move;
+        int score;
+    };
+
+    // orders the moves of a Search() node, see the implementation for the priorities
+    void ScoreMoves(const Position& position, const std::vector<Move>& moves, Move pvMove, int currentDepth,
+                    std::vector<ScoredMove>* scoredMoves) const;
+    static Move PickNext(std::vector<ScoredMove>* moves, size_t moveIdx);
+    // killer moves and history of a quiet move that caused a beta cutoff
+    void UpdateQuietCutoff(const Position& position, Move move, int currentDepth, int draft);
+    void AgeHistory();
+    // the PV of the node searched at currentDepth: the move, then the PV of the position it leads to
+    void UpdatePv(int currentDepth, Move move);
+    // ages the history and forgets the killers. The hash table is aged separately, it's shared
+    void NewSearch();
+
+    // negamax with alpha-beta pruning, returns the evaluation from the point of view of the side to move.
+    // A null window (beta = alpha + 1) only tells whether the score is above alpha, an open one
+    // also builds the node's PV. key is polyglotKey(position). pvMove (the best move of the previous iteration) is tried
+    // first, the hash table's best move is the default. nullMoveAllowed is false right after a null move
+    int Search(const MinimaxPosition& position, unsigned long long key, int alpha, int beta, int currentDepth, int maxDepth,
+               Move* bestMove, Move pvMove = Move(), bool nullMoveAllowed = true);
+
+    // captures only (all the moves when in check, for the first few plies) until the position is
+    // quiet, so that the evaluation is never taken with pieces hanging. quiescePly counts the
+    // plies since the full width search. Returns the side to move's point of view
+    int Quiesce(const MinimaxPosition& position, int alpha, int beta, int currentDepth, bool inCheck, int quiescePly = 0);
+
+    // NNUE evaluation: the network is shared with the helpers, every search thread keeps an
+    // accumulator per ply, the one of the position searched at currentDepth is [currentDepth - 1]
+    static constexpr int accumulatorPlies = 4 * maxSearchDepth;
+    void SetNetwork(std::shared_ptr<const NnueNetwork> network);
+    void RefreshAccumulator(const MinimaxPosition& position, int currentDepth);
+    // the accumulator of a position made from the one searched at currentDepth
+    void UpdateAccumulator(const MinimaxPosition& afterMovePos, int currentDepth);
+    // from the point of view of the side to move, the network's if there's one
+    int StaticEvaluation(const MinimaxPosition& position, int currentDepth);
+    // the position's pawn structure evaluation, computed and stored in the pawn table if it's not there
+    const PawnTable::Entry& PawnStructure(const MinimaxPosition& position);
+
+    // raises the stop flag if the deadline or the node limit is reached
+    void CheckLimits();
+
+    // the line goes on with the tablebases' moves until the mate, for a root in the tablebases
+    void ExtendPvFromTablebases(std::vector<Move>* pv) const;
 
     Position _pos;
     Move _bestMove;
+    std::atomic<unsigned long long> _nodes{0};
+    std::shared_ptr<TranspositionTable> _tt = std::make_shared<TranspositionTable>();
+    SearchStats _stats;
+    std::vector<std::unique_ptr<MinimaxEngine>> _helpers;
+    std::shared_ptr<const NnueNetwork> _network;
+    std::vector<NnueNetwork::Accumulator> _accumulators;
+    PawnTable _pawnTable;
+    Selectivity _selectivity;
+    // shared with the helpers. The positions in the tables are not searched, their scores are exact
+    std::shared_ptr<const Tablebases> _tablebases;
+
+    // two killer moves per ply and the butterfly history (side, source, destination)
+    static constexpr int historyLimit = 1 << 20;
+    Move _killers[maxSearchDepth + 1][2];
+    int _history[2][BOARD_SIZE * BOARD_SIZE][BOARD_SIZE * BOARD_SIZE] = {};
+
+    // triangular PV table: _pv[currentDepth] holds _pvLength[currentDepth] moves, the line of the
+    // PV node searched at that depth. Quiesce() doesn't add to the lines
+    Move _pv[maxSearchDepth + 2][maxSearchDepth + 2];
+    int _pvLength[maxSearchDepth + 2] = {};
+    std::vector<Move> _principalVariation;
+
+    // MultiPV: the lines of the last completed iteration, and the root moves Search() leaves out
+    struct RootLine
+    {
+        int eval;
+        std::vector<Move> pv;
+    };
+    int _multiPv = 1;
+    std::vector<SearchInfo> _bestLines;
+    std::vector<Move> _excludedRootMoves;
+
+    SearchLimits _limits;
+    std::function<void(const SearchInfo&)> _infoCallback;
+
+    // iterative deepening state. The clock is only looked at every timeCheckInterval nodes
+    static constexpr unsigned long long timeCheckInterval = 1024;
+    bool _checkLimits = false;
+    // the main thread's flag is also the helpers' one
+    std::atomic<bool> _stopFlag{false};
+    std::atomic<bool>* _stop = &_stopFlag;
+    bool _hasDeadline = false;
+    int _softMs = 0;
+    int _hardMs = 0;
+    int _depthLimit = maxSearchDepth;
+    int _completedDepth = 0;
+    // PonderHit() restarts the clock from the UCI thread
+    std::atomic<std::chrono::steady_clock::rep> _clockStart{0};
+    std::atomic<bool> _pondering{false};
+    Move _ponderMove;
+
+    // Start()/Stop(). The stop flag is also raised by the search itself when it's done, so
+    // Stop() has a flag of its own for the infinite and pondering searches to wait for
+    std::thread _searchThread;
+    std::mutex _stopMutex;
+    std::condition_variable _searchEvent;
+    bool _stopCalled = false;
 };
 
 }   // namespace fatpup
@@ -0,0 +1,265 @@
+#include <cstring>
+#include <fstream>
+#include <random>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+#include "fatpup/mapped_file.h"
+
+#include "nnue.h"
+
+namespace fatpup
+{
+
+static constexpr char networkMagic[4] = { 'F', 'P', 'N', 'N' };
+static constexpr unsigned int networkVersion = 1;
+
+const char* const NnueNetwork::defaultFile = "fatpup.nnue";
+
+static constexpr size_t networkFileSize = sizeof(networkMagic) + 4 + 4 +
+    (size_t)NnueNetwork::inputSize * NnueNetwork::hiddenSize * 2 + NnueNetwork::hiddenSize * 2 + 2 * NnueNetwork::hiddenSize + 4;
+
+static unsigned int readU32(const unsigned char** data)
+{
+    const unsigned char* bytes = *data;
+    *data += 4;
+    return (unsigned int)bytes[0] | ((unsigned int)bytes[1] << 8) | ((unsigned int)bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+}
+
+static int16_t readI16(const unsigned char** data)
+{
+    const unsigned char* bytes = *data;
+    *data += 2;
+    return (int16_t)(uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+static void writeU32(std::vector<unsigned char>* out, unsigned int value)
+{
+    for (int b = 0; b < 4; ++b)
+        out->push_back((unsigned char)(value >> (b * 8)));
+}
+
+static void writeI16(std::vector<unsigned char>* out, int16_t value)
+{
+    out->push_back((unsigned char)((uint16_t)value & 0xff));
+    out->push_back((unsigned char)((uint16_t)value >> 8));
+}
+
+// dst = src - the removed rows + the added ones, hiddenSize values wrapping around like the SIMD adds do.
+// src may be dst
+static void applyRows(const int16_t* src, int16_t* dst, const int16_t* const* removed, int numRemoved,
+                      const int16_t* const* added, int numAdded)
+{
+#if defined(__AVX2__)
+    for (int i = 0; i < NnueNetwork::hiddenSize; i += 16)
+    {
+        __m256i values = _mm256_loadu_si256((const __m256i*)(src + i));
+        for (int r = 0; r < numRemoved; ++r)
+            values = _mm256_sub_epi16(values, _mm256_loadu_si256((const __m256i*)(removed[r] + i)));
+        for (int a = 0; a < numAdded; ++a)
+            values = _mm256_add_epi16(values, _mm256_loadu_si256((const __m256i*)(added[a] + i)));
+        _mm256_storeu_si256((__m256i*)(dst + i), values);
+    }
+#elif defined(__SSE2__)
+    // the x86-64 baseline, the adds don't need more
+    for (int i = 0; i < NnueNetwork::hiddenSize; i += 8)
+    {
+        __m128i values = _mm_loadu_si128((const __m128i*)(src + i));
+        for (int r = 0; r < numRemoved; ++r)
+            values = _mm_sub_epi16(values, _mm_loadu_si128((const __m128i*)(removed[r] + i)));
+        for (int a = 0; a < numAdded; ++a)
+            values = _mm_add_epi16(values, _mm_loadu_si128((const __m128i*)(added[a] + i)));
+        _mm_storeu_si128((__m128i*)(dst + i), values);
+    }
+#else
+    // a contiguous pass per row is what the compiler vectorizes, a pass over the rows per value isn't
+    if (dst != src)
+        std::memcpy(dst, src, NnueNetwork::hiddenSize * sizeof(int16_t));
+    for (int r = 0; r < numRemoved; ++r)
+    {
+        const int16_t* row = removed[r];
+        for (int i = 0; i < NnueNetwork::hiddenSize; ++i)
+            dst[i] = (int16_t)(uint16_t)((uint16_t)dst[i] - (uint16_t)row[i]);
+    }
+    for (int a = 0; a < numAdded; ++a)
+    {
+        const int16_t* row = added[a];
+        for (int i = 0; i < NnueNetwork::hiddenSize; ++i)
+            dst[i] = (int16_t)(uint16_t)((uint16_t)dst[i] + (uint16_t)row[i]);
+    }
+#endif
+}
+
+// clipped ReLU of the accumulator dotted with the output weights
+static int32_t outputDot(const int16_t* acc, const int8_t* weights)
+{
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i activationMax = _mm256_set1_epi16(NnueNetwork::activationMax);
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = zero;
+    for (int i = 0; i < NnueNetwork::hiddenSize; i += 32)
+    {
+        const __m256i low = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i*)(acc + i)), zero), activationMax);
+        const __m256i high = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i*)(acc + i + 16)), zero), activationMax);
+        // packus works within the 128-bit lanes, the permutation puts the bytes back in order
+        const __m256i activations = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xd8);
+        // u8 * i8 pairs fit int16: 2 * 127 * 128 < 32768
+        const __m256i products = _mm256_maddubs_epi16(activations, _mm256_loadu_si256((const __m256i*)(weights + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+    __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4e));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xb1));
+    return _mm_cvtsi128_si32(sum128);
+#elif defined(__SSSE3__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i activationMax = _mm_set1_epi16(NnueNetwork::activationMax);
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = zero;
+    for (int i = 0; i < NnueNetwork::hiddenSize; i += 16)
+    {
+        const __m128i low = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i*)(acc + i)), zero), activationMax);
+        const __m128i high = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i*)(acc + i + 8)), zero), activationMax);
+        const __m128i products = _mm_maddubs_epi16(_mm_packus_epi16(low, high), _mm_loadu_si128((const __m128i*)(weights + i)));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+#elif defined(__SSE2__)
+    // no u8 * i8 multiply: the weights are widened to int16 instead
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i activationMax = _mm_set1_epi16(NnueNetwork::activationMax);
+    __m128i sum = zero;
+    for (int i = 0; i < NnueNetwork::hiddenSize; i += 8)
+    {
+        const __m128i activations = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i*)(acc + i)), zero), activationMax);
+        const __m128i bytes = _mm_loadl_epi64((const __m128i*)(weights + i));
+        const __m128i weights16 = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(activations, weights16));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < NnueNetwork::hiddenSize; ++i)
+    {
+        const int activation = (acc[i] < 0) ? 0 : (acc[i] > NnueNetwork::activationMax) ? NnueNetwork::activationMax : acc[i];
+        sum += activation * weights[i];
+    }
+    return sum;
+#endif
+}
+
+NnueNetwork::NnueNetwork():
+    _featureWeights((size_t)inputSize * hiddenSize),
+    _featureBiases(hiddenSize),
+    _outputWeights(2 * hiddenSize)
+{
+}
+
+bool NnueNetwork::Load(const std::string& path)
+{
+    MappedFile file;
+    if (!file.open(path) || file.size() != networkFileSize || std::memcmp(file.data(), networkMagic, sizeof(networkMagic)) != 0)
+        return false;
+
+    const unsigned char* data = file.data() + sizeof(networkMagic);
+    if (readU32(&data) != networkVersion || readU32(&data) != (unsigned int)hiddenSize)
+        return false;
+
+    for (auto& weight: _featureWeights)
+        weight = readI16(&data);
+    for (auto& bias: _featureBiases)
+        bias = readI16(&data);
+    for (auto& weight: _outputWeights)
+        weight = (int8_t)*data++;
+    _outputBias = (int32_t)readU32(&data);
+    return true;
+}
+
+bool NnueNetwork::Save(const std::string& path) const
+{
+    std::vector<unsigned char> out(networkMagic, networkMagic + sizeof(networkMagic));
+    out.reserve(networkFileSize);
+    writeU32(&out, networkVersion);
+    writeU32(&out, hiddenSize);
+    for (const auto weight: _featureWeights)
+        writeI16(&out, weight);
+    for (const auto bias: _featureBiases)
+        writeI16(&out, bias);
+    for (const auto weight: _outputWeights)
+        out.push_back((unsigned char)weight);
+    writeU32(&out, (unsigned int)_outputBias);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)out.data(), (std::streamsize)out.size());
+    return file.good();
+}
+
+void NnueNetwork::Randomize(unsigned int seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> featureWeight(-24, 24);
+    std::uniform_int_distribution<int> featureBias(0, 64);
+    std::uniform_int_distribution<int> outputWeight(-64, 64);
+
+    for (auto& weight: _featureWeights)
+        weight = (int16_t)featureWeight(random);
+    for (auto& bias: _featureBiases)
+        bias = (int16_t)featureBias(random);
+    for (auto& weight: _outputWeights)
+        weight = (int8_t)outputWeight(random);
+    _outputBias = 0;
+}
+
+void NnueNetwork::Refresh(const Position& pos, Accumulator* acc) const
+{
+    for (int perspective = 0; perspective < 2; ++perspective)
+    {
+        int16_t* values = acc->values[perspective];
+        std::memcpy(values, _featureBiases.data(), sizeof(acc->values[perspective]));
+        for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+        {
+            const int piece = pos.square(s_idx / BOARD_SIZE, s_idx % BOARD_SIZE).pieceWithColor();
+            if (piece == Empty)
+                continue;
+
+            const int16_t* row = &_featureWeights[(size_t)FeatureIndex(perspective, piece, s_idx) * hiddenSize];
+            applyRows(values, values, nullptr, 0, &row, 1);
+        }
+    }
+}
+
+void NnueNetwork::Update(const Accumulator& prev, const SquareChange* changes, int numChanges, Accumulator* acc) const
+{
+    const int16_t* removed[maxSquareChanges];
+    const int16_t* added[maxSquareChanges];
+    for (int perspective = 0; perspective < 2; ++perspective)
+    {
+        int numRemoved = 0;
+        int numAdded = 0;
+        for (int c = 0; c < numChanges; ++c)
+        {
+            if (changes[c].before != Empty)
+                removed[numRemoved++] = &_featureWeights[(size_t)FeatureIndex(perspective, changes[c].before, changes[c].square) * hiddenSize];
+            if (changes[c].after != Empty)
+                added[numAdded++] = &_featureWeights[(size_t)FeatureIndex(perspective, changes[c].after, changes[c].square) * hiddenSize];
+        }
+        applyRows(prev.values[perspective], acc->values[perspective], removed, numRemoved, added, numAdded);
+    }
+}
+
+int NnueNetwork::Evaluate(const Accumulator& acc, bool whiteTurn) const
+{
+    const int16_t* own = acc.values[whiteTurn ? 0 : 1];
+    const int16_t* their = acc.values[whiteTurn ? 1 : 0];
+    const int32_t sum = _outputBias + outputDot(own, _outputWeights.data()) + outputDot(their, _outputWeights.data() + hiddenSize);
+    return sum / outputDivisor;
+}
+
+}   // namespace fatpup
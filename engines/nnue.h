@@ -0,0 +1,85 @@
+#ifndef FATPUP_NNUE_H
+#define FATPUP_NNUE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fatpup/position.h"
+
+namespace fatpup
+{
+
+// a square a move has changed, the pieces are pieceWithColor() values (Empty if none)
+struct SquareChange
+{
+    unsigned char square;
+    unsigned char before;
+    unsigned char after;
+};
+
+// source, destination, the pawn taken en passant, the castling rook's two squares
+static constexpr int maxSquareChanges = 5;
+
+// Efficiently updatable neural network (NNUE) evaluation. The 768 inputs are the
+// piece-square features (6 pieces x 2 colors x 64 squares), seen from each side: "own" and
+// "their" pieces, the board mirrored vertically for black. Each side's features are summed
+// into a 256-wide int16 accumulator, which a move only changes by the few features of the
+// squares it touches. The output layer takes both accumulators through a clipped ReLU
+// (0..127, as uint8), side to move first, and dots them with int8 weights.
+//
+// The kernels are AVX2 or SSSE3 if the compiler targets them (see BUILD_NATIVE), SSE2 (the
+// x86-64 baseline) by default, plain C++ otherwise; all of them give the same results.
+//
+// Weights file, little-endian: "FPNN", version (u32), hidden size (u32), feature weights
+// (int16 [768][256]), feature biases (int16 [256]), output weights (int8 [512]), output
+// bias (int32). Feature index: (own pieces 0..5, their pieces 6..11) * 64 + square
+class NnueNetwork
+{
+public:
+    static constexpr int inputSize = 2 * 6 * BOARD_SIZE * BOARD_SIZE;
+    static constexpr int hiddenSize = 256;
+    static constexpr int activationMax = 127;
+    // the output layer's sum over this is the evaluation (32 per pawn like MinimaxPosition)
+    static constexpr int outputDivisor = 64;
+
+    // the file Engine::Create("nnue") loads
+    static const char* const defaultFile;
+
+    struct Accumulator
+    {
+        int16_t values[2][hiddenSize];  // [White / Black perspective]
+    };
+
+    NnueNetwork();
+
+    // false if the file can't be read or is not a network of this size, the network is unchanged then
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+    // weights for the tests and the benchmarks, the same seed gives the same network
+    void Randomize(unsigned int seed);
+
+    void Refresh(const Position& pos, Accumulator* acc) const;
+    // acc = prev plus the changes of a move (up to maxSquareChanges), acc may be prev
+    void Update(const Accumulator& prev, const SquareChange* changes, int numChanges, Accumulator* acc) const;
+    // from the point of view of the side to move
+    int Evaluate(const Accumulator& acc, bool whiteTurn) const;
+
+private:
+    // perspective 0 is white's, 1 is black's
+    static int FeatureIndex(int perspective, int piece, int s_idx)
+    {
+        const int own = ((piece & ColorMask) == White) == (perspective == 0);
+        const int square = perspective ? (s_idx ^ ((BOARD_SIZE - 1) * BOARD_SIZE)) : s_idx;
+        return ((own ? 0 : 6) + (piece & PieceMask) - Pawn) * BOARD_SIZE * BOARD_SIZE + square;
+    }
+
+    std::vector<int16_t> _featureWeights;   // [inputSize][hiddenSize]
+    std::vector<int16_t> _featureBiases;
+    std::vector<int8_t> _outputWeights;     // [2 * hiddenSize], side to move first
+    int32_t _outputBias = 0;
+};
+
+}   // namespace fatpup
+
+#endif // FATPUP_NNUE_H
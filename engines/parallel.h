@@ -0,0 +1,46 @@
+#ifndef FATPUP_PARALLEL_H
+#define FATPUP_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace fatpup
+{
+
+inline unsigned int DefaultThreadCount()
+{
+    const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads ? hardwareThreads : 1;
+}
+
+// Runs fn(itemIdx, threadIdx) for every item in [0, numItems) on a pool of numThreads
+// threads. Items are handed out one at a time from a shared counter, so a few slow items
+// don't leave the other threads idle. threadIdx can be used to index per-thread state
+template <class Fn>
+void ParallelFor(size_t numItems, unsigned int numThreads, Fn fn)
+{
+    numThreads = std::max(1u, std::min<unsigned int>(numThreads, (unsigned int)std::max<size_t>(numItems, 1)));
+
+    std::atomic<size_t> nextItem(0);
+    auto worker = [&](unsigned int threadIdx)
+    {
+        for (size_t itemIdx = nextItem++; itemIdx < numItems; itemIdx = nextItem++)
+            fn(itemIdx, threadIdx);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (unsigned int t = 1; t < numThreads; ++t)
+        threads.emplace_back(worker, t);
+
+    worker(0);
+
+    for (auto& thread: threads)
+        thread.join();
+}
+
+}   // namespace fatpup
+
+#endif // FATPUP_PARALLEL_H
@@ -0,0 +1,47 @@
+#ifndef FATPUP_PAWN_TABLE_H
+#define FATPUP_PAWN_TABLE_H
+
+#include <vector>
+
+namespace fatpup
+{
+
+// Direct-mapped cache of the pawn structure evaluation, indexed by the pawn key (the pawns'
+// part of the Zobrist key). The pawns change in few of the moves, so most of the positions
+// a search evaluates find their pawns here. Every search thread has a table of its own
+class PawnTable
+{
+public:
+    struct Entry
+    {
+        unsigned long long key = 0;
+        bool used = false;              // a position with no pawns has the key 0
+        int score = 0;                  // doubled, isolated and passed pawns, white's point of view
+        unsigned long long whitePassed = 0;     // passed pawns, bit n is square n
+        unsigned long long blackPassed = 0;
+    };
+
+    static constexpr size_t defaultEntries = 8192;
+
+    explicit PawnTable(size_t entries = defaultEntries):
+        _entries(entries)
+    {
+    }
+
+    // true if the entry of key's slot holds key's pawns, otherwise the entry is the one to
+    // fill in (the former contents are lost)
+    bool Probe(unsigned long long key, Entry** entry)
+    {
+        *entry = &_entries[key % _entries.size()];
+        return (*entry)->used && (*entry)->key == key;
+    }
+
+    void Clear() { _entries.assign(_entries.size(), Entry()); }
+
+private:
+    std::vector<Entry> _entries;
+};
+
+}   // namespace fatpup
+
+#endif // FATPUP_PAWN_TABLE_H
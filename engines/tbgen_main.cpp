@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "fatpup/tablebase.h"
+#include "parallel.h"
+
+namespace
+{
+
+void usage()
+{
+    std::cerr << "usage: fatpup_tbgen [-t threads] [-p pieces] [-f] -o directory [material...]\n"
+                 "builds the tables of up to -p pieces (4 by default) or the ones named (e.g. KQvKR),\n"
+                 "the tables already in the directory are kept unless -f is given\n";
+}
+
+}   // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned int numThreads = fatpup::DefaultThreadCount();
+    int maxPieces = fatpup::Tablebases::maxPieces;
+    bool force = false;
+    std::string outDir;
+    std::vector<std::string> materials;
+
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string arg = argv[a];
+        if (arg == "-t" && a + 1 < argc)
+            numThreads = (unsigned int)std::max(1, std::atoi(argv[++a]));
+        else if (arg == "-p" && a + 1 < argc)
+            maxPieces = std::atoi(argv[++a]);
+        else if (arg == "-f")
+            force = true;
+        else if (arg == "-o" && a + 1 < argc)
+            outDir = argv[++a];
+        else if (!arg.empty() && arg[0] != '-')
+            materials.push_back(arg);
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (outDir.empty() || maxPieces < 3 || maxPieces > fatpup::Tablebases::maxPieces)
+    {
+        usage();
+        return 1;
+    }
+
+    // the tables are built in the order they depend on each other, the named ones need the
+    // tables they lead to in the directory already
+    const auto allMaterials = fatpup::Tablebases::materials(maxPieces);
+    if (materials.empty())
+        materials = allMaterials;
+    for (const auto& material: materials)
+    {
+        if (std::find(allMaterials.begin(), allMaterials.end(), material) == allMaterials.end())
+        {
+            std::cerr << "not a table of up to " << maxPieces << " pieces: " << material << "\n";
+            return 1;
+        }
+    }
+
+    fatpup::Tablebases tablebases;
+    tablebases.open(outDir);
+    const auto start = std::chrono::steady_clock::now();
+    size_t built = 0;
+    for (const auto& material: allMaterials)
+    {
+        if (std::find(materials.begin(), materials.end(), material) == materials.end() || (!force && tablebases.hasTable(material)))
+            continue;
+
+        const auto tableStart = std::chrono::steady_clock::now();
+        fatpup::TablebaseGenerator generator(tablebases);
+        if (!generator.generate(material, numThreads))
+        {
+            std::cerr << material << ": cannot generate, the tables it leads to are missing\n";
+            return 1;
+        }
+
+        const std::string path = outDir + "/" + material + fatpup::Tablebases::fileExtension;
+        std::ofstream out(path, std::ios::binary);
+        if (!out || !generator.write(out))
+        {
+            std::cerr << "cannot write " << path << "\n";
+            return 1;
+        }
+        out.close();
+        if (!tablebases.add(path))
+        {
+            std::cerr << "cannot read " << path << " back\n";
+            return 1;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tableStart).count();
+        std::cout << material << ": " << generator.positionCount() << " positions, " << generator.winCount() << " won, " <<
+            generator.lossCount() << " lost, longest mate " << generator.longestMate() << " plies, " <<
+            (unsigned long long)(seconds * 1000) << " ms\n";
+        ++built;
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << built << " tables built, " << tablebases.tableCount() << " in " << outDir << ", " <<
+        (unsigned long long)(seconds * 1000) << " ms\n";
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <climits>
+#include <cstdint>
+#include <new>
+
+#include "transposition_table.h"
+
+namespace fatpup
+{
+
+static constexpr size_t cacheLineSize = 64;
+
+// the number of entries HashFull() looks at
+static constexpr size_t hashFullSample = 1000;
+
+TranspositionTable::TranspositionTable(unsigned int sizeMb)
+{
+    Resize(sizeMb);
+}
+
+void TranspositionTable::Resize(unsigned int sizeMb)
+{
+    _memory.reset();
+    _buckets = nullptr;
+    _bucketCount = 0;
+
+    if (sizeMb > maxSizeMb)
+        sizeMb = maxSizeMb;
+
+    const size_t maxBuckets = (size_t)sizeMb * 1024 * 1024 / sizeof(Bucket);
+    if (maxBuckets == 0)
+        return;
+
+    // the bucket index is then just the lower bits of the key
+    _bucketCount = 1;
+    while (_bucketCount * 2 <= maxBuckets)
+        _bucketCount *= 2;
+
+    _memory.reset(new unsigned char[_bucketCount * sizeof(Bucket) + cacheLineSize - 1]);
+    const uintptr_t address = (uintptr_t)_memory.get();
+    _buckets = (Bucket*)((address + cacheLineSize - 1) & ~(uintptr_t)(cacheLineSize - 1));
+    for (size_t b = 0; b < _bucketCount; ++b)
+        new (&_buckets[b]) Bucket();
+
+    Clear();
+}
+
+void TranspositionTable::Clear()
+{
+    for (size_t b = 0; b < _bucketCount; ++b)
+    {
+        for (auto& slot: _buckets[b].slots)
+        {
+            slot.check.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    _age = 0;
+}
+
+bool TranspositionTable::Probe(unsigned long long key, Entry* entry) const
+{
+    if (!_bucketCount)
+        return false;
+
+    const Bucket& bucket = _buckets[key & (_bucketCount - 1)];
+    for (const auto& slot: bucket.slots)
+    {
+        const unsigned long long data = slot.data.load(std::memory_order_relaxed);
+        const unsigned long long check = slot.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != key || BoundOf(data) == NoBound)
+            continue;
+
+        entry->move = PackedMove((unsigned short)(data & 0xffff));
+        entry->score = (int)(unsigned int)(data >> 16);
+        entry->draft = DraftOf(data);
+        entry->bound = BoundOf(data);
+        return true;
+    }
+
+    return false;
+}
+
+void TranspositionTable::Store(unsigned long long key, PackedMove move, int score, int draft, Bound bound)
+{
+    if (!_bucketCount)
+        return;
+
+    // the same position is overwritten in place, otherwise the least valuable entry goes:
+    // empty ones first, then the shallowest ones with the entries of the previous
+    // searches counting as several plies shallower per search
+    Bucket& bucket = _buckets[key & (_bucketCount - 1)];
+    Slot* victim = nullptr;
+    int victimValue = INT_MAX;
+    for (auto& slot: bucket.slots)
+    {
+        const unsigned long long data = slot.data.load(std::memory_order_relaxed);
+        const unsigned long long check = slot.check.load(std::memory_order_relaxed);
+        if (BoundOf(data) != NoBound && (check ^ data) == key)
+        {
+            // a deeper bound from this very search is worth more than a shallower one
+            if (bound != ExactBound && AgeOf(data) == _age && DraftOf(data) > draft)
+                return;
+            // a result with no move doesn't make the known best move any worse
+            if (move.isEmpty())
+                move = PackedMove((unsigned short)(data & 0xffff));
+            victim = &slot;
+            break;
+        }
+
+        const int value = (BoundOf(data) == NoBound) ? INT_MIN : DraftOf(data) - 8 * (int)((_age - AgeOf(data)) & ageMask);
+        if (value < victimValue)
+        {
+            victimValue = value;
+            victim = &slot;
+        }
+    }
+
+    const unsigned long long data = Pack(move, score, draft, bound, _age);
+    victim->check.store(key ^ data, std::memory_order_relaxed);
+    victim->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::HashFull() const
+{
+    const size_t sample = (EntryCount() < hashFullSample) ? EntryCount() : hashFullSample;
+    if (!sample)
+        return 0;
+
+    size_t used = 0;
+    for (size_t e = 0; e < sample; ++e)
+    {
+        const unsigned long long data = _buckets[e / bucketEntries].slots[e % bucketEntries].data.load(std::memory_order_relaxed);
+        if (BoundOf(data) != NoBound && AgeOf(data) == _age)
+            ++used;
+    }
+
+    return (int)(used * 1000 / sample);
+}
+
+}   // namespace fatpup
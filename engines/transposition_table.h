@@ -0,0 +1,91 @@
+#ifndef FATPUP_TRANSPOSITION_TABLE_H
+#define FATPUP_TRANSPOSITION_TABLE_H
+
+#include <atomic>
+#include <memory>
+
+#include "fatpup/packed_move.h"
+
+namespace fatpup
+{
+
+// Fixed-size hash table of search results shared by any number of search threads with no
+// locking. Every entry is two 64-bit words, the data and the key XORed with the data, both
+// written and read independently. A read racing with a write (or a torn entry) then fails
+// the key check and is simply a miss, so the worst a race can do is lose a result.
+// Entries are grouped by four into cache-line-sized buckets, a position can only be
+// stored in the bucket its key points to. Resize() and Clear() must not overlap with searches
+class TranspositionTable
+{
+public:
+    enum Bound
+    {
+        NoBound = 0,
+        UpperBound = 1,     // failed low, the score is at most this
+        LowerBound = 2,     // failed high (cutoff), the score is at least this
+        ExactBound = 3
+    };
+
+    struct Entry
+    {
+        PackedMove move;
+        int score = 0;
+        int draft = 0;      // remaining depth the score was searched with
+        Bound bound = NoBound;
+    };
+
+    static constexpr unsigned int defaultSizeMb = 16;
+    static constexpr unsigned int maxSizeMb = 4096;
+
+    explicit TranspositionTable(unsigned int sizeMb = defaultSizeMb);
+
+    // rounded down to a power of two number of buckets, 0 disables the table. Drops all the entries
+    void Resize(unsigned int sizeMb);
+    void Clear();
+    // entries of the previous searches are replaced first
+    void NewSearch() { _age = (_age + 1) & ageMask; }
+
+    bool Probe(unsigned long long key, Entry* entry) const;
+    void Store(unsigned long long key, PackedMove move, int score, int draft, Bound bound);
+
+    // permille of the entries used by the current search, as UCI "info hashfull" wants it
+    int HashFull() const;
+    size_t EntryCount() const { return _bucketCount * bucketEntries; }
+
+private:
+    static constexpr size_t bucketEntries = 4;
+    static constexpr unsigned int ageMask = 63;
+
+    struct Slot
+    {
+        std::atomic<unsigned long long> check;  // key ^ data
+        std::atomic<unsigned long long> data;
+    };
+
+    struct Bucket
+    {
+        Slot slots[bucketEntries];
+    };
+
+    static_assert(sizeof(Bucket) == 64, "a bucket shall take exactly one cache line");
+
+    // data layout: move (bits 0..15), score (16..47), draft + 128 (48..55), bound (56..57), age (58..63)
+    static unsigned long long Pack(PackedMove move, int score, int draft, Bound bound, unsigned int age)
+    {
+        return move.raw() | ((unsigned long long)(unsigned int)score << 16) | ((unsigned long long)(draft + 128) << 48) |
+            ((unsigned long long)bound << 56) | ((unsigned long long)age << 58);
+    }
+    static int DraftOf(unsigned long long data) { return (int)((data >> 48) & 0xff) - 128; }
+    static Bound BoundOf(unsigned long long data) { return (Bound)((data >> 56) & 3); }
+    static unsigned int AgeOf(unsigned long long data) { return (unsigned int)(data >> 58); }
+
+    // the buckets are aligned to the cache line within _memory
+    std::unique_ptr<unsigned char[]> _memory;
+    Bucket* _buckets = nullptr;
+    size_t _bucketCount = 0;
+    unsigned int _age = 0;
+};
+
+}   // namespace fatpup
+
+#endif // FATPUP_TRANSPOSITION_TABLE_H
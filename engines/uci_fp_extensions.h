@@ -2,11 +2,15 @@
 #define FATPUP_UCI_FP_EXTENSIONS_H
 
 #include <cctype>
+#include <future>
+#include <memory>
 #include <ostream>
+#include <random>
 #include <string>
 #include <vector>
 
 #include "fatpup/engine.h"
+#include "fatpup/polyglot.h"
 
 namespace fatpup
 {
@@ -123,7 +127,33 @@ inline bool emitGameOverIfAny(const fatpup::Position& pos, std::ostream& out)
     return true;
 }
 
-inline std::string emitBestMove(fatpup::Position* pos, fatpup::Engine* engine, std::ostream& out)
+// weighted random book move, empty if there's no book or the position is not in it
+inline fatpup::Move bookMove(const fatpup::Position& pos, const fatpup::PolyglotBook* book)
+{
+    if (!book || !book->isOpen())
+        return fatpup::Move();
+
+    static std::mt19937 random((std::random_device())());
+    return book->pickMove(pos, (unsigned int)random());
+}
+
+// the bestmove of a finished search, pos is the position after it
+inline std::string emitSearchedMove(const fatpup::Position& pos, fatpup::Move bestMove, std::ostream& out,
+                                    fatpup::Move ponderMove = fatpup::Move())
+{
+    const std::string bestMoveUci = moveToUci(bestMove);
+    out << "bestmove " << bestMoveUci;
+    if (!ponderMove.isEmpty())
+        out << " ponder " << moveToUci(ponderMove);
+    out << "\n";
+    emitGameOverIfAny(pos, out);
+    return bestMoveUci;
+}
+
+// the answers that need no search: "0000" if the game is over or the book move, makes the book
+// move in pos and in the engine. Returns an empty string and prints nothing if there's none
+inline std::string emitMoveWithoutSearch(fatpup::Position* pos, fatpup::Engine* engine, std::ostream& out,
+                                         const fatpup::PolyglotBook* book)
 {
     if (emitGameOverIfAny(*pos, out))
     {
@@ -131,14 +161,118 @@ inline std::string emitBestMove(fatpup::Position* pos, fatpup::Engine* engine, s
         return "0000";
     }
 
+    // the engine's position is kept in sync the same way GetBestMove() does it
+    const fatpup::Move bestMove = bookMove(*pos, book);
+    if (bestMove.isEmpty())
+        return std::string();
+
+    out << "info string book move\n";
+    engine->MoveDone(bestMove);
+    *pos += bestMove;
+    return emitSearchedMove(*pos, bestMove, out);
+}
+
+inline std::string emitBestMove(fatpup::Position* pos, fatpup::Engine* engine, std::ostream& out,
+                                const fatpup::PolyglotBook* book = nullptr)
+{
+    const std::string immediateMove = emitMoveWithoutSearch(pos, engine, out, book);
+    if (!immediateMove.empty())
+        return immediateMove;
+
     const fatpup::Move bestMove = engine->GetBestMove();
     if (!bestMove.isEmpty())
         *pos += bestMove;
+    return emitSearchedMove(*pos, bestMove, out);
+}
 
-    const std::string bestMoveUci = moveToUci(bestMove);
-    out << "bestmove " << bestMoveUci << "\n";
-    emitGameOverIfAny(*pos, out);
-    return bestMoveUci;
+// the commands handleCommand() answers with a move, the pondering search has to be stopped for all the others
+inline bool isMoveCommand(const std::string& cmd)
+{
+    return cmd == "move" || startsWithSquare(cmd);
+}
+
+// Game mode pondering: after its move the engine searches in the background the position
+// after the reply it expects. If the reply comes, that search just goes on as the normal
+// one (PonderHit()), otherwise it's stopped and the new search starts with the hash table
+// it has filled
+struct PonderState
+{
+    bool enabled = true;
+    bool active = false;
+    fatpup::Move expectedMove;
+    std::shared_ptr<std::promise<fatpup::Move>> result;
+};
+
+// pos is the position after the engine's move, the engine is in sync with it
+inline void startPondering(const fatpup::Position& pos, fatpup::Engine* engine, PonderState* ponder)
+{
+    if (!ponder || !ponder->enabled || pos.getState() == fatpup::Position::State::Checkmate ||
+        pos.getState() == fatpup::Position::State::Stalemate)
+        return;
+
+    const fatpup::Move expectedMove = engine->GetPonderMove();
+    if (expectedMove.isEmpty())
+        return;
+
+    fatpup::Position ponderPos = pos;
+    ponderPos += expectedMove;
+    engine->SetPosition(ponderPos);
+    fatpup::SearchLimits limits;
+    limits.ponder = true;
+    engine->SetSearchLimits(limits);
+
+    auto result = std::make_shared<std::promise<fatpup::Move>>();
+    engine->Start([result](fatpup::Move bestMove) { result->set_value(bestMove); });
+    ponder->active = true;
+    ponder->expectedMove = expectedMove;
+    ponder->result = result;
+}
+
+// drops the pondering search, the engine gets back to pos
+inline void stopPondering(const fatpup::Position& pos, fatpup::Engine* engine, PonderState* ponder)
+{
+    if (!ponder || !ponder->active)
+        return;
+
+    engine->Stop();
+    engine->SetSearchLimits(fatpup::SearchLimits());
+    engine->SetPosition(pos);
+    ponder->active = false;
+    ponder->result.reset();
+}
+
+// makes the opponent's move in pos and answers it, with the pondering search if it was the expected one
+inline std::string answerMove(fatpup::Position* pos, fatpup::Engine* engine, fatpup::Move move, std::ostream& out,
+                              const fatpup::PolyglotBook* book, PonderState* ponder)
+{
+    if (!ponder || !ponder->active || move != ponder->expectedMove)
+    {
+        stopPondering(*pos, engine, ponder);
+        *pos += move;
+        engine->MoveDone(move);
+        return emitBestMove(pos, engine, out, book);
+    }
+
+    *pos += move;
+    if (emitGameOverIfAny(*pos, out))
+    {
+        stopPondering(*pos, engine, ponder);
+        out << "bestmove 0000\n";
+        return "0000";
+    }
+
+    out << "info string ponder hit\n";
+    engine->PonderHit();
+    const fatpup::Move bestMove = ponder->result->get_future().get();
+    engine->Stop();
+    engine->SetSearchLimits(fatpup::SearchLimits());
+    ponder->active = false;
+    ponder->result.reset();
+
+    // the engine has made the move already, just like GetBestMove() does
+    if (!bestMove.isEmpty())
+        *pos += bestMove;
+    return emitSearchedMove(*pos, bestMove, out);
 }
 
 inline char pieceToFenChar(const fatpup::Square& square)
@@ -261,7 +395,9 @@ inline bool handleCommand(
     fatpup::Engine* engine,
     std::vector<RollbackState>* history,
     std::string* lastBestMove,
-    std::ostream& out)
+    std::ostream& out,
+    const fatpup::PolyglotBook* book = nullptr,
+    PonderState* ponder = nullptr)
 {
     if (tokens.empty())
         return false;
@@ -284,7 +420,7 @@ inline bool handleCommand(
         return true;
     }
 
-    if (cmd == "move" || startsWithSquare(cmd))
+    if (isMoveCommand(cmd))
     {
         std::string moveStr;
         if (cmd == "move")
@@ -304,11 +440,10 @@ inline bool handleCommand(
         {
             const fatpup::Position rollbackPos = *pos;
             const std::string rollbackBestMove = *lastBestMove;
-            *pos += move;
-            engine->MoveDone(move);
-            const std::string bestMove = emitBestMove(pos, engine, out);
+            const std::string bestMove = answerMove(pos, engine, move, out, book, ponder);
             history->push_back(RollbackState{rollbackPos, rollbackBestMove});
             *lastBestMove = bestMove;
+            startPondering(*pos, engine, ponder);
         }
         else
         {
@@ -408,14 +543,18 @@ inline bool handleCommand(
             const std::string rollbackBestMove = *lastBestMove;
             *pos += move;
             engine->MoveDone(move);
-            const std::string bestMove = emitBestMove(pos, engine, out);
+            const std::string bestMove = emitBestMove(pos, engine, out, book);
             history->push_back(RollbackState{rollbackPos, rollbackBestMove});
             *lastBestMove = bestMove;
+            startPondering(*pos, engine, ponder);
             return true;
         }
 
         if (side == "black")
-            *lastBestMove = emitBestMove(pos, engine, out);
+        {
+            *lastBestMove = emitBestMove(pos, engine, out, book);
+            startPondering(*pos, engine, ponder);
+        }
 
         return true;
     }
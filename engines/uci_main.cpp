@@ -1,10 +1,16 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "fatpup/engine.h"
+#include "fatpup/polyglot.h"
 #include "uci_fp_extensions.h"
 
 namespace
@@ -74,6 +80,168 @@ bool setPosition(const std::vector<std::string>& tokens, fatpup::Position* pos)
     return true;
 }
 
+// "setoption name <id> [value <x>]", both the name and the value may contain spaces
+bool parseSetOption(const std::string& line, std::string* name, std::string* value)
+{
+    const auto tokens = split(line);
+    if (tokens.size() < 3 || tokens[1] != "name")
+        return false;
+
+    name->clear();
+    value->clear();
+
+    size_t nextToken = 2;
+    while (nextToken < tokens.size() && tokens[nextToken] != "value")
+    {
+        if (!name->empty())
+            *name += " ";
+        *name += tokens[nextToken++];
+    }
+
+    if (nextToken < tokens.size())
+    {
+        // take the value verbatim, file names may contain repeated spaces
+        const size_t valuePos = line.find(" value ");
+        if (valuePos != std::string::npos)
+            *value = line.substr(valuePos + 7);
+        while (!value->empty() && std::isspace((unsigned char)value->back()))
+            value->pop_back();
+    }
+
+    return !name->empty();
+}
+
+// "go [ponder] [wtime <x>] [btime <x>] [winc <x>] [binc <x>] [movestogo <x>] [movetime <x>] [depth <x>] [nodes <x>] [infinite]",
+// unknown and malformed parameters are ignored
+fatpup::SearchLimits parseGo(const std::vector<std::string>& tokens)
+{
+    fatpup::SearchLimits limits;
+    for (size_t t = 1; t < tokens.size(); ++t)
+    {
+        const auto& param = tokens[t];
+        if (param == "infinite")
+        {
+            limits.infinite = true;
+            continue;
+        }
+        if (param == "ponder")
+        {
+            limits.ponder = true;
+            continue;
+        }
+        if (t + 1 == tokens.size())
+            break;
+
+        const long long value = std::atoll(tokens[t + 1].c_str());
+        if (param == "wtime")
+            limits.wtime = (int)value;
+        else if (param == "btime")
+            limits.btime = (int)value;
+        else if (param == "winc")
+            limits.winc = (int)value;
+        else if (param == "binc")
+            limits.binc = (int)value;
+        else if (param == "movestogo")
+            limits.movestogo = (int)value;
+        else if (param == "movetime")
+            limits.movetime = (int)value;
+        else if (param == "depth")
+            limits.depth = (int)value;
+        else if (param == "nodes")
+            limits.nodes = (unsigned long long)std::max(0LL, value);
+        else
+            continue;
+        ++t;
+    }
+
+    return limits;
+}
+
+// the search thread prints while the main one reads the commands, so every line goes out
+// whole and right away
+void send(const std::string& text)
+{
+    static std::mutex outputMutex;
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << text << std::flush;
+}
+
+void printInfo(const fatpup::SearchInfo& info)
+{
+    std::ostringstream out;
+    out << "info depth " << info.depth;
+    if (info.multipv)
+        out << " multipv " << info.multipv;
+    if (info.mate)
+        out << " score mate " << info.mate;
+    else
+        out << " score cp " << info.score;
+
+    const unsigned long long nps = info.time ? info.nodes * 1000 / info.time : 0;
+    out << " nodes " << info.nodes << " nps " << nps << " hashfull " << info.hashfull << " time " << info.time;
+    if (!info.pv.empty())
+    {
+        out << " pv";
+        for (const auto move: info.pv)
+            out << " " << fatpup::uci_fp::moveToUci(move);
+    }
+    out << "\n";
+    send(out.str());
+}
+
+// "bench [depth] [threads]": fixed depth searches of a few positions with 1, 2, 4... threads up
+// to the given number, reports the time to depth and the nodes per second of every run
+void bench(const std::vector<std::string>& tokens, fatpup::Engine* engine, int threads)
+{
+    static const char* benchPositions[] =
+    {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R w KQ - 0 8",
+        "2r2rk1/1bqnbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 0 14",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"
+    };
+
+    const int depth = (tokens.size() > 1) ? std::max(1, std::atoi(tokens[1].c_str())) : 5;
+    const int maxThreads = (tokens.size() > 2) ? std::max(1, std::atoi(tokens[2].c_str())) : threads;
+
+    double singleThreadMs = 0;
+    for (int benchThreads = 1; ; benchThreads = std::min(benchThreads * 2, maxThreads))
+    {
+        engine->SetOption("Threads", std::to_string(benchThreads));
+        engine->SetOption("Clear Hash", "");
+        fatpup::SearchLimits limits;
+        limits.depth = depth;
+        engine->SetSearchLimits(limits);
+
+        unsigned long long nodes = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (const char* fen: benchPositions)
+        {
+            fatpup::Position pos;
+            pos.setFEN(fen);
+            engine->SetPosition(pos);
+            engine->GetBestMove();
+            nodes += engine->GetNodeCount();
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (benchThreads == 1)
+            singleThreadMs = ms;
+
+        std::cout << "info string bench depth " << depth << " threads " << benchThreads << " nodes " << nodes << " time " <<
+            (unsigned long long)ms << " nps " << (ms > 0 ? (unsigned long long)(nodes * 1000 / ms) : 0) << " speedup " <<
+            (ms > 0 ? singleThreadMs / ms : 0) << std::endl;
+
+        if (benchThreads == maxThreads)
+            break;
+    }
+
+    engine->SetSearchLimits(fatpup::SearchLimits());
+    engine->SetOption("Threads", std::to_string(threads));
+    engine->SetOption("Clear Hash", "");
+}
+
 }   // namespace
 
 int main()
@@ -87,6 +255,30 @@ int main()
     engine->SetPosition(pos);
     std::vector<fatpup::uci_fp::RollbackState> history;
     std::string lastBestMove;
+    fatpup::PolyglotBook book;
+    int threads = 1;
+
+    // "go" searches in the background. Any command but "isready" and "ponderhit" stops the search
+    // first (a GUI sends "stop" anyway) and then its move is made in pos
+    fatpup::uci_fp::PonderState ponder;
+    bool searching = false;
+    fatpup::Move searchedMove;
+    auto finishSearch = [&]()
+    {
+        if (!searching)
+            return;
+
+        engine->Stop();
+        searching = false;
+        if (!searchedMove.isEmpty())
+            pos += searchedMove;
+        lastBestMove = fatpup::uci_fp::moveToUci(searchedMove);
+
+        // the extension commands search with the engine defaults, so the limits and the
+        // info output only last for this search
+        engine->SetSearchLimits(fatpup::SearchLimits());
+        engine->SetInfoCallback(nullptr);
+    };
 
     std::string line;
     while (std::getline(std::cin, line))
@@ -96,18 +288,62 @@ int main()
             continue;
 
         const auto& cmd = tokens[0];
+        if (cmd == "isready")
+        {
+            send("readyok\n");
+            continue;
+        }
+        if (cmd == "ponderhit")
+        {
+            engine->PonderHit();
+            continue;
+        }
+
+        finishSearch();
+        if (!fatpup::uci_fp::isMoveCommand(cmd))
+            fatpup::uci_fp::stopPondering(pos, engine.get(), &ponder);
         if (cmd == "uci")
         {
             std::cout << "id name fatpup minimax\n";
             std::cout << "id author fatpup\n";
+            std::cout << "option name Hash type spin default 16 min 0 max 4096\n";
+            std::cout << "option name Clear Hash type button\n";
+            std::cout << "option name Threads type spin default 1 min 1 max 256\n";
+            std::cout << "option name MultiPV type spin default 1 min 1 max 256\n";
+            std::cout << "option name Ponder type check default true\n";
+            std::cout << "option name Book type string default <empty>\n";
+            std::cout << "option name EvalFile type string default <empty>\n";
+            std::cout << "option name TablebasePath type string default <empty>\n";
+            std::cout << "option name NullMove type check default true\n";
+            std::cout << "option name LateMoveReductions type check default true\n";
+            std::cout << "option name Futility type check default true\n";
             std::cout << "uciok\n";
         }
-        else if (cmd == "isready")
+        else if (cmd == "setoption")
         {
-            std::cout << "readyok\n";
+            std::string name;
+            std::string value;
+            if (!parseSetOption(line, &name, &value))
+                std::cout << "info string usage: setoption name <id> [value <x>]\n";
+            else if (name == "Ponder" && (value == "true" || value == "false"))
+                ponder.enabled = (value == "true");
+            else if (name == "Book")
+            {
+                if (value.empty() || value == "<empty>")
+                    book.close();
+                else if (book.open(value))
+                    std::cout << "info string book " << value << ", " << book.entryCount() << " entries\n";
+                else
+                    std::cout << "info string cannot open book " << value << "\n";
+            }
+            else if (!engine->SetOption(name, value))
+                std::cout << "info string unknown option or invalid value: " << name << "\n";
+            else if (name == "Threads")
+                threads = std::atoi(value.c_str());
         }
         else if (cmd == "ucinewgame")
         {
+            engine->SetOption("Clear Hash", "");
             pos.setInitial();
             engine->SetPosition(pos);
             history.clear();
@@ -124,15 +360,40 @@ int main()
         }
         else if (cmd == "go")
         {
-            lastBestMove = fatpup::uci_fp::emitBestMove(&pos, engine.get(), std::cout);
+            lastBestMove = fatpup::uci_fp::emitMoveWithoutSearch(&pos, engine.get(), std::cout, &book);
+            if (lastBestMove.empty())
+            {
+                // the search thread only prints, pos is updated by finishSearch()
+                const fatpup::Position searchPos = pos;
+                engine->SetSearchLimits(parseGo(tokens));
+                engine->SetInfoCallback(printInfo);
+                searching = true;
+                fatpup::Engine* searchEngine = engine.get();
+                engine->Start([searchPos, searchEngine, &searchedMove](fatpup::Move bestMove)
+                {
+                    searchedMove = bestMove;
+                    fatpup::Position afterMove = searchPos;
+                    if (!bestMove.isEmpty())
+                        afterMove += bestMove;
+
+                    std::ostringstream out;
+                    fatpup::uci_fp::emitSearchedMove(afterMove, bestMove, out, searchEngine->GetPonderMove());
+                    send(out.str());
+                });
+            }
+        }
+        else if (cmd == "bench")
+        {
+            bench(tokens, engine.get(), threads);
+            engine->SetPosition(pos);
         }
-        else if (fatpup::uci_fp::handleCommand(tokens, &pos, engine.get(), &history, &lastBestMove, std::cout))
+        else if (fatpup::uci_fp::handleCommand(tokens, &pos, engine.get(), &history, &lastBestMove, std::cout, &book, &ponder))
         {
             // extension handled
         }
         else if (cmd == "stop")
         {
-            // no asynchronous search at the moment
+            // finishSearch() has done it
         }
         else if (cmd == "quit")
         {
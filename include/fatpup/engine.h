@@ -1,24 +1,79 @@
 #ifndef FATPUP_ENGINE_H
 #define FATPUP_ENGINE_H
 
+#include <functional>
 #include <string>
+#include <vector>
 
 #include "fatpup/position.h"
 
 namespace fatpup
 {
 
+// What GetBestMove() is allowed to spend, mirrors the arguments of UCI "go". Zero means
+// "not set"; with nothing set at all the engine searches to its default fixed depth
+struct SearchLimits
+{
+    int depth = 0;
+    unsigned long long nodes = 0;
+    int movetime = 0;               // ms
+    int wtime = 0;                  // ms left on the clocks
+    int btime = 0;
+    int winc = 0;
+    int binc = 0;
+    int movestogo = 0;
+    bool infinite = false;          // until Stop() when started with Start(), GetBestMove() stops at the depth limit
+    bool ponder = false;            // searching on the opponent's time: no limits apply until PonderHit()
+};
+
+// reported after every completed iteration
+struct SearchInfo
+{
+    int depth = 0;
+    int score = 0;                  // centipawns from the point of view of the side to move
+    int mate = 0;                   // moves to mate, negative if the side to move gets mated, 0 if no mate
+    unsigned long long nodes = 0;
+    unsigned long long time = 0;    // ms since the search start
+    int hashfull = 0;               // permille of the hash table in use
+    int multipv = 0;                // rank of the line (1 for the best) if several are searched, 0 otherwise
+    std::vector<Move> pv;
+};
+
 class Engine
 {
 public:
-    // only "minimax" is available at the moment
+    // "minimax", or "nnue" for the same search with the neural network evaluation (nullptr
+    // if the network can't be loaded, as for an unknown name)
     static Engine* Create(const std::string& engineName);
     virtual ~Engine() {}
     virtual int SetPosition(const Position& pos) = 0;
-    //virtual void Start() = 0;
-    //virtual void Stop() = 0;
     virtual Move GetBestMove() = 0;
+    // asynchronous GetBestMove(): Start() returns right away and onBestMove gets the result on
+    // the search thread. Stop() makes the search finish as soon as possible and waits for it,
+    // nothing happens if there's no search. Nothing else but GetNodeCount() may be called in
+    // between. The default is a synchronous search for the engines with no thread of their own
+    virtual void Start(std::function<void(Move)> onBestMove) { onBestMove(GetBestMove()); }
+    virtual void Stop() {}
+    // the opponent has played the expected move, the pondering search goes on as a normal one,
+    // the clock starts now
+    virtual void PonderHit() {}
+    // the expected reply to the move found by the last search, empty if there's no guess
+    virtual Move GetPonderMove() const { return Move(); }
+    // analysis: the best lines found by the last search with their scores, best first. As many as
+    // the engine's "MultiPV" option asks for (fewer if there are not so many moves), empty if the
+    // engine has no such option
+    virtual std::vector<SearchInfo> GetBestLines() const { return std::vector<SearchInfo>(); }
     virtual void MoveDone(Move move) = 0;
+
+    // number of positions visited by the last GetBestMove() call
+    virtual unsigned long long GetNodeCount() const { return 0; }
+
+    // the limits stay in effect for all the following GetBestMove() calls
+    virtual void SetSearchLimits(const SearchLimits& limits) { (void)limits; }
+    virtual void SetInfoCallback(std::function<void(const SearchInfo&)> callback) { (void)callback; }
+
+    // engine specific settings (UCI "setoption"), returns false if the option is unknown or the value is invalid
+    virtual bool SetOption(const std::string& name, const std::string& value) { (void)name; (void)value; return false; }
 };
 
 }   // namespace fatpup
@@ -0,0 +1,43 @@
+#ifndef FATPUP_EPD_H
+#define FATPUP_EPD_H
+
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fatpup/position.h"
+
+namespace fatpup
+{
+    // One line of an EPD (Extended Position Description) file, e.g.
+    // 1r4k1/5Npp/4Q3/8/8/8/6K1/8 w - - bm Nd8+; id "mate in 2";
+    struct EpdRecord
+    {
+        Position                                            pos;
+        // the four position fields as they appear in the file
+        std::string                                         fen;
+        std::string                                         id;
+        // "bm" (best moves) and "am" (avoid moves) operands, already resolved against pos
+        std::vector<Move>                                   best_moves;
+        std::vector<Move>                                   avoid_moves;
+        // all the operations in the original order, operands are unquoted
+        std::vector<std::pair<std::string, std::string>>    operations;
+
+        // empty string if the opcode is not present
+        std::string                                         operation(const std::string& opcode) const;
+        // true if the move satisfies bm/am, a record with neither has no solution
+        bool                                                isSolvedBy(Move move) const;
+    };
+
+    // returns false if the line is not a valid EPD record (bad position, unparsable
+    // or illegal bm/am moves)
+    bool parseEpd(const std::string& line, EpdRecord* record);
+
+    // reads all the records, empty lines and lines starting with '#' are skipped.
+    // Returns false if a line failed to parse, error_line is set to its number (1-based)
+    bool readEpd(std::istream& in, std::vector<EpdRecord>* records, size_t* error_line = nullptr);
+
+}   // namespace fatpup
+
+#endif // FATPUP_EPD_H
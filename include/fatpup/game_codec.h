@@ -0,0 +1,132 @@
+#ifndef FATPUP_GAME_CODEC_H
+#define FATPUP_GAME_CODEC_H
+
+#include <ostream>
+#include <vector>
+
+#include "fatpup/position.h"
+
+namespace fatpup
+{
+    // Compact game records: every move is stored as its index in the legal move list of
+    // the position it's played in. Position::possibleMoves() always returns the moves in
+    // the same order (board scan from a1 to h8, then the fixed per-piece generation order),
+    // which makes that list the canonical one. Encoding/decoding replays the game through
+    // Position, so the records are only meaningful together with the start position.
+    enum class MoveCoding
+    {
+        Bytes,      // one byte per ply, there are never more than 218 legal moves
+        Bits        // ceil(log2(number of legal moves)) bits per ply, forced moves take no space at all
+    };
+
+    class GameEncoder
+    {
+    public:
+        explicit GameEncoder(const Position& start_pos, MoveCoding coding = MoveCoding::Bits);
+
+        // returns false (and leaves the record untouched) if the move is illegal in the current position
+        bool                                addMove(Move move);
+
+        const Position&                     startPosition() const { return m_start_pos; }
+        // position after the moves added so far
+        const Position&                     position() const { return m_pos; }
+        MoveCoding                          coding() const { return m_coding; }
+        size_t                              plyCount() const { return m_ply_count; }
+        // the last byte is zero-padded in the Bits case
+        const std::vector<unsigned char>&   data() const { return m_data; }
+
+    private:
+        Position                            m_start_pos;
+        Position                            m_pos;
+        MoveCoding                          m_coding;
+        size_t                              m_ply_count;
+        size_t                              m_bit_count;
+        std::vector<unsigned char>          m_data;
+    };
+
+    class GameDecoder
+    {
+    public:
+        // empty decoder, nextMove() returns false right away
+        GameDecoder();
+        GameDecoder(const Position& start_pos, const unsigned char* data, size_t size, size_t ply_count,
+                    MoveCoding coding = MoveCoding::Bits);
+
+        // returns false when all the moves are decoded or the record is corrupted (see isCorrupted())
+        bool                                nextMove(Move* move);
+
+        // position after the moves decoded so far
+        const Position&                     position() const { return m_pos; }
+        size_t                              pliesLeft() const { return m_plies_left; }
+        bool                                isCorrupted() const { return m_corrupted; }
+
+    private:
+        Position                            m_pos;
+        const unsigned char*                m_data;
+        size_t                              m_size;
+        size_t                              m_plies_left;
+        size_t                              m_bit_pos;
+        MoveCoding                          m_coding;
+        bool                                m_corrupted;
+    };
+
+    // Game archive container:
+    //   games, each: u8 flags, [64 bytes of square states if the start position is not the
+    //                initial one], varint ply count, varint data size, move data
+    //   index:       u64 offset of every game
+    //   trailer:     u64 index offset, u64 game count, "FPGA", u32 version
+    // All integers are little-endian. Keeping the index and the trailer at the end allows
+    // writing to non-seekable streams with no buffering of the games.
+    class GameArchiveWriter
+    {
+    public:
+        explicit GameArchiveWriter(std::ostream& out, MoveCoding coding = MoveCoding::Bits);
+        ~GameArchiveWriter();
+
+        GameArchiveWriter(const GameArchiveWriter&) = delete;
+        GameArchiveWriter& operator = (const GameArchiveWriter&) = delete;
+
+        // returns false if a move is illegal or the output failed
+        bool                                addGame(const Position& start_pos, const std::vector<Move>& moves);
+        // the encoder's coding is kept even if it differs from the writer's one
+        bool                                addGame(const GameEncoder& encoder);
+        // writes the index and the trailer, called by the destructor if you don't
+        bool                                finish();
+
+        size_t                              gameCount() const { return m_offsets.size(); }
+
+    private:
+        std::ostream&                       m_out;
+        MoveCoding                          m_coding;
+        unsigned long long                  m_offset;
+        std::vector<unsigned long long>     m_offsets;
+        std::vector<unsigned char>          m_record;
+        bool                                m_finished;
+    };
+
+    // Works on an archive image in memory (e.g. a memory-mapped file), nothing is copied
+    class GameArchiveReader
+    {
+    public:
+        GameArchiveReader();
+
+        // returns false if the data doesn't look like a game archive
+        bool                                open(const unsigned char* data, size_t size);
+
+        size_t                              gameCount() const { return m_game_count; }
+
+        // returns false if the record is corrupted
+        bool                                readGame(size_t game_idx, Position* start_pos, std::vector<Move>* moves) const;
+        // streaming alternative to readGame(): the decoder replays the game move by move
+        bool                                gameDecoder(size_t game_idx, GameDecoder* decoder) const;
+
+    private:
+        const unsigned char*                m_data;
+        size_t                              m_size;
+        const unsigned char*                m_index;
+        size_t                              m_game_count;
+    };
+
+}   // namespace fatpup
+
+#endif // FATPUP_GAME_CODEC_H
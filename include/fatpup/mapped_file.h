@@ -0,0 +1,37 @@
+#ifndef FATPUP_MAPPED_FILE_H
+#define FATPUP_MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+
+namespace fatpup
+{
+    // Read-only view of a whole file: memory-mapped where possible, read into memory
+    // otherwise (no mmap on the platform or the file can't be mapped, e.g. a pipe)
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator = (const MappedFile&) = delete;
+
+        // returns false if the file can't be opened or read, or if it's empty
+        bool                            open(const std::string& path);
+        void                            close();
+
+        bool                            isOpen() const { return m_data != nullptr; }
+        const unsigned char*            data() const { return m_data; }
+        size_t                          size() const { return m_size; }
+
+    private:
+        const unsigned char*            m_data;
+        size_t                          m_size;
+        bool                            m_mapped;
+        std::vector<unsigned char>      m_buffer;
+    };
+
+}   // namespace fatpup
+
+#endif // FATPUP_MAPPED_FILE_H
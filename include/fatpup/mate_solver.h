@@ -0,0 +1,71 @@
+#ifndef FATPUP_MATE_SOLVER_H
+#define FATPUP_MATE_SOLVER_H
+
+#include <vector>
+
+#include "fatpup/position.h"
+
+namespace fatpup
+{
+    // Mate-in-N solver for puzzles: depth-first proof-number search (df-pn). The side to move
+    // (the attacker) only tries checking moves by default, which is what makes it fast, but it
+    // then misses the mates with a quiet move in them, setChecksOnly(false) finds those too.
+    // Its last move is always a check, so only the checks are generated there in either case.
+    // The proof and disproof numbers are kept in a hash table: a position is stored with the
+    // number of attacker moves left, so that a position reached again with as many moves left
+    // is not searched twice
+    class MateSolver
+    {
+    public:
+        static constexpr unsigned int       defaultHashSizeMb = 16;
+
+        explicit MateSolver(unsigned int hash_size_mb = defaultHashSizeMb);
+
+        void                                setChecksOnly(bool checks_only) { m_checks_only = checks_only; }
+        // 0 means no limit
+        void                                setNodeLimit(unsigned long long node_limit) { m_node_limit = node_limit; }
+
+        // the shortest mate of the side to move in at most max_moves of its moves. Returns the
+        // number of moves, 0 if there's no mate that short (or the node limit was hit first, see
+        // nodeLimitReached()). line gets the attacker's moves with the longest defence in between
+        int                                 findMate(const Position& pos, int max_moves, std::vector<Move>* line = nullptr);
+
+        // of the last findMate()
+        unsigned long long                  nodeCount() const { return m_node_count; }
+        bool                                nodeLimitReached() const { return m_node_limit && m_node_count >= m_node_limit; }
+
+    private:
+        struct Entry
+        {
+            unsigned long long              key;
+            unsigned int                    phi;
+            unsigned int                    delta;
+            unsigned short                  moves_left;
+            unsigned short                  generation;
+        };
+
+        // phi and delta are the proof and the disproof numbers for the side to move: the
+        // attacker's mate or the defender's escape. moves_left is the attacker's moves left
+        bool                                probe(unsigned long long key, int moves_left, unsigned int* phi, unsigned int* delta) const;
+        void                                store(unsigned long long key, int moves_left, unsigned int phi, unsigned int delta);
+
+        // the attacker's moves worth trying: all of them but at its last move, checks only by default
+        std::vector<Move>                   attackerMoves(const Position& pos, int moves_left) const;
+        // multiple iterative deepening: searches the node until its phi or delta reaches the threshold
+        void                                mid(const Position& pos, unsigned long long key, int moves_left, bool attacker,
+                                                unsigned int phi_threshold, unsigned int delta_threshold,
+                                                unsigned int* phi, unsigned int* delta);
+        // the node searched to the end: true if the attacker mates, false if it doesn't or the node limit is hit
+        bool                                proveMate(const Position& pos, unsigned long long key, int moves_left, bool attacker);
+        void                                appendLine(Position pos, unsigned long long key, int moves_left, std::vector<Move>* line);
+
+        std::vector<Entry>                  m_table;
+        unsigned short                      m_generation;
+        bool                                m_checks_only;
+        unsigned long long                  m_node_limit;
+        unsigned long long                  m_node_count;
+    };
+
+}   // namespace fatpup
+
+#endif // FATPUP_MATE_SOLVER_H
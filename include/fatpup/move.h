@@ -5,6 +5,7 @@
 
 namespace fatpup
 {
+    // see PackedMove (fatpup/packed_move.h) for the compact 16-bit form used for storage
     union Move
     {
         Move(): raw_block(0) {}
@@ -0,0 +1,113 @@
+#ifndef FATPUP_PACKED_MOVE_H
+#define FATPUP_PACKED_MOVE_H
+
+#include "fatpup/move.h"
+#include "fatpup/position.h"
+
+namespace fatpup
+{
+    // Canonical 16-bit move encoding for storage (move lists, transposition table entries,
+    // stored games). Move is convenient to fill in field by field, but its bitfields
+    // compile to extract/insert code on every access and it takes 4 bytes. Here the
+    // layout is explicit:
+    //   bits  0..5    source square index (A1..H8)
+    //   bits  6..11   destination square index
+    //   bits 12..13   promotion piece - Knight (Knight, Bishop, Rook, Queen)
+    //   bits 14..15   move type (Normal, Promotion, EnPassantCapture, Castling)
+    // Castling is stored as the king's move, the rook columns are implied by the destination
+    // (g-file: h -> f, c-file: a -> d), so the conversion to/from Move is lossless.
+    // The empty Move (raw_block == 0) maps to the empty PackedMove (0) and back
+    class PackedMove
+    {
+    public:
+        enum Type
+        {
+            Normal = 0,
+            Promotion = 1,
+            EnPassantCapture = 2,
+            Castling = 3
+        };
+
+        constexpr PackedMove(): m_data(0) {}
+        constexpr explicit PackedMove(unsigned short data): m_data(data) {}
+        constexpr PackedMove(int src_idx, int dst_idx, int type = Normal, int promoted_to = Knight):
+            m_data((unsigned short)(src_idx | (dst_idx << 6) | (((promoted_to - Knight) & 3) << 12) | (type << 14)))
+        {
+        }
+
+        // en passant captures can't be told from the Move alone, they come out as Normal
+        explicit PackedMove(Move move):
+            m_data(fromMove(move))
+        {
+        }
+
+        // same as above plus the EnPassantCapture type, pos is the position the move is played in
+        PackedMove(const Position& pos, Move move):
+            m_data(fromMove(move))
+        {
+            if (type() == Normal && pos.square(move.fields.src_row, move.fields.src_col).piece() == Pawn &&
+                move.fields.src_col != move.fields.dst_col && pos.square(move.fields.dst_row, move.fields.dst_col).piece() == Empty)
+            {
+                m_data |= (unsigned short)(EnPassantCapture << 14);
+            }
+        }
+
+        constexpr unsigned short    raw() const { return m_data; }
+        constexpr bool              isEmpty() const { return m_data == 0; }
+
+        constexpr int               src() const { return m_data & 0x3f; }
+        constexpr int               dst() const { return (m_data >> 6) & 0x3f; }
+        constexpr int               type() const { return m_data >> 14; }
+        // Empty unless it's a promotion
+        constexpr int               promotedTo() const { return type() == Promotion ? Knight + ((m_data >> 12) & 3) : (int)Empty; }
+
+        constexpr int               srcRow() const { return src() >> 3; }
+        constexpr int               srcCol() const { return src() & 7; }
+        constexpr int               dstRow() const { return dst() >> 3; }
+        constexpr int               dstCol() const { return dst() & 7; }
+
+        constexpr bool              operator == (const PackedMove& rhs) const { return m_data == rhs.m_data; }
+        constexpr bool              operator != (const PackedMove& rhs) const { return m_data != rhs.m_data; }
+
+        Move toMove() const
+        {
+            Move move;
+            move.fields.src_row = srcRow();
+            move.fields.src_col = srcCol();
+            move.fields.dst_row = dstRow();
+            move.fields.dst_col = dstCol();
+
+            const int move_type = type();
+            if (move_type == Promotion)
+                move.fields.promoted_to = promotedTo();
+            else if (move_type == Castling)
+            {
+                const bool short_castling = (dstCol() == COLG);
+                move.fields.rook_src_col = short_castling ? COLH : COLA;
+                move.fields.rook_dst_col = short_castling ? COLF : COLD;
+            }
+
+            return move;
+        }
+
+    private:
+        static unsigned short fromMove(Move move)
+        {
+            const int src_idx = move.fields.src_row * BOARD_SIZE + move.fields.src_col;
+            const int dst_idx = move.fields.dst_row * BOARD_SIZE + move.fields.dst_col;
+
+            if (move.fields.rook_src_col != move.fields.rook_dst_col)
+                return PackedMove(src_idx, dst_idx, Castling).raw();
+            if (move.fields.promoted_to > Pawn)
+                return PackedMove(src_idx, dst_idx, Promotion, move.fields.promoted_to).raw();
+            return PackedMove(src_idx, dst_idx).raw();
+        }
+
+        unsigned short      m_data;
+    };
+
+    static_assert(sizeof(PackedMove) == 2, "PackedMove shall be 16 bits");
+
+}   // namespace fatpup
+
+#endif // FATPUP_PACKED_MOVE_H
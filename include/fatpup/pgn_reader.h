@@ -0,0 +1,58 @@
+#ifndef FATPUP_PGN_READER_H
+#define FATPUP_PGN_READER_H
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "fatpup/pgn_writer.h"
+#include "fatpup/position.h"
+
+namespace fatpup
+{
+    // Reads games one by one from a PGN stream, nothing but the current game is kept in
+    // memory. Comments, variations, NAGs and move numbers are skipped, the start position
+    // is taken from the FEN tag if there's one.
+    //
+    // Usage:
+    // PgnReader reader(in);
+    // while (reader.readGame(&tags, &start_pos, &moves, &result))
+    //     ...
+    class PgnReader
+    {
+    public:
+        explicit PgnReader(std::istream& in);
+
+        PgnReader(const PgnReader&) = delete;
+        PgnReader& operator = (const PgnReader&) = delete;
+
+        // returns false at the end of the input. A game with an illegal or unparsable move (or
+        // a bad FEN tag) is still returned with the moves up to that point and counted in
+        // errorCount(), so that one broken game doesn't stop the whole stream
+        bool                readGame(std::vector<PgnTag>* tags, Position* start_pos, std::vector<Move>* moves, std::string* result);
+
+        // only the first max_plies moves of every game are parsed (and returned), the rest of
+        // the movetext is just skipped. Parsing SAN is by far the most expensive part of
+        // reading, so it pays off when only the openings are needed
+        void                setMaxPlies(size_t max_plies) { m_max_plies = max_plies; }
+
+        size_t              gameCount() const { return m_game_count; }
+        size_t              errorCount() const { return m_error_count; }
+
+    private:
+        int                 peekChar() { return m_buf ? m_buf->sgetc() : std::char_traits<char>::eof(); }
+        int                 nextChar() { return m_buf ? m_buf->sbumpc() : std::char_traits<char>::eof(); }
+        bool                skipSpaces();
+        void                skipLine();
+        bool                readTag(PgnTag* tag);
+        void                readToken(std::string* token);
+
+        std::streambuf*     m_buf;
+        size_t              m_max_plies;
+        size_t              m_game_count;
+        size_t              m_error_count;
+        std::string         m_token;
+    };
+}   // namespace fatpup
+
+#endif // FATPUP_PGN_READER_H
@@ -0,0 +1,79 @@
+#ifndef FATPUP_PGN_WRITER_H
+#define FATPUP_PGN_WRITER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "fatpup/position.h"
+
+namespace fatpup
+{
+    struct PgnTag
+    {
+        std::string name;
+        std::string value;
+    };
+
+    // Writes complete games in PGN export format. Everything goes into an internal buffer
+    // that is flushed to the output (an ostream or a file descriptor) only when it's full,
+    // so exporting many games results in few large writes. SAN is produced in place, i.e.
+    // there are no per-move std::string's and the legal move list is only generated when
+    // a move actually needs disambiguation.
+    //
+    // Usage:
+    // PgnWriter writer(std::cout);
+    // writer.writeGame({ { "White", "fatpup" }, { "Black", "human" } }, start_pos, moves, "1-0");
+    // ...
+    // writer.flush();    // or let the destructor do it
+    class PgnWriter
+    {
+    public:
+        static constexpr size_t defaultBufferSize = 256 * 1024;
+        static constexpr int defaultLineLength = 79;
+
+        explicit PgnWriter(std::ostream& out, size_t buffer_size = defaultBufferSize);
+        // fd is not closed by the writer
+        explicit PgnWriter(int fd, size_t buffer_size = defaultBufferSize);
+        ~PgnWriter();
+
+        PgnWriter(const PgnWriter&) = delete;
+        PgnWriter& operator = (const PgnWriter&) = delete;
+
+        // movetext lines are wrapped so that they don't exceed this length (tag pairs are never wrapped)
+        void                setLineLength(int line_length) { m_line_length = line_length; }
+
+        // the moves are expected to be legal, just like for Position::moveToStringPGN(). If the
+        // start position is not the initial one, it's the caller's job to add SetUp/FEN tags.
+        // Returns false if the output failed, in which case the writer stays in the failed state
+        bool                writeGame(const std::vector<PgnTag>& tags, const Position& start_pos,
+                                      const std::vector<Move>& moves, const std::string& result = "*");
+
+        // returns false if the output failed (now or during one of the previous flushes)
+        bool                flush();
+
+        unsigned long long  bytesWritten() const { return m_bytes_written; }
+
+    private:
+        void                append(const char* data, size_t length);
+        void                appendChar(char c);
+        void                appendToken(const char* token, size_t length);
+        void                newLine();
+
+        // writes SAN of the move into san (which shall have room for at least 8 chars + '\0'), returns its length
+        static size_t       moveToSAN(const Position& pos, Move move, const Position& new_pos, char* san);
+
+        bool                writeOut(const char* data, size_t length);
+
+        std::ostream*       m_out;
+        int                 m_fd;
+        std::vector<char>   m_buffer;
+        size_t              m_used;
+        int                 m_line_length;
+        int                 m_column;
+        bool                m_failed;
+        unsigned long long  m_bytes_written;
+    };
+}   // namespace fatpup
+
+#endif // FATPUP_PGN_WRITER_H
@@ -0,0 +1,109 @@
+#ifndef FATPUP_POLYGLOT_H
+#define FATPUP_POLYGLOT_H
+
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fatpup/mapped_file.h"
+#include "fatpup/position.h"
+
+namespace fatpup
+{
+    // Zobrist key of the position as defined by the Polyglot book format, so that
+    // publicly available .bin books can be used as is
+    unsigned long long polyglotKey(const Position& pos);
+    // incremental version for searches: key is polyglotKey(pos), new_pos is pos after the
+    // move. Only the squares the move touches are looked at
+    unsigned long long polyglotKeyAfterMove(const Position& pos, unsigned long long key, Move move, const Position& new_pos);
+    // the pawns' part of polyglotKey(), the same for all the positions with the same pawns
+    // (pawn structure caches and the like)
+    unsigned long long polyglotPawnKey(const Position& pos);
+    // the polyglotPawnKey() term of a piece (Square::pieceWithColor()) on a square, 0 unless it's a pawn
+    unsigned long long polyglotPawnSquareKey(unsigned char piece, int s_idx);
+
+    // Polyglot move encoding: to file (bits 0..2), to row (3..5), from file (6..8),
+    // from row (9..11), promotion piece (12..14: 1 knight .. 4 queen). Castling is
+    // stored as the king capturing its own rook (e1h1, e8a8 etc.).
+    // Returns an empty move if it's not legal in pos
+    Move polyglotMoveToMove(const Position& pos, unsigned short polyglot_move);
+    unsigned short moveToPolyglotMove(Move move);
+
+    struct PolyglotBookMove
+    {
+        Move                move;
+        unsigned short      weight;
+    };
+
+    // Read-only Polyglot book. The file is memory-mapped where possible (and read into
+    // memory otherwise), lookups are binary searches over the 16-byte entries sorted by
+    // key, nothing is parsed or allocated up front
+    class PolyglotBook
+    {
+    public:
+        // returns false if the file can't be opened or its size is not a multiple of the entry size
+        bool                            open(const std::string& path);
+        void                            close() { m_file.close(); }
+
+        bool                            isOpen() const { return m_file.isOpen(); }
+        size_t                          entryCount() const { return m_file.size() / entrySize; }
+
+        // book moves for pos in the file order (normally the best ones first),
+        // entries with moves illegal in pos are skipped
+        std::vector<PolyglotBookMove>   findMoves(const Position& pos) const;
+        // weighted random choice among findMoves(), random is any uniformly distributed
+        // number. Returns an empty move if pos is not in the book
+        Move                            pickMove(const Position& pos, unsigned int random) const;
+
+        static constexpr size_t         entrySize = 16;
+
+    private:
+        MappedFile                      m_file;
+    };
+
+    // Accumulates (position, move) weights and writes them out as a Polyglot book. Builders
+    // are independent of each other, so several threads can fill their own ones with no
+    // locking and merge() them at the end
+    class PolyglotBookBuilder
+    {
+    public:
+        void                            addMove(const Position& pos, Move move, unsigned int weight = 1);
+        void                            addMove(unsigned long long key, unsigned short polyglot_move, unsigned int weight = 1);
+        // adds the first max_plies moves of the game, white_weight/black_weight go to the
+        // moves of the respective side (Polyglot's own scheme is 2 for a win, 1 for a draw)
+        void                            addGame(const Position& start_pos, const std::vector<Move>& moves, int max_plies,
+                                                unsigned int white_weight = 1, unsigned int black_weight = 1);
+        void                            merge(const PolyglotBookBuilder& other);
+
+        size_t                          entryCount() const { return m_weights.size(); }
+
+        // entries are sorted by key, then by weight (the best move first). Weights that don't
+        // fit 16 bits are scaled down per position, entries below min_weight are dropped.
+        // Returns false if the output failed
+        bool                            write(std::ostream& out, unsigned long long min_weight = 1) const;
+
+    private:
+        struct EntryKey
+        {
+            unsigned long long          key;
+            unsigned short              move;
+
+            bool operator == (const EntryKey& rhs) const { return key == rhs.key && move == rhs.move; }
+        };
+
+        struct EntryKeyHash
+        {
+            size_t operator () (const EntryKey& entry_key) const
+            {
+                // the Zobrist key is as random as it gets already
+                return (size_t)(entry_key.key ^ (entry_key.move * 0x9e3779b97f4a7c15ULL));
+            }
+        };
+
+        std::unordered_map<EntryKey, unsigned long long, EntryKeyHash>  m_weights;
+    };
+
+}   // namespace fatpup
+
+#endif // FATPUP_POLYGLOT_H
@@ -59,6 +59,11 @@ namespace fatpup
 
         std::vector<Move>   possibleMoves() const;
         std::vector<Move>   possibleMoves(int src_row, int src_col, int dst_row, int dst_col) const;
+        // legal captures only (en passant and capturing promotions included), for quiescence
+        // searches and the like. Same moves as in possibleMoves(), but not in the same order
+        std::vector<Move>   possibleCaptures() const;
+        // legal moves that give check, for mate searches. Same moves as in possibleMoves()
+        std::vector<Move>   possibleChecks() const;
 
         void                moveDone(Move move);
 
@@ -87,10 +92,22 @@ namespace fatpup
         // to do: DrawByInsufficientMaterial, DrawByRepetition, DrawBy50Moves
         enum class State { Normal, Check, Checkmate, Stalemate, Illegal };
         State               getState() const;
+        // true if the side to move is in check. Cheaper than getState() as it doesn't
+        // look for legal moves, use it when you don't need to tell check from checkmate
+        bool                isCheck() const;
 
         std::string         moveToString(Move move) const;
         std::string         moveToStringPGN(Move move) const;
+        // parses SAN ("Nbd7", "exd8=Q+", "O-O", also "0-0" and promotions without '='),
+        // returns an empty move if the string is malformed, the move is illegal or ambiguous
+        Move                moveFromStringPGN(const std::string& san) const;
         bool                isMoveCapture(Move move) const;
+        // static exchange evaluation: the material (pawn = 1, the king is priceless) the side
+        // to move wins by the move and the best sequence of captures on its destination square
+        // that follows, either side stopping when capturing doesn't pay off. Negative if the
+        // move gives material away, a quiet move to an attacked square included. Pins and
+        // checks are ignored
+        int                 see(Move move) const;
 
         // to do:
         // bool isLegal() - two kings of diff colors, less than 8 pawns of each color, no pawns on first/last rows, etc.
@@ -0,0 +1,79 @@
+#ifndef FATPUP_POSITION_INDEX_H
+#define FATPUP_POSITION_INDEX_H
+
+#include <ostream>
+#include <vector>
+
+#include "fatpup/game_codec.h"
+#include "fatpup/position.h"
+
+namespace fatpup
+{
+    // one occurrence of a position: game game_id reached it after ply moves (0 is the start position)
+    struct PositionIndexEntry
+    {
+        unsigned long long  key;        // polyglotKey() of the position
+        unsigned int        game_id;
+        unsigned int        ply;
+    };
+
+    // Position index file:
+    //   blocks:     up to blockEntries entries each, sorted by (key, game id, ply). The first
+    //               entry of a block is varint game id, varint ply (its key is in the directory),
+    //               every next one is varint key delta, then varint game id delta if the key is
+    //               the same or the game id itself otherwise, then likewise for the ply
+    //   directory:  u64 first key, u64 offset of every block
+    //   trailer:    u64 directory offset, u64 block count, u64 entry count, "FPPI", u32 version
+    // All integers are little-endian. A lookup is a binary search over the directory plus
+    // decoding of one or a few blocks, so the file can be used memory-mapped as is.
+    class PositionIndexBuilder
+    {
+    public:
+        static constexpr size_t             blockEntries = 128;
+
+        // records the start position and the position after every move
+        void                                addGame(unsigned int game_id, const Position& start_pos, const std::vector<Move>& moves);
+        // replays all the games of the archive, game ids are first_game_id + game index in
+        // the archive. Returns false if a game record is corrupted
+        bool                                addArchive(const GameArchiveReader& archive, unsigned int first_game_id = 0);
+        // moves the other builder's entries over, for building in parallel
+        void                                merge(PositionIndexBuilder& other);
+
+        size_t                              entryCount() const { return m_entries.size(); }
+
+        // sorts the entries and writes the index, returns false if the output failed
+        bool                                write(std::ostream& out);
+
+    private:
+        std::vector<PositionIndexEntry>     m_entries;
+    };
+
+    // Works on an index image in memory (e.g. a memory-mapped file), nothing is copied
+    class PositionIndexReader
+    {
+    public:
+        PositionIndexReader();
+
+        // returns false if the data doesn't look like a position index
+        bool                                open(const unsigned char* data, size_t size);
+
+        size_t                              entryCount() const { return m_entry_count; }
+
+        // all the occurrences of the position sorted by game id and ply, empty if there are
+        // none (or the index is corrupted)
+        std::vector<PositionIndexEntry>     find(unsigned long long key) const;
+        std::vector<PositionIndexEntry>     find(const Position& pos) const;
+
+    private:
+        unsigned long long                  blockKey(size_t block_idx) const;
+
+        const unsigned char*                m_data;
+        size_t                              m_size;
+        const unsigned char*                m_directory;
+        size_t                              m_block_count;
+        size_t                              m_entry_count;
+    };
+
+}   // namespace fatpup
+
+#endif // FATPUP_POSITION_INDEX_H
@@ -44,6 +44,13 @@ namespace fatpup
     constexpr int QueenValue = 9;
     constexpr int KingValue = 2;
 
+    // the value of a piece in the exchanges (Position::see()), the king can capture but is never given away
+    constexpr int exchangeValue(int piece)
+    {
+        return (piece == Pawn) ? PawnValue : (piece == Knight) ? KnightValue : (piece == Bishop) ? BishopValue :
+               (piece == Rook) ? RookValue : (piece == Queen) ? QueenValue : (piece == King) ? 100 : 0;
+    }
+
     enum
     {
         Black = 0,          // just a stub for consistency (square1 = Pawn | White; square2 = Pawn | Black;)
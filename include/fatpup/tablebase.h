@@ -0,0 +1,117 @@
+#ifndef FATPUP_TABLEBASE_H
+#define FATPUP_TABLEBASE_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "fatpup/mapped_file.h"
+#include "fatpup/position.h"
+
+namespace fatpup
+{
+    // Endgame tablebases: the result and the distance to mate of every position of an ending
+    // with up to maxPieces pieces (the kings included), for either side to move. A table is
+    // named after its material, white first, e.g. "KQvKR". The stronger side is always white
+    // in the table, the positions the other way round are probed with the colors flipped.
+    // Castlings are not possible in the tables. En passant captures are not either: a ply is
+    // searched when probing a position where one is possible, and the generator scores a double
+    // pawn move an en passant capture can answer from both the capture and the position after it.
+    // The 50-move rule is ignored.
+    //
+    // Table file "<material>.fptb":
+    //   header:  "FPTB", u32 version, u32 piece count, material name (8 bytes, zero padded),
+    //            u64 position count (per side to move)
+    //   values:  a byte per position, white to move first, then black to move. 0 is a draw (or
+    //            not a legal position), otherwise the distance to mate in plies + 1: odd
+    //            distances are won by the side to move, even ones lost (0 is a checkmate).
+    // The positions are indexed by the pieces' squares: the white king, the black king, then
+    // the other white and black pieces in the order of the name, 64 squares each (48 for a
+    // pawn). The board is turned so that the white king is in the a1-d1-d4 triangle when there
+    // are no pawns, or mirrored so that it's on the a-d files when there are
+    class Tablebases
+    {
+    public:
+        static constexpr int                maxPieces = 4;
+        // the longest mate in plies the format can store
+        static constexpr int                maxDistance = 252;
+        static const char* const            fileExtension;
+
+        // the names of all the tables with up to piece_count pieces in an order they can be
+        // generated in: a table needs the ones captures and promotions lead to before it
+        static std::vector<std::string>     materials(int piece_count = maxPieces);
+        // the name of the table the position belongs to, e.g. "KRvKQ" becomes "KQvKR". flipped
+        // tells whether the colors are the other way round in the table
+        static std::string                  material(const Position& pos, bool* flipped = nullptr);
+
+        // loads all the tables found in the directory, returns how many there are
+        size_t                              open(const std::string& directory);
+        // returns false if the file can't be read or is not a table
+        bool                                add(const std::string& path);
+        void                                close() { m_tables.clear(); }
+
+        size_t                              tableCount() const { return m_tables.size(); }
+        bool                                hasTable(const std::string& material) const { return findTable(material) != nullptr; }
+
+        // wdl is 1 if the side to move wins, 0 if it's a draw, -1 if it loses. distance is the
+        // number of plies to mate, 0 for a draw. Returns false if there's no table for the
+        // position: too many pieces, castling rights or no such file.
+        // The kings alone are a draw, no table needed
+        bool                                probe(const Position& pos, int* wdl, int* distance) const;
+        // the move that keeps the best result: the fastest mate, the draw or the longest
+        // resistance. Empty if the position can't be probed or there are no moves. wdl and
+        // distance are the position's
+        Move                                bestMove(const Position& pos, int* wdl, int* distance) const;
+
+    private:
+        struct Table
+        {
+            std::string                     material;
+            // pieceWithColor() of the pieces in the index order
+            unsigned char                   pieces[maxPieces];
+            int                             piece_count;
+            std::unique_ptr<MappedFile>     file;
+            const unsigned char*            values;
+            unsigned long long              position_count;
+        };
+
+        const Table*                        findTable(const std::string& material) const;
+
+        std::vector<Table>                  m_tables;
+    };
+
+    // Retrograde generator of a table: the checkmates are found first, then the positions a
+    // move away from a lost one are won, and the positions where every move leads to a won
+    // one are lost, one ply further each pass. Only the positions a move can come from are
+    // looked at, they're found by taking the moves back. The captures and the promotions
+    // leave the table, their results come from the tables they lead to
+    class TablebaseGenerator
+    {
+    public:
+        // the tables the captures and the promotions lead to must be in subtables
+        explicit TablebaseGenerator(const Tablebases& subtables);
+
+        // returns false if the name is not a table one or a table it needs is missing
+        bool                                generate(const std::string& material, unsigned int thread_count = 1);
+        bool                                write(std::ostream& out) const;
+
+        // of the last generate(), positions of both sides to move
+        unsigned long long                  positionCount() const { return m_values.size(); }
+        unsigned long long                  winCount() const { return m_win_count; }
+        unsigned long long                  lossCount() const { return m_loss_count; }
+        // in plies
+        int                                 longestMate() const { return m_longest_mate; }
+
+    private:
+        const Tablebases&                   m_subtables;
+        std::string                         m_material;
+        std::vector<unsigned char>          m_values;
+        unsigned long long                  m_win_count;
+        unsigned long long                  m_loss_count;
+        int                                 m_longest_mate;
+    };
+
+}   // namespace fatpup
+
+#endif // FATPUP_TABLEBASE_H
@@ -0,0 +1,65 @@
+#ifndef FATPUP_BYTE_IO_H
+#define FATPUP_BYTE_IO_H
+
+#include <vector>
+
+// Little-endian integers and LEB128 varints for the binary file formats (game archives,
+// position index). Internal header, not installed
+namespace fatpup
+{
+    inline void putU32(std::vector<unsigned char>* out, unsigned int value)
+    {
+        for (int b = 0; b < 4; ++b)
+            out->push_back((unsigned char)(value >> (b * 8)));
+    }
+
+    inline void putU64(std::vector<unsigned char>* out, unsigned long long value)
+    {
+        for (int b = 0; b < 8; ++b)
+            out->push_back((unsigned char)(value >> (b * 8)));
+    }
+
+    inline void putVarint(std::vector<unsigned char>* out, unsigned long long value)
+    {
+        while (value >= 0x80)
+        {
+            out->push_back((unsigned char)(value | 0x80));
+            value >>= 7;
+        }
+        out->push_back((unsigned char)value);
+    }
+
+    inline unsigned int getU32(const unsigned char* data)
+    {
+        unsigned int value = 0;
+        for (int b = 3; b >= 0; --b)
+            value = (value << 8) | data[b];
+        return value;
+    }
+
+    inline unsigned long long getU64(const unsigned char* data)
+    {
+        unsigned long long value = 0;
+        for (int b = 7; b >= 0; --b)
+            value = (value << 8) | data[b];
+        return value;
+    }
+
+    // returns false if the varint runs past end
+    inline bool getVarint(const unsigned char** data, const unsigned char* end, unsigned long long* value)
+    {
+        *value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (*data >= end)
+                return false;
+            const unsigned char byte = *(*data)++;
+            *value |= (unsigned long long)(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+}   // namespace fatpup
+
+#endif // FATPUP_BYTE_IO_H
@@ -0,0 +1,145 @@
+#include "fatpup/epd.h"
+
+namespace fatpup
+{
+    std::string EpdRecord::operation(const std::string& opcode) const
+    {
+        for (const auto& op : operations)
+        {
+            if (op.first == opcode)
+                return op.second;
+        }
+        return std::string();
+    }
+
+    bool EpdRecord::isSolvedBy(Move move) const
+    {
+        if (best_moves.empty() && avoid_moves.empty())
+            return false;
+
+        for (const auto& avoid_move : avoid_moves)
+        {
+            if (move == avoid_move)
+                return false;
+        }
+
+        if (best_moves.empty())
+            return true;
+
+        for (const auto& best_move : best_moves)
+        {
+            if (move == best_move)
+                return true;
+        }
+        return false;
+    }
+
+    // splits "Nf3 e4" into moves resolved in pos, returns false if any of them is illegal
+    static bool parseSanList(const Position& pos, const std::string& operand, std::vector<Move>* moves)
+    {
+        size_t start = 0;
+        while (start < operand.length())
+        {
+            const size_t space = operand.find(' ', start);
+            const size_t end = (space == std::string::npos) ? operand.length() : space;
+            if (end > start)
+            {
+                const Move move = pos.moveFromStringPGN(operand.substr(start, end - start));
+                if (move.isEmpty())
+                    return false;
+                moves->push_back(move);
+            }
+            start = end + 1;
+        }
+
+        return true;
+    }
+
+    bool parseEpd(const std::string& line, EpdRecord* record)
+    {
+        // the four mandatory fields: placement, side to move, castling, en passant
+        size_t pos = 0;
+        for (int field = 0; field < 4; ++field)
+        {
+            while (pos < line.length() && line[pos] == ' ')
+                ++pos;
+            if (pos == line.length())
+                return false;
+            while (pos < line.length() && line[pos] != ' ')
+                ++pos;
+        }
+
+        EpdRecord result;
+        result.fen = line.substr(line.find_first_not_of(' '), pos - line.find_first_not_of(' '));
+        if (!result.pos.setFEN(result.fen))
+            return false;
+
+        // operations: "opcode [operand...];" where operands may be quoted strings
+        while (pos < line.length())
+        {
+            while (pos < line.length() && (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\r' || line[pos] == '\n'))
+                ++pos;
+            if (pos == line.length())
+                break;
+
+            const size_t opcode_start = pos;
+            while (pos < line.length() && line[pos] != ' ' && line[pos] != ';')
+                ++pos;
+            const std::string opcode = line.substr(opcode_start, pos - opcode_start);
+
+            std::string operand;
+            bool in_quotes = false;
+            while (pos < line.length() && (in_quotes || line[pos] != ';'))
+            {
+                const char c = line[pos++];
+                if (c == '"')
+                    in_quotes = !in_quotes;
+                else if (in_quotes || c != ' ' || (!operand.empty() && operand.back() != ' '))
+                    operand += c;
+            }
+            if (in_quotes)
+                return false;
+            if (pos < line.length())
+                ++pos;  // ';'
+            while (!operand.empty() && operand.back() == ' ')
+                operand.pop_back();
+
+            if (opcode == "bm" && !parseSanList(result.pos, operand, &result.best_moves))
+                return false;
+            if (opcode == "am" && !parseSanList(result.pos, operand, &result.avoid_moves))
+                return false;
+            if (opcode == "id")
+                result.id = operand;
+
+            result.operations.emplace_back(opcode, operand);
+        }
+
+        *record = result;
+        return true;
+    }
+
+    bool readEpd(std::istream& in, std::vector<EpdRecord>* records, size_t* error_line)
+    {
+        std::string line;
+        size_t line_number = 0;
+        while (std::getline(in, line))
+        {
+            ++line_number;
+
+            const size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#')
+                continue;
+
+            EpdRecord record;
+            if (!parseEpd(line, &record))
+            {
+                if (error_line)
+                    *error_line = line_number;
+                return false;
+            }
+            records->push_back(record);
+        }
+
+        return true;
+    }
+}   // namespace fatpup
@@ -0,0 +1,299 @@
+#include <cstdint>
+#include <cstring>
+
+#include "fatpup/game_codec.h"
+#include "byte_io.h"
+
+namespace fatpup
+{
+    static constexpr char archiveMagic[4] = { 'F', 'P', 'G', 'A' };
+    static constexpr unsigned int archiveVersion = 1;
+    static constexpr size_t archiveTrailerSize = 8 + 8 + 4 + 4;
+
+    enum
+    {
+        CustomStartPosition = 1,
+        BitCodedMoves = 2
+    };
+
+    // number of bits needed to store an index in [0, num_moves)
+    static unsigned int indexWidth(size_t num_moves)
+    {
+        unsigned int width = 0;
+        while (((size_t)1 << width) < num_moves)
+            ++width;
+        return width;
+    }
+
+
+    GameEncoder::GameEncoder(const Position& start_pos, MoveCoding coding):
+        m_start_pos(start_pos),
+        m_pos(start_pos),
+        m_coding(coding),
+        m_ply_count(0),
+        m_bit_count(0)
+    {
+    }
+
+    bool GameEncoder::addMove(Move move)
+    {
+        const auto moves = m_pos.possibleMoves();
+
+        size_t move_idx = 0;
+        while (move_idx < moves.size() && moves[move_idx] != move)
+            ++move_idx;
+        if (move_idx == moves.size())
+            return false;
+
+        if (m_coding == MoveCoding::Bytes)
+            m_data.push_back((unsigned char)move_idx);
+        else
+        {
+            const unsigned int width = indexWidth(moves.size());
+            for (unsigned int bit = 0; bit < width; ++bit, ++m_bit_count)
+            {
+                if ((m_bit_count & 7) == 0)
+                    m_data.push_back(0);
+                if (move_idx & ((size_t)1 << bit))
+                    m_data.back() |= (unsigned char)(1 << (m_bit_count & 7));
+            }
+        }
+
+        m_pos += move;
+        ++m_ply_count;
+        return true;
+    }
+
+
+    GameDecoder::GameDecoder():
+        m_data(nullptr),
+        m_size(0),
+        m_plies_left(0),
+        m_bit_pos(0),
+        m_coding(MoveCoding::Bits),
+        m_corrupted(false)
+    {
+        m_pos.setEmpty();
+    }
+
+    GameDecoder::GameDecoder(const Position& start_pos, const unsigned char* data, size_t size, size_t ply_count, MoveCoding coding):
+        m_pos(start_pos),
+        m_data(data),
+        m_size(size),
+        m_plies_left(ply_count),
+        m_bit_pos(0),
+        m_coding(coding),
+        m_corrupted(false)
+    {
+    }
+
+    bool GameDecoder::nextMove(Move* move)
+    {
+        if (!m_plies_left || m_corrupted)
+            return false;
+
+        const auto moves = m_pos.possibleMoves();
+
+        size_t move_idx = 0;
+        if (m_coding == MoveCoding::Bytes)
+        {
+            if (m_bit_pos / 8 >= m_size)
+                m_corrupted = true;
+            else
+            {
+                move_idx = m_data[m_bit_pos / 8];
+                m_bit_pos += 8;
+            }
+        }
+        else
+        {
+            const unsigned int width = indexWidth(moves.size());
+            if (m_bit_pos + width > m_size * 8)
+                m_corrupted = true;
+            else
+            {
+                for (unsigned int bit = 0; bit < width; ++bit, ++m_bit_pos)
+                {
+                    if (m_data[m_bit_pos / 8] & (1 << (m_bit_pos & 7)))
+                        move_idx |= (size_t)1 << bit;
+                }
+            }
+        }
+
+        if (move_idx >= moves.size())
+            m_corrupted = true;
+        if (m_corrupted)
+            return false;
+
+        *move = moves[move_idx];
+        m_pos += *move;
+        --m_plies_left;
+        return true;
+    }
+
+
+    GameArchiveWriter::GameArchiveWriter(std::ostream& out, MoveCoding coding):
+        m_out(out),
+        m_coding(coding),
+        m_offset(0),
+        m_finished(false)
+    {
+    }
+
+    GameArchiveWriter::~GameArchiveWriter()
+    {
+        finish();
+    }
+
+    bool GameArchiveWriter::addGame(const Position& start_pos, const std::vector<Move>& moves)
+    {
+        GameEncoder encoder(start_pos, m_coding);
+        for (const auto move: moves)
+        {
+            if (!encoder.addMove(move))
+                return false;
+        }
+
+        return addGame(encoder);
+    }
+
+    bool GameArchiveWriter::addGame(const GameEncoder& encoder)
+    {
+        if (m_finished || !m_out.good())
+            return false;
+
+        Position initial_pos;
+        initial_pos.setInitial();
+        const bool custom_start_pos = (encoder.startPosition() != initial_pos);
+
+        m_record.clear();
+        m_record.push_back((unsigned char)((custom_start_pos ? CustomStartPosition : 0) |
+                                           (encoder.coding() == MoveCoding::Bits ? BitCodedMoves : 0)));
+        if (custom_start_pos)
+        {
+            for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+                m_record.push_back(encoder.startPosition().square(s_idx / BOARD_SIZE, s_idx % BOARD_SIZE).state());
+        }
+        putVarint(&m_record, encoder.plyCount());
+        putVarint(&m_record, encoder.data().size());
+        m_record.insert(m_record.end(), encoder.data().begin(), encoder.data().end());
+
+        m_out.write((const char*)m_record.data(), (std::streamsize)m_record.size());
+        if (!m_out.good())
+            return false;
+
+        m_offsets.push_back(m_offset);
+        m_offset += m_record.size();
+        return true;
+    }
+
+    bool GameArchiveWriter::finish()
+    {
+        if (m_finished)
+            return m_out.good();
+        m_finished = true;
+
+        std::vector<unsigned char> tail;
+        tail.reserve(m_offsets.size() * 8 + archiveTrailerSize);
+        for (const auto offset: m_offsets)
+            putU64(&tail, offset);
+        putU64(&tail, m_offset);
+        putU64(&tail, m_offsets.size());
+        tail.insert(tail.end(), archiveMagic, archiveMagic + sizeof(archiveMagic));
+        putU32(&tail, archiveVersion);
+
+        m_out.write((const char*)tail.data(), (std::streamsize)tail.size());
+        m_out.flush();
+        return m_out.good();
+    }
+
+
+    GameArchiveReader::GameArchiveReader():
+        m_data(nullptr),
+        m_size(0),
+        m_index(nullptr),
+        m_game_count(0)
+    {
+    }
+
+    bool GameArchiveReader::open(const unsigned char* data, size_t size)
+    {
+        m_data = nullptr;
+        m_size = 0;
+        m_index = nullptr;
+        m_game_count = 0;
+
+        if (!data || size < archiveTrailerSize)
+            return false;
+
+        const unsigned char* trailer = data + size - archiveTrailerSize;
+        if (std::memcmp(trailer + 16, archiveMagic, sizeof(archiveMagic)) != 0 || getU32(trailer + 20) != archiveVersion)
+            return false;
+
+        const unsigned long long index_offset = getU64(trailer);
+        const unsigned long long game_count = getU64(trailer + 8);
+        if (index_offset > size - archiveTrailerSize || game_count > (size - archiveTrailerSize - index_offset) / 8)
+            return false;
+
+        m_data = data;
+        m_size = size;
+        m_index = data + index_offset;
+        m_game_count = (size_t)game_count;
+        return true;
+    }
+
+    bool GameArchiveReader::gameDecoder(size_t game_idx, GameDecoder* decoder) const
+    {
+        if (game_idx >= m_game_count)
+            return false;
+
+        const unsigned long long offset = getU64(m_index + game_idx * 8);
+        const unsigned char* end = m_index;
+        if (offset >= (unsigned long long)(end - m_data))
+            return false;
+
+        const unsigned char* record = m_data + offset;
+        const unsigned char flags = *record++;
+
+        Position start_pos;
+        if (flags & CustomStartPosition)
+        {
+            if (end - record < BOARD_SIZE * BOARD_SIZE)
+                return false;
+
+            for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+                start_pos.square(s_idx / BOARD_SIZE, s_idx % BOARD_SIZE) = *record++;
+        }
+        else
+            start_pos.setInitial();
+
+        unsigned long long ply_count = 0;
+        unsigned long long data_size = 0;
+        if (!getVarint(&record, end, &ply_count) || !getVarint(&record, end, &data_size) || data_size > (unsigned long long)(end - record))
+            return false;
+
+        // a byte-coded ply takes a byte, a bit-coded one none when the move is the only one
+        const MoveCoding coding = (flags & BitCodedMoves) ? MoveCoding::Bits : MoveCoding::Bytes;
+        if (ply_count > (unsigned long long)SIZE_MAX || (coding == MoveCoding::Bytes && ply_count > data_size))
+            return false;
+
+        *decoder = GameDecoder(start_pos, record, (size_t)data_size, (size_t)ply_count, coding);
+        return true;
+    }
+
+    bool GameArchiveReader::readGame(size_t game_idx, Position* start_pos, std::vector<Move>* moves) const
+    {
+        GameDecoder decoder;
+        if (!gameDecoder(game_idx, &decoder))
+            return false;
+
+        *start_pos = decoder.position();
+        moves->clear();
+
+        Move move;
+        while (decoder.nextMove(&move))
+            moves->push_back(move);
+
+        return !decoder.isCorrupted();
+    }
+}   // namespace fatpup
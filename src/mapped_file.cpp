@@ -0,0 +1,86 @@
+#include <fstream>
+#include <iterator>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "fatpup/mapped_file.h"
+
+namespace fatpup
+{
+    MappedFile::MappedFile():
+        m_data(nullptr),
+        m_size(0),
+        m_mapped(false)
+    {
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    bool MappedFile::open(const std::string& path)
+    {
+        close();
+
+#if !defined(_WIN32)
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+        {
+            if (st.st_size <= 0)
+            {
+                ::close(fd);
+                return false;
+            }
+
+            void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                ::close(fd);
+                m_data = (const unsigned char*)data;
+                m_size = (size_t)st.st_size;
+                m_mapped = true;
+                return true;
+            }
+        }
+        ::close(fd);
+#endif
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+
+        m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (m_buffer.empty() || file.bad())
+        {
+            m_buffer.clear();
+            return false;
+        }
+
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+#if !defined(_WIN32)
+        if (m_mapped)
+            munmap((void*)m_data, m_size);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+        m_mapped = false;
+        m_buffer.clear();
+        m_buffer.shrink_to_fit();
+    }
+}   // namespace fatpup
@@ -0,0 +1,250 @@
+#include <algorithm>
+
+#include "fatpup/mate_solver.h"
+#include "fatpup/polyglot.h"
+
+namespace fatpup
+{
+    // a proven or disproven node has one of its numbers at infinity, the other one at 0
+    static constexpr unsigned int infinity = 1u << 30;
+
+    // the numbers are at most infinity, so the sum can't overflow
+    static unsigned int addNumbers(unsigned int a, unsigned int b)
+    {
+        return (a + b < infinity) ? a + b : infinity;
+    }
+
+    MateSolver::MateSolver(unsigned int hash_size_mb):
+        m_generation(0),
+        m_checks_only(true),
+        m_node_limit(0),
+        m_node_count(0)
+    {
+        // a power of two, so that the index is just the lower bits of the key
+        size_t entries = 1;
+        while (entries * 2 * sizeof(Entry) <= (size_t)hash_size_mb * 1024 * 1024)
+            entries *= 2;
+        m_table.resize(entries, Entry());
+    }
+
+    int MateSolver::findMate(const Position& pos, int max_moves, std::vector<Move>* line)
+    {
+        // the entries of the previous searches are told by their generation, the table is
+        // only cleared when the counter wraps around
+        if (++m_generation == 0)
+        {
+            std::fill(m_table.begin(), m_table.end(), Entry());
+            m_generation = 1;
+        }
+        m_node_count = 0;
+        if (line)
+            line->clear();
+
+        // a mate in n moves is proven with the results of the searches for fewer moves at hand
+        const unsigned long long key = polyglotKey(pos);
+        for (int moves = 1; moves <= max_moves && !nodeLimitReached(); ++moves)
+        {
+            if (proveMate(pos, key, moves, true))
+            {
+                if (line)
+                    appendLine(pos, key, moves, line);
+                return moves;
+            }
+        }
+
+        return 0;
+    }
+
+    bool MateSolver::probe(unsigned long long key, int moves_left, unsigned int* phi, unsigned int* delta) const
+    {
+        const Entry& entry = m_table[(key ^ (unsigned long long)moves_left * 0x9e3779b97f4a7c15ULL) & (m_table.size() - 1)];
+        if (entry.key != key || entry.moves_left != moves_left || entry.generation != m_generation)
+            return false;
+
+        *phi = entry.phi;
+        *delta = entry.delta;
+        return true;
+    }
+
+    void MateSolver::store(unsigned long long key, int moves_left, unsigned int phi, unsigned int delta)
+    {
+        Entry& entry = m_table[(key ^ (unsigned long long)moves_left * 0x9e3779b97f4a7c15ULL) & (m_table.size() - 1)];
+        entry.key = key;
+        entry.phi = phi;
+        entry.delta = delta;
+        entry.moves_left = (unsigned short)moves_left;
+        entry.generation = m_generation;
+    }
+
+    std::vector<Move> MateSolver::attackerMoves(const Position& pos, int moves_left) const
+    {
+        return (m_checks_only || moves_left == 1) ? pos.possibleChecks() : pos.possibleMoves();
+    }
+
+    void MateSolver::mid(const Position& pos, unsigned long long key, int moves_left, bool attacker,
+                         unsigned int phi_threshold, unsigned int delta_threshold,
+                         unsigned int* phi, unsigned int* delta)
+    {
+        ++m_node_count;
+
+        struct Child
+        {
+            Position            pos;
+            unsigned long long  key;
+            unsigned int        phi;
+            unsigned int        delta;
+        };
+        std::vector<Child> children;
+
+        // getState() tells the mates and the stalemates right away, only the other moves are
+        // searched. The attacker's moves that don't mate at the last move are no good either.
+        // The defender has no mates and stalemates of its own, its moves are all searched
+        const auto moves = attacker ? attackerMoves(pos, moves_left) : pos.possibleMoves();
+        const int child_moves_left = attacker ? moves_left - 1 : moves_left;
+        children.reserve(moves.size());
+        for (const auto move: moves)
+        {
+            Child child;
+            child.pos = Position(pos, move);
+            if (attacker)
+            {
+                const auto state = child.pos.getState();
+                if (state == Position::State::Checkmate)
+                {
+                    *phi = 0;
+                    *delta = infinity;
+                    store(key, moves_left, *phi, *delta);
+                    return;
+                }
+                if (state == Position::State::Stalemate || moves_left == 1)
+                    continue;
+            }
+
+            child.key = polyglotKeyAfterMove(pos, key, move, child.pos);
+            if (!probe(child.key, child_moves_left, &child.phi, &child.delta))
+                child.phi = child.delta = 1;
+            children.push_back(child);
+        }
+
+        // the node is won if any child is lost for the opponent, and lost if all of them are
+        // won: phi is the smallest child delta, delta is the sum of the child phis. The child
+        // closest to a proof is searched until it's no longer the closest one or the node
+        // reaches its thresholds
+        for (;;)
+        {
+            unsigned int min_delta = infinity;
+            unsigned int second_delta = infinity;
+            unsigned int phi_sum = 0;
+            size_t best_child = 0;
+            for (size_t c = 0; c < children.size(); ++c)
+            {
+                phi_sum = addNumbers(phi_sum, children[c].phi);
+                if (children[c].delta < min_delta)
+                {
+                    second_delta = min_delta;
+                    min_delta = children[c].delta;
+                    best_child = c;
+                }
+                else if (children[c].delta < second_delta)
+                    second_delta = children[c].delta;
+            }
+
+            *phi = min_delta;
+            *delta = phi_sum;
+            if (*phi >= phi_threshold || *delta >= delta_threshold || nodeLimitReached())
+                break;
+
+            Child& child = children[best_child];
+            const unsigned long long child_phi_threshold = (unsigned long long)delta_threshold - *delta + child.phi;
+            const unsigned int child_delta_threshold = std::min(phi_threshold, addNumbers(second_delta, 1));
+            mid(child.pos, child.key, child_moves_left, !attacker,
+                (child_phi_threshold < infinity) ? (unsigned int)child_phi_threshold : infinity, child_delta_threshold,
+                &child.phi, &child.delta);
+        }
+
+        store(key, moves_left, *phi, *delta);
+    }
+
+    bool MateSolver::proveMate(const Position& pos, unsigned long long key, int moves_left, bool attacker)
+    {
+        unsigned int phi = 0;
+        unsigned int delta = 0;
+        mid(pos, key, moves_left, attacker, infinity, infinity, &phi, &delta);
+        return attacker ? (phi == 0) : (delta == 0);
+    }
+
+    void MateSolver::appendLine(Position pos, unsigned long long key, int moves_left, std::vector<Move>* line)
+    {
+        // the proofs are mostly in the hash table by now, so the searches below are short
+        for (;;)
+        {
+            // the attacker mates right away if it can, or makes a move the mate in the moves left
+            // follows anyway
+            const auto moves = attackerMoves(pos, moves_left);
+            Move mate_move;
+            for (const auto move: moves)
+            {
+                if (Position(pos, move).getState() == Position::State::Checkmate)
+                {
+                    mate_move = move;
+                    break;
+                }
+            }
+            if (!mate_move.isEmpty() || moves_left == 1)
+            {
+                if (!mate_move.isEmpty())
+                    line->push_back(mate_move);
+                return;
+            }
+
+            Move attacker_move;
+            for (const auto move: moves)
+            {
+                const Position next_pos(pos, move);
+                const unsigned long long next_key = polyglotKeyAfterMove(pos, key, move, next_pos);
+                if (next_pos.getState() != Position::State::Stalemate && proveMate(next_pos, next_key, moves_left - 1, false))
+                {
+                    attacker_move = move;
+                    pos = next_pos;
+                    key = next_key;
+                    break;
+                }
+            }
+            if (attacker_move.isEmpty())
+                return;
+            line->push_back(attacker_move);
+            --moves_left;
+
+            // the defender puts the mate off as long as it can
+            Move defender_move;
+            Position defender_pos;
+            unsigned long long defender_key = 0;
+            int defender_moves_left = 0;
+            for (const auto move: pos.possibleMoves())
+            {
+                const Position next_pos(pos, move);
+                const unsigned long long next_key = polyglotKeyAfterMove(pos, key, move, next_pos);
+                for (int m = 1; m <= moves_left; ++m)
+                {
+                    if (proveMate(next_pos, next_key, m, true))
+                    {
+                        if (m > defender_moves_left)
+                        {
+                            defender_move = move;
+                            defender_pos = next_pos;
+                            defender_key = next_key;
+                            defender_moves_left = m;
+                        }
+                        break;
+                    }
+                }
+            }
+            if (defender_move.isEmpty())
+                return;
+            line->push_back(defender_move);
+            pos = defender_pos;
+            key = defender_key;
+            moves_left = defender_moves_left;
+        }
+    }
+}   // namespace fatpup
@@ -0,0 +1,220 @@
+#include "fatpup/pgn_reader.h"
+
+namespace fatpup
+{
+    static constexpr int eof = std::char_traits<char>::eof();
+
+    static bool isSpace(int c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    static bool isResult(const std::string& token)
+    {
+        return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+    }
+
+    PgnReader::PgnReader(std::istream& in):
+        m_buf(in.rdbuf()),
+        m_max_plies((size_t)-1),
+        m_game_count(0),
+        m_error_count(0)
+    {
+    }
+
+    // returns false at the end of the input
+    bool PgnReader::skipSpaces()
+    {
+        int c = peekChar();
+        while (isSpace(c))
+        {
+            nextChar();
+            c = peekChar();
+        }
+        return c != eof;
+    }
+
+    void PgnReader::skipLine()
+    {
+        int c = nextChar();
+        while (c != '\n' && c != eof)
+            c = nextChar();
+    }
+
+    // [Name "value"], the opening bracket is already consumed
+    bool PgnReader::readTag(PgnTag* tag)
+    {
+        tag->name.clear();
+        tag->value.clear();
+
+        skipSpaces();
+        int c = peekChar();
+        while (c != eof && !isSpace(c) && c != '"' && c != ']')
+        {
+            tag->name += (char)nextChar();
+            c = peekChar();
+        }
+
+        skipSpaces();
+        if (nextChar() != '"')
+        {
+            skipLine();
+            return false;
+        }
+
+        for (c = nextChar(); c != '"' && c != eof && c != '\n'; c = nextChar())
+        {
+            if (c == '\\')
+                c = nextChar();
+            tag->value += (char)c;
+        }
+
+        // the rest of the line, normally just "]"
+        skipLine();
+        return c == '"' && !tag->name.empty();
+    }
+
+    // a symbol token (SAN, move number, result), stops at anything that can't be its part
+    void PgnReader::readToken(std::string* token)
+    {
+        token->clear();
+        int c = peekChar();
+        while (c != eof && !isSpace(c) && c != '{' && c != '}' && c != '(' && c != ')' && c != ';' && c != '[' && c != ']' && c != '$')
+        {
+            token->push_back((char)nextChar());
+            c = peekChar();
+        }
+    }
+
+    bool PgnReader::readGame(std::vector<PgnTag>* tags, Position* start_pos, std::vector<Move>* moves, std::string* result)
+    {
+        tags->clear();
+        moves->clear();
+        result->clear();
+
+        bool bad_game = false;
+        std::string fen;
+
+        // tag pair section, '%' lines are escaped data by the standard
+        while (skipSpaces())
+        {
+            const int c = peekChar();
+            if (c == '%')
+                skipLine();
+            else if (c == '[')
+            {
+                nextChar();
+                PgnTag tag;
+                if (readTag(&tag))
+                {
+                    if (tag.name == "FEN")
+                        fen = tag.value;
+                    tags->push_back(std::move(tag));
+                }
+            }
+            else
+                break;
+        }
+
+        if (tags->empty() && peekChar() == eof)
+            return false;
+
+        if (fen.empty())
+            start_pos->setInitial();
+        else if (!start_pos->setFEN(fen))
+        {
+            start_pos->setInitial();
+            bad_game = true;
+        }
+
+        Position pos = *start_pos;
+        int variation_depth = 0;
+
+        // movetext, it ends with a result or where the next game's tags start
+        while (skipSpaces())
+        {
+            const int c = peekChar();
+            if (c == '{')
+            {
+                nextChar();
+                for (int comment_c = nextChar(); comment_c != '}' && comment_c != eof; comment_c = nextChar())
+                    ;
+                continue;
+            }
+            if (c == ';' || c == '%')
+            {
+                skipLine();
+                continue;
+            }
+            if (c == '(')
+            {
+                nextChar();
+                ++variation_depth;
+                continue;
+            }
+            if (c == ')')
+            {
+                nextChar();
+                if (variation_depth > 0)
+                    --variation_depth;
+                continue;
+            }
+            if (c == '[')
+            {
+                // no result, the next game begins
+                if (variation_depth == 0)
+                    break;
+                nextChar();
+                continue;
+            }
+            if (c == '$' || c == '}' || c == ']')
+            {
+                // NAG ("$14") or garbage
+                nextChar();
+                readToken(&m_token);
+                continue;
+            }
+
+            readToken(&m_token);
+            if (variation_depth > 0)
+                continue;
+
+            if (isResult(m_token))
+            {
+                *result = m_token;
+                break;
+            }
+
+            // move number: "12." or "12...", possibly glued to the move ("12.e4")
+            size_t san_start = 0;
+            while (san_start < m_token.length() && m_token[san_start] >= '0' && m_token[san_start] <= '9')
+                ++san_start;
+            if (san_start < m_token.length() && m_token[san_start] == '.')
+            {
+                while (san_start < m_token.length() && m_token[san_start] == '.')
+                    ++san_start;
+            }
+            else
+                san_start = 0;
+
+            if (san_start == m_token.length() || bad_game || moves->size() >= m_max_plies)
+                continue;
+
+            const Move move = pos.moveFromStringPGN(san_start ? m_token.substr(san_start) : m_token);
+            if (move.isEmpty())
+            {
+                bad_game = true;
+                continue;
+            }
+
+            moves->push_back(move);
+            pos += move;
+        }
+
+        ++m_game_count;
+        if (bad_game)
+            ++m_error_count;
+
+        return true;
+    }
+}   // namespace fatpup
@@ -0,0 +1,313 @@
+#include <cerrno>
+#include <cstring>
+
+#if defined(_WIN32)
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+#include "fatpup/pgn_writer.h"
+
+namespace fatpup
+{
+    static constexpr char sanPieceSymbols[] = { ' ', ' ', 'N', 'B', 'R', 'Q', 'K' };
+
+    // the longest token we produce is a move number ("1234...") or SAN ("Qh4xe1#", "exd8=Q#")
+    static constexpr size_t maxTokenLength = 16;
+
+    PgnWriter::PgnWriter(std::ostream& out, size_t buffer_size):
+        m_out(&out),
+        m_fd(-1),
+        m_buffer(buffer_size < maxTokenLength * 4 ? maxTokenLength * 4 : buffer_size),
+        m_used(0),
+        m_line_length(defaultLineLength),
+        m_column(0),
+        m_failed(false),
+        m_bytes_written(0)
+    {
+    }
+
+    PgnWriter::PgnWriter(int fd, size_t buffer_size):
+        m_out(nullptr),
+        m_fd(fd),
+        m_buffer(buffer_size < maxTokenLength * 4 ? maxTokenLength * 4 : buffer_size),
+        m_used(0),
+        m_line_length(defaultLineLength),
+        m_column(0),
+        m_failed(false),
+        m_bytes_written(0)
+    {
+    }
+
+    PgnWriter::~PgnWriter()
+    {
+        flush();
+    }
+
+    bool PgnWriter::writeOut(const char* data, size_t length)
+    {
+        if (m_failed)
+            return false;
+
+        const size_t total_length = length;
+        if (m_out)
+        {
+            m_out->write(data, (std::streamsize)length);
+            m_failed = !m_out->good();
+        }
+        else
+        {
+            while (length > 0)
+            {
+#if defined(_WIN32)
+                const int written = _write(m_fd, data, (unsigned int)length);
+#else
+                const ssize_t written = ::write(m_fd, data, length);
+#endif
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    m_failed = true;
+                    break;
+                }
+                data += written;
+                length -= (size_t)written;
+            }
+        }
+
+        if (!m_failed)
+            m_bytes_written += total_length;
+
+        return !m_failed;
+    }
+
+    bool PgnWriter::flush()
+    {
+        if (m_used > 0)
+        {
+            writeOut(m_buffer.data(), m_used);
+            m_used = 0;
+        }
+
+        if (m_out && !m_failed)
+        {
+            m_out->flush();
+            m_failed = !m_out->good();
+        }
+
+        return !m_failed;
+    }
+
+    void PgnWriter::append(const char* data, size_t length)
+    {
+        if (m_used + length > m_buffer.size())
+        {
+            writeOut(m_buffer.data(), m_used);
+            m_used = 0;
+
+            // too big to be buffered (a huge tag value), pass it through
+            if (length > m_buffer.size())
+            {
+                writeOut(data, length);
+                return;
+            }
+        }
+
+        std::memcpy(m_buffer.data() + m_used, data, length);
+        m_used += length;
+    }
+
+    void PgnWriter::appendChar(char c)
+    {
+        if (m_used == m_buffer.size())
+        {
+            writeOut(m_buffer.data(), m_used);
+            m_used = 0;
+        }
+
+        m_buffer[m_used++] = c;
+    }
+
+    void PgnWriter::newLine()
+    {
+        appendChar('\n');
+        m_column = 0;
+    }
+
+    void PgnWriter::appendToken(const char* token, size_t length)
+    {
+        if (m_column > 0)
+        {
+            if (m_column + 1 + (int)length > m_line_length)
+                newLine();
+            else
+            {
+                appendChar(' ');
+                ++m_column;
+            }
+        }
+
+        append(token, length);
+        m_column += (int)length;
+    }
+
+    size_t PgnWriter::moveToSAN(const Position& pos, Move move, const Position& new_pos, char* san)
+    {
+        // this is Position::moveToStringPGN() minus the temporary strings and the full
+        // possibleMoves() call: other pieces are only asked for their moves to the
+        // destination square if there are pieces of the same kind on the board at all
+        size_t length = 0;
+
+        if (move.fields.rook_src_col != move.fields.rook_dst_col)
+        {
+            // castling
+            const char* castling = (move.fields.rook_src_col == COLA) ? "O-O-O" : "O-O";
+            while (*castling)
+                san[length++] = *castling++;
+        }
+        else
+        {
+            const Square& src_square = pos.square(move.fields.src_row, move.fields.src_col);
+            const unsigned char piece = src_square.piece();
+            const bool capture = pos.isMoveCapture(move);
+
+            if (piece != Pawn)
+            {
+                san[length++] = sanPieceSymbols[piece];
+
+                if (piece != King)
+                {
+                    const unsigned char piece_with_color = src_square.pieceWithColor();
+                    const int src_idx = rowColToIdx(move.fields.src_row, move.fields.src_col);
+
+                    bool ambiguous = false;
+                    bool same_file = false;
+                    bool same_rank = false;
+
+                    for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+                    {
+                        if (s_idx == src_idx || pos.square(s_idx / BOARD_SIZE, s_idx % BOARD_SIZE).pieceWithColor() != piece_with_color)
+                            continue;
+
+                        const RowCol rc = idxToRowCol(s_idx);
+                        if (pos.possibleMoves(rc.row, rc.col, move.fields.dst_row, move.fields.dst_col).empty())
+                            continue;
+
+                        ambiguous = true;
+                        if (rc.col == (int)move.fields.src_col)
+                            same_file = true;
+                        if (rc.row == (int)move.fields.src_row)
+                            same_rank = true;
+                    }
+
+                    if (ambiguous)
+                    {
+                        if (!same_file)
+                            san[length++] = (char)((int)('a') + move.fields.src_col);
+                        else if (!same_rank)
+                            san[length++] = (char)((int)('1') + move.fields.src_row);
+                        else
+                        {
+                            san[length++] = (char)((int)('a') + move.fields.src_col);
+                            san[length++] = (char)((int)('1') + move.fields.src_row);
+                        }
+                    }
+                }
+            }
+            else if (capture)
+                san[length++] = (char)((int)('a') + move.fields.src_col);
+
+            if (capture)
+                san[length++] = 'x';
+
+            san[length++] = (char)((int)('a') + move.fields.dst_col);
+            san[length++] = (char)((int)('1') + move.fields.dst_row);
+
+            if (move.fields.promoted_to > Pawn)
+            {
+                san[length++] = '=';
+                san[length++] = sanPieceSymbols[move.fields.promoted_to];
+            }
+        }
+
+        if (new_pos.isCheck())
+            san[length++] = (new_pos.getState() == Position::State::Checkmate) ? '#' : '+';
+
+        san[length] = '\0';
+        return length;
+    }
+
+    bool PgnWriter::writeGame(const std::vector<PgnTag>& tags, const Position& start_pos,
+                              const std::vector<Move>& moves, const std::string& result)
+    {
+        if (m_failed)
+            return false;
+
+        for (const auto& tag: tags)
+        {
+            appendChar('[');
+            append(tag.name.data(), tag.name.length());
+            append(" \"", 2);
+            for (const char c: tag.value)
+            {
+                if (c == '"' || c == '\\')
+                    appendChar('\\');
+                appendChar(c);
+            }
+            append("\"]\n", 3);
+        }
+        if (!tags.empty())
+            appendChar('\n');
+
+        m_column = 0;
+
+        Position pos = start_pos;
+        int move_number = 1;
+        bool number_needed = true;
+        char token[maxTokenLength];
+
+        for (const auto move: moves)
+        {
+            const bool white_turn = pos.isWhiteTurn();
+            if (white_turn || number_needed)
+            {
+                // "12." for white, "12..." if the movetext starts with a black move
+                int length = 0;
+                char digits[12];
+                int number = move_number;
+                do
+                {
+                    digits[length++] = (char)('0' + number % 10);
+                    number /= 10;
+                } while (number);
+
+                size_t token_length = 0;
+                while (length)
+                    token[token_length++] = digits[--length];
+                token[token_length++] = '.';
+                if (!white_turn)
+                {
+                    token[token_length++] = '.';
+                    token[token_length++] = '.';
+                }
+                appendToken(token, token_length);
+                number_needed = false;
+            }
+
+            const Position new_pos(pos, move);
+            appendToken(token, moveToSAN(pos, move, new_pos, token));
+            pos = new_pos;
+
+            if (!white_turn)
+                ++move_number;
+        }
+
+        appendToken(result.data(), result.length());
+        newLine();
+        newLine();
+
+        return !m_failed;
+    }
+}   // namespace fatpup
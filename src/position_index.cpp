@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cstring>
+
+#include "fatpup/polyglot.h"
+#include "fatpup/position_index.h"
+#include "byte_io.h"
+
+namespace fatpup
+{
+    static constexpr char indexMagic[4] = { 'F', 'P', 'P', 'I' };
+    static constexpr unsigned int indexVersion = 1;
+    static constexpr size_t indexTrailerSize = 8 + 8 + 8 + 4 + 4;
+
+    constexpr size_t PositionIndexBuilder::blockEntries;
+
+    void PositionIndexBuilder::addGame(unsigned int game_id, const Position& start_pos, const std::vector<Move>& moves)
+    {
+        Position pos = start_pos;
+        m_entries.push_back(PositionIndexEntry{polyglotKey(pos), game_id, 0});
+        for (size_t ply = 0; ply < moves.size(); ++ply)
+        {
+            pos += moves[ply];
+            m_entries.push_back(PositionIndexEntry{polyglotKey(pos), game_id, (unsigned int)ply + 1});
+        }
+    }
+
+    bool PositionIndexBuilder::addArchive(const GameArchiveReader& archive, unsigned int first_game_id)
+    {
+        bool ok = true;
+        for (size_t game_idx = 0; game_idx < archive.gameCount(); ++game_idx)
+        {
+            GameDecoder decoder;
+            if (!archive.gameDecoder(game_idx, &decoder))
+            {
+                ok = false;
+                continue;
+            }
+
+            // the positions are taken from the decoder, it replays the game anyway
+            const unsigned int game_id = first_game_id + (unsigned int)game_idx;
+            unsigned int ply = 0;
+            Move move;
+            m_entries.push_back(PositionIndexEntry{polyglotKey(decoder.position()), game_id, ply});
+            while (decoder.nextMove(&move))
+                m_entries.push_back(PositionIndexEntry{polyglotKey(decoder.position()), game_id, ++ply});
+
+            if (decoder.isCorrupted())
+                ok = false;
+        }
+
+        return ok;
+    }
+
+    void PositionIndexBuilder::merge(PositionIndexBuilder& other)
+    {
+        if (m_entries.empty())
+            m_entries.swap(other.m_entries);
+        else
+            m_entries.insert(m_entries.end(), other.m_entries.begin(), other.m_entries.end());
+
+        other.m_entries.clear();
+        other.m_entries.shrink_to_fit();
+    }
+
+    bool PositionIndexBuilder::write(std::ostream& out)
+    {
+        std::sort(m_entries.begin(), m_entries.end(), [](const PositionIndexEntry& lhs, const PositionIndexEntry& rhs)
+        {
+            if (lhs.key != rhs.key)
+                return lhs.key < rhs.key;
+            if (lhs.game_id != rhs.game_id)
+                return lhs.game_id < rhs.game_id;
+            return lhs.ply < rhs.ply;
+        });
+
+        std::vector<unsigned char> directory;
+        std::vector<unsigned char> block;
+        unsigned long long offset = 0;
+
+        for (size_t first = 0; first < m_entries.size(); first += blockEntries)
+        {
+            const size_t last = std::min(first + blockEntries, m_entries.size());
+
+            block.clear();
+            putVarint(&block, m_entries[first].game_id);
+            putVarint(&block, m_entries[first].ply);
+            for (size_t entry_idx = first + 1; entry_idx < last; ++entry_idx)
+            {
+                const PositionIndexEntry& prev = m_entries[entry_idx - 1];
+                const PositionIndexEntry& entry = m_entries[entry_idx];
+
+                putVarint(&block, entry.key - prev.key);
+                if (entry.key != prev.key)
+                {
+                    putVarint(&block, entry.game_id);
+                    putVarint(&block, entry.ply);
+                }
+                else if (entry.game_id != prev.game_id)
+                {
+                    putVarint(&block, entry.game_id - prev.game_id);
+                    putVarint(&block, entry.ply);
+                }
+                else
+                {
+                    putVarint(&block, 0);
+                    putVarint(&block, entry.ply - prev.ply);
+                }
+            }
+
+            putU64(&directory, m_entries[first].key);
+            putU64(&directory, offset);
+
+            out.write((const char*)block.data(), (std::streamsize)block.size());
+            offset += block.size();
+        }
+
+        const size_t block_count = directory.size() / 16;
+        putU64(&directory, offset);
+        putU64(&directory, block_count);
+        putU64(&directory, m_entries.size());
+        directory.insert(directory.end(), indexMagic, indexMagic + sizeof(indexMagic));
+        putU32(&directory, indexVersion);
+
+        out.write((const char*)directory.data(), (std::streamsize)directory.size());
+        out.flush();
+        return out.good();
+    }
+
+
+    PositionIndexReader::PositionIndexReader():
+        m_data(nullptr),
+        m_size(0),
+        m_directory(nullptr),
+        m_block_count(0),
+        m_entry_count(0)
+    {
+    }
+
+    bool PositionIndexReader::open(const unsigned char* data, size_t size)
+    {
+        m_data = nullptr;
+        m_size = 0;
+        m_directory = nullptr;
+        m_block_count = 0;
+        m_entry_count = 0;
+
+        if (!data || size < indexTrailerSize)
+            return false;
+
+        const unsigned char* trailer = data + size - indexTrailerSize;
+        if (std::memcmp(trailer + 24, indexMagic, sizeof(indexMagic)) != 0 || getU32(trailer + 28) != indexVersion)
+            return false;
+
+        const unsigned long long directory_offset = getU64(trailer);
+        const unsigned long long block_count = getU64(trailer + 8);
+        const unsigned long long entry_count = getU64(trailer + 16);
+        const unsigned long long blocks_needed = (entry_count + PositionIndexBuilder::blockEntries - 1) / PositionIndexBuilder::blockEntries;
+        if (directory_offset > size - indexTrailerSize || block_count != blocks_needed ||
+            block_count > (size - indexTrailerSize - directory_offset) / 16)
+        {
+            return false;
+        }
+
+        m_data = data;
+        m_size = size;
+        m_directory = data + directory_offset;
+        m_block_count = (size_t)block_count;
+        m_entry_count = (size_t)entry_count;
+        return true;
+    }
+
+    unsigned long long PositionIndexReader::blockKey(size_t block_idx) const
+    {
+        return getU64(m_directory + block_idx * 16);
+    }
+
+    std::vector<PositionIndexEntry> PositionIndexReader::find(const Position& pos) const
+    {
+        return find(polyglotKey(pos));
+    }
+
+    std::vector<PositionIndexEntry> PositionIndexReader::find(unsigned long long key) const
+    {
+        std::vector<PositionIndexEntry> entries;
+
+        // first block starting with a key >= key, the previous one may end with it too
+        size_t first = 0;
+        size_t count = m_block_count;
+        while (count > 0)
+        {
+            const size_t step = count / 2;
+            if (blockKey(first + step) < key)
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+                count = step;
+        }
+
+        for (size_t block_idx = (first > 0 ? first - 1 : 0); block_idx < m_block_count; ++block_idx)
+        {
+            if (blockKey(block_idx) > key)
+                break;
+
+            const unsigned long long block_offset = getU64(m_directory + block_idx * 16 + 8);
+            const unsigned char* data = m_data + block_offset;
+            const unsigned char* end = (block_idx + 1 < m_block_count) ? m_data + getU64(m_directory + (block_idx + 1) * 16 + 8) : m_directory;
+            if (block_offset > (unsigned long long)(m_directory - m_data) || end < data || end > m_directory)
+                return std::vector<PositionIndexEntry>();
+
+            const size_t entry_count = std::min(PositionIndexBuilder::blockEntries, m_entry_count - block_idx * PositionIndexBuilder::blockEntries);
+
+            PositionIndexEntry entry{blockKey(block_idx), 0, 0};
+            for (size_t entry_idx = 0; entry_idx < entry_count; ++entry_idx)
+            {
+                unsigned long long key_delta = 0;
+                unsigned long long game_id = 0;
+                unsigned long long ply = 0;
+                if ((entry_idx > 0 && !getVarint(&data, end, &key_delta)) || !getVarint(&data, end, &game_id) || !getVarint(&data, end, &ply))
+                    return std::vector<PositionIndexEntry>();
+
+                if (entry_idx == 0 || key_delta != 0)
+                {
+                    entry.key += key_delta;
+                    entry.game_id = (unsigned int)game_id;
+                    entry.ply = (unsigned int)ply;
+                }
+                else if (game_id != 0)
+                {
+                    entry.game_id += (unsigned int)game_id;
+                    entry.ply = (unsigned int)ply;
+                }
+                else
+                    entry.ply += (unsigned int)ply;
+
+                if (entry.key > key)
+                    return entries;
+                if (entry.key == key)
+                    entries.push_back(entry);
+            }
+        }
+
+        return entries;
+    }
+}   // namespace fatpup
@@ -15,6 +15,13 @@ namespace fatpup
                                (moves_present ? Position::State::Normal : Position::State::Stalemate);
     }
 
+    bool Position::isCheck() const
+    {
+        Position new_pos = *this;
+        new_pos.toggleTurn();
+        return !new_pos.isKingSafe();
+    }
+
     bool Position::isKingSafe() const
     {
         const unsigned char white_turn = (m_board[A1].state() & WhiteTurn) ? White : 0;
@@ -980,4 +987,169 @@ namespace fatpup
 
         return true;
     }
+
+    std::vector<Move> Position::possibleCaptures() const
+    {
+        // the captures can be told by the destination square alone (an enemy piece or the en
+        // passant flag), so unlike possibleMoves() only those get the expensive legality check
+        static const int knight_deltas[8][2] = { { -2, -1 }, { -2, 1 }, { -1, -2 }, { -1, 2 }, { 1, -2 }, { 1, 2 }, { 2, -1 }, { 2, 1 } };
+        static const int king_deltas[8][2] = { { -1, -1 }, { -1, 0 }, { -1, 1 }, { 0, -1 }, { 0, 1 }, { 1, -1 }, { 1, 0 }, { 1, 1 } };
+        // the first four are diagonal
+        static const int ray_deltas[8][2] = { { -1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 }, { -1, 0 }, { 0, -1 }, { 0, 1 }, { 1, 0 } };
+
+        std::vector<Move> captures;
+        captures.reserve(16);
+        const unsigned char white_turn = (m_board[A1].state() & WhiteTurn) ? White : 0;
+
+        Move move;
+        auto append_capture = [&](int dst_row, int dst_col, bool promotion)
+        {
+            move.fields.dst_row = dst_row;
+            move.fields.dst_col = dst_col;
+            if (!isMoveLegal(move))
+                return;
+
+            captures.push_back(move);
+            if (promotion)
+            {
+                captures.back().fields.promoted_to = Queen;
+                static const unsigned char under_promotions[] = { Rook, Bishop, Knight };
+                for (const auto piece: under_promotions)
+                {
+                    captures.push_back(move);
+                    captures.back().fields.promoted_to = piece;
+                }
+            }
+        };
+        auto is_enemy = [&](int row, int col)
+        {
+            const Square target = m_board[row * BOARD_SIZE + col];
+            return target.piece() != Empty && target.isWhite() != white_turn;
+        };
+
+        for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+        {
+            const Square square = m_board[s_idx];
+            const unsigned char piece = square.piece();
+            if (piece == Empty || square.isWhite() != white_turn)
+                continue;
+
+            const int row_idx = s_idx / BOARD_SIZE;
+            const int col_idx = s_idx - row_idx * BOARD_SIZE;
+            move = Move();
+            move.fields.src_row = row_idx;
+            move.fields.src_col = col_idx;
+
+            if (piece == Pawn)
+            {
+                const int dst_row = white_turn ? row_idx + 1 : row_idx - 1;
+                const bool promotion = (dst_row == ROW1 || dst_row == ROW8);
+                const bool en_passant_row = (row_idx == (white_turn ? ROW5 : ROW4));
+                for (int dst_col = col_idx - 1; dst_col <= col_idx + 1; dst_col += 2)
+                {
+                    if (dst_col >= 0 && dst_col < BOARD_SIZE &&
+                        (is_enemy(dst_row, dst_col) || (en_passant_row && (m_board[dst_row * BOARD_SIZE + dst_col].state() & EnPassant))))
+                    {
+                        append_capture(dst_row, dst_col, promotion);
+                    }
+                }
+            }
+            else if (piece == Knight || piece == King)
+            {
+                const int (*deltas)[2] = (piece == Knight) ? knight_deltas : king_deltas;
+                for (int d = 0; d < 8; ++d)
+                {
+                    const int dst_row = row_idx + deltas[d][0];
+                    const int dst_col = col_idx + deltas[d][1];
+                    if (dst_row >= 0 && dst_row < BOARD_SIZE && dst_col >= 0 && dst_col < BOARD_SIZE && is_enemy(dst_row, dst_col))
+                        append_capture(dst_row, dst_col, false);
+                }
+            }
+            else
+            {
+                const int first_ray = (piece == Rook) ? 4 : 0;
+                const int last_ray = (piece == Bishop) ? 4 : 8;
+                for (int r = first_ray; r < last_ray; ++r)
+                {
+                    int dst_row = row_idx + ray_deltas[r][0];
+                    int dst_col = col_idx + ray_deltas[r][1];
+                    while (dst_row >= 0 && dst_row < BOARD_SIZE && dst_col >= 0 && dst_col < BOARD_SIZE)
+                    {
+                        if (m_board[dst_row * BOARD_SIZE + dst_col].piece() != Empty)
+                        {
+                            if (is_enemy(dst_row, dst_col))
+                                append_capture(dst_row, dst_col, false);
+                            break;
+                        }
+                        dst_row += ray_deltas[r][0];
+                        dst_col += ray_deltas[r][1];
+                    }
+                }
+            }
+        }
+
+        return captures;
+    }
+
+    std::vector<Move> Position::possibleChecks() const
+    {
+        std::vector<Move> checks;
+        const unsigned char white_turn = (m_board[A1].state() & WhiteTurn) ? White : 0;
+
+        int king_square_idx = -1;
+        for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+        {
+            if (m_board[s_idx].piece() == King && m_board[s_idx].isWhite() != white_turn)
+            {
+                king_square_idx = s_idx;
+                break;
+            }
+        }
+        if (king_square_idx == -1)
+            return checks;
+
+        // only the moves that put the piece where it would attack the king if nothing was in
+        // the way, or that leave a line to the king open (discovered checks), can check. Those
+        // get made to see if they do. Castlings and en passant captures move more than one
+        // piece, they're always tried
+        const RowCol king = idxToRowCol(king_square_idx);
+        auto on_line = [&king](int row, int col) { return row == king.row || col == king.col || row - king.row == col - king.col || row - king.row == king.col - col; };
+        for (const auto move: possibleMoves())
+        {
+            const int src_row = move.fields.src_row;
+            const int src_col = move.fields.src_col;
+            const int dst_row = move.fields.dst_row;
+            const int dst_col = move.fields.dst_col;
+            const unsigned char moved_piece = m_board[src_row * BOARD_SIZE + src_col].piece();
+            const unsigned char piece = (move.fields.promoted_to > Pawn) ? (unsigned char)move.fields.promoted_to : moved_piece;
+            const int row_delta = king.row - dst_row;
+            const int col_delta = king.col - dst_col;
+
+            bool can_check = on_line(src_row, src_col) || (moved_piece == King && (src_col - dst_col > 1 || dst_col - src_col > 1)) ||
+                (moved_piece == Pawn && src_col != dst_col && m_board[dst_row * BOARD_SIZE + dst_col].piece() == Empty);
+            switch (piece)
+            {
+            case Pawn:
+                can_check = can_check || (row_delta == (white_turn ? 1 : -1) && (col_delta == 1 || col_delta == -1));
+                break;
+            case Knight:
+                can_check = can_check || (row_delta * row_delta + col_delta * col_delta == 5);
+                break;
+            case Bishop:
+                can_check = can_check || row_delta == col_delta || row_delta == -col_delta;
+                break;
+            case Rook:
+                can_check = can_check || row_delta == 0 || col_delta == 0;
+                break;
+            case Queen:
+                can_check = can_check || on_line(dst_row, dst_col);
+                break;
+            }
+
+            if (can_check && Position(*this, move).isCheck())
+                checks.push_back(move);
+        }
+
+        return checks;
+    }
 }   // namespace fatpup
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 
 #include "fatpup/position.h"
@@ -67,6 +68,131 @@ namespace fatpup
     }
 
 
+    // square of the least valuable piece of the given color attacking s_idx on the board,
+    // -1 if there's none. Sliders see through the pieces already removed from the board
+    static int leastValuableAttacker(const unsigned char* board, int s_idx, unsigned char color)
+    {
+        static const int knight_deltas[8][2] = { { -2, -1 }, { -2, 1 }, { -1, -2 }, { -1, 2 }, { 1, -2 }, { 1, 2 }, { 2, -1 }, { 2, 1 } };
+        static const int ray_deltas[8][2] = { { -1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 }, { -1, 0 }, { 0, -1 }, { 0, 1 }, { 1, 0 } };
+
+        const int row = s_idx / BOARD_SIZE;
+        const int col = s_idx % BOARD_SIZE;
+        int attacker = -1;
+        int attacker_piece = King + 1;
+        auto consider = [&](int r, int c, int piece)
+        {
+            const int a_idx = r * BOARD_SIZE + c;
+            if (board[a_idx] == (piece | color) && piece < attacker_piece)
+            {
+                attacker = a_idx;
+                attacker_piece = piece;
+            }
+        };
+
+        // pawns capture towards the opponent, so they attack from the opposite side
+        const int pawn_row = (color == White) ? row - 1 : row + 1;
+        if (pawn_row >= ROW1 && pawn_row <= ROW8)
+        {
+            if (col > COLA)
+                consider(pawn_row, col - 1, Pawn);
+            if (col < COLH)
+                consider(pawn_row, col + 1, Pawn);
+        }
+        if (attacker_piece == Pawn)
+            return attacker;
+
+        for (const auto& delta: knight_deltas)
+        {
+            const int r = row + delta[0];
+            const int c = col + delta[1];
+            if (r >= ROW1 && r <= ROW8 && c >= COLA && c <= COLH)
+                consider(r, c, Knight);
+        }
+        if (attacker_piece == Knight)
+            return attacker;
+
+        for (int d = 0; d < 8; ++d)
+        {
+            const bool diagonal = (d < 4);
+            int r = row + ray_deltas[d][0];
+            int c = col + ray_deltas[d][1];
+            for (int distance = 1; r >= ROW1 && r <= ROW8 && c >= COLA && c <= COLH; ++distance)
+            {
+                const unsigned char square = board[r * BOARD_SIZE + c];
+                if (square != Empty)
+                {
+                    if ((square & ColorMask) == color)
+                    {
+                        const int piece = square & PieceMask;
+                        if (piece == Queen || piece == (diagonal ? Bishop : Rook) || (piece == King && distance == 1))
+                            consider(r, c, piece);
+                    }
+                    break;
+                }
+                r += ray_deltas[d][0];
+                c += ray_deltas[d][1];
+            }
+        }
+
+        return attacker;
+    }
+
+    int Position::see(Move move) const
+    {
+        // the pieces only, the flags would get in the way of the comparisons
+        unsigned char board[BOARD_SIZE * BOARD_SIZE];
+        for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+            board[s_idx] = m_board[s_idx].pieceWithColor();
+
+        const int src_idx = rowColToIdx(move.fields.src_row, move.fields.src_col);
+        const int dst_idx = rowColToIdx(move.fields.dst_row, move.fields.dst_col);
+
+        // swap list: gain[n] is what the n-th capture wins, assuming the exchange stops right after it
+        int gain[32];
+        int depth = 0;
+        gain[0] = exchangeValue(board[dst_idx] & PieceMask);
+        if ((board[src_idx] & PieceMask) == Pawn && move.fields.src_col != move.fields.dst_col && board[dst_idx] == Empty)
+        {
+            // en passant
+            gain[0] = PawnValue;
+            board[rowColToIdx(move.fields.src_row, move.fields.dst_col)] = Empty;
+        }
+
+        int piece_on_square = board[src_idx] & PieceMask;
+        if (move.fields.promoted_to > Pawn)
+        {
+            gain[0] += exchangeValue(move.fields.promoted_to) - PawnValue;
+            piece_on_square = move.fields.promoted_to;
+        }
+
+        unsigned char color = (board[src_idx] & ColorMask) ^ ColorMask;
+        board[dst_idx] = (unsigned char)(piece_on_square | (color ^ ColorMask));
+        board[src_idx] = Empty;
+
+        for (;;)
+        {
+            const int attacker = leastValuableAttacker(board, dst_idx, color);
+            if (attacker < 0 || depth + 1 >= (int)(sizeof(gain) / sizeof(gain[0])))
+                break;
+
+            ++depth;
+            gain[depth] = exchangeValue(piece_on_square) - gain[depth - 1];
+            piece_on_square = board[attacker] & PieceMask;
+            board[dst_idx] = board[attacker];
+            board[attacker] = Empty;
+            color ^= ColorMask;
+        }
+
+        // either side can stop capturing when it doesn't pay off
+        while (depth > 0)
+        {
+            gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+            --depth;
+        }
+
+        return gain[0];
+    }
+
     std::string Position::moveToStringPGN(Move move) const
     {
         std::string result;
@@ -150,4 +276,109 @@ namespace fatpup
 
         return result;
     }
+
+    Move Position::moveFromStringPGN(const std::string& san) const
+    {
+        // strip check/mate marks and annotations
+        size_t length = san.length();
+        while (length > 0 && (san[length - 1] == '+' || san[length - 1] == '#' || san[length - 1] == '!' || san[length - 1] == '?'))
+            --length;
+
+        const std::string move_str = san.substr(0, length);
+        if (move_str.length() < 2)
+            return Move();
+
+        // only the pieces that may make the move are asked for their legal moves
+        // (same as in PgnWriter), there's no full legal move generation
+        const unsigned char color = isWhiteTurn() ? White : Black;
+
+        if (move_str == "O-O" || move_str == "0-0" || move_str == "O-O-O" || move_str == "0-0-0")
+        {
+            const int row = isWhiteTurn() ? ROW1 : ROW8;
+            const unsigned int rook_src_col = (move_str.length() == 3) ? COLH : COLA;
+            for (int col = COLA; col <= COLH; ++col)
+            {
+                if (square(row, col).pieceWithColor() != (King | color))
+                    continue;
+
+                for (const auto& move : possibleMoves(row, col, row, rook_src_col == COLH ? COLG : COLC))
+                {
+                    if (move.fields.rook_src_col != move.fields.rook_dst_col && move.fields.rook_src_col == rook_src_col)
+                        return move;
+                }
+            }
+            return Move();
+        }
+
+        size_t pos = 0;
+        unsigned char piece = Pawn;
+        const size_t symbol_idx = std::string("  NBRQK").find(move_str[0]);
+        if (symbol_idx != std::string::npos && symbol_idx >= Knight)
+        {
+            piece = (unsigned char)symbol_idx;
+            ++pos;
+        }
+
+        // promotion at the end: "e8=Q" or "e8Q"
+        unsigned int promoted_to = 0;
+        size_t end = move_str.length();
+        if (piece == Pawn && end >= 3)
+        {
+            const size_t promotion_idx = std::string("  NBRQ").find(move_str[end - 1]);
+            if (promotion_idx != std::string::npos && promotion_idx >= Knight)
+            {
+                promoted_to = (unsigned int)promotion_idx;
+                --end;
+                if (move_str[end - 1] == '=')
+                    --end;
+            }
+        }
+
+        if (end < pos + 2)
+            return Move();
+
+        const char dst_col_sym = move_str[end - 2];
+        const char dst_row_sym = move_str[end - 1];
+        if (dst_col_sym < 'a' || dst_col_sym > 'h' || dst_row_sym < '1' || dst_row_sym > '8')
+            return Move();
+        const unsigned int dst_col = dst_col_sym - 'a';
+        const unsigned int dst_row = dst_row_sym - '1';
+
+        // what's left in between is disambiguation and/or capture mark
+        int src_col = -1;
+        int src_row = -1;
+        for (size_t i = pos; i < end - 2; ++i)
+        {
+            const char sym = move_str[i];
+            if (sym >= 'a' && sym <= 'h')
+                src_col = sym - 'a';
+            else if (sym >= '1' && sym <= '8')
+                src_row = sym - '1';
+            else if (sym != 'x' && sym != ':' && sym != '-')
+                return Move();
+        }
+
+        Move result;
+        for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+        {
+            const RowCol rc = idxToRowCol(s_idx);
+            if (m_board[s_idx].pieceWithColor() != (piece | color))
+                continue;
+            if ((src_col >= 0 && rc.col != src_col) || (src_row >= 0 && rc.row != src_row))
+                continue;
+
+            for (const auto& move : possibleMoves(rc.row, rc.col, dst_row, dst_col))
+            {
+                if (move.fields.promoted_to != promoted_to || move.fields.rook_src_col != move.fields.rook_dst_col)
+                    continue;
+
+                if (!result.isEmpty())
+                    return Move();  // ambiguous
+
+                result = move;
+            }
+        }
+
+        return result;
+    }
 }   // namespace fatpup
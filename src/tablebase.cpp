@@ -0,0 +1,962 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "fatpup/tablebase.h"
+#include "byte_io.h"
+
+namespace fatpup
+{
+    static constexpr char tableMagic[4] = { 'F', 'P', 'T', 'B' };
+    static constexpr unsigned int tableVersion = 1;
+    static constexpr size_t materialNameSize = 8;
+    static constexpr size_t tableHeaderSize = sizeof(tableMagic) + 4 + 4 + materialNameSize + 8;
+
+    constexpr int Tablebases::maxPieces;
+    constexpr int Tablebases::maxDistance;
+    const char* const Tablebases::fileExtension = ".fptb";
+
+    static constexpr char pieceLetters[] = " PNBRQK";
+
+    // the squares of the white king in the index of a table with no pawns
+    static constexpr int triangleSquares[] = { A1, B1, C1, D1, B2, C2, D2, C3, D3, D4 };
+    static constexpr int triangleRowOffsets[] = { 0, 4, 7, 9 };
+    static constexpr int pawnSquares = 6 * BOARD_SIZE;
+
+    // the generator's codes of the moves leaving the table (exits): the best result of those
+    // in the values' code, or one of these
+    static constexpr unsigned char exitNone = 0;
+    static constexpr unsigned char exitDraw = 254;
+    static constexpr unsigned char exitInvalid = 255;
+
+    // more pieces, or stronger ones of as many. The pieces are sorted strongest first
+    static bool isStronger(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+    {
+        if (a.size() != b.size())
+            return a.size() > b.size();
+        return std::lexicographical_compare(b.begin(), b.end(), a.begin(), a.end());
+    }
+
+    static std::string sideName(const std::vector<unsigned char>& pieces)
+    {
+        std::string name(1, pieceLetters[King]);
+        for (const auto piece: pieces)
+            name += pieceLetters[piece];
+        return name;
+    }
+
+    // the pieces of either side but the kings
+    static std::string materialName(std::vector<unsigned char> white, std::vector<unsigned char> black, bool* flipped)
+    {
+        std::sort(white.begin(), white.end(), std::greater<unsigned char>());
+        std::sort(black.begin(), black.end(), std::greater<unsigned char>());
+        const bool flip = isStronger(black, white);
+        if (flipped)
+            *flipped = flip;
+        return flip ? sideName(black) + "v" + sideName(white) : sideName(white) + "v" + sideName(black);
+    }
+
+    // all the sets of count pieces (kings aside) with no piece stronger than max_piece
+    static void pieceSets(int count, unsigned char max_piece, std::vector<unsigned char>* set, std::vector<std::vector<unsigned char>>* sets)
+    {
+        if (!count)
+        {
+            sets->push_back(*set);
+            return;
+        }
+
+        for (unsigned char piece = max_piece; piece >= Pawn; --piece)
+        {
+            set->push_back(piece);
+            pieceSets(count - 1, piece, set, sets);
+            set->pop_back();
+        }
+    }
+
+    // the pieces in the index order, returns false if the name is not the one of a table
+    static bool parseMaterial(const std::string& material, unsigned char* pieces, int* piece_count)
+    {
+        std::vector<unsigned char> sides[2];
+        size_t side = 0;
+        for (size_t c = 0; c < material.size(); ++c)
+        {
+            const char* letter = std::strchr(pieceLetters, material[c]);
+            if (material[c] == 'v' && side == 0 && c > 0)
+                ++side;
+            else if (letter && *letter != ' ' && (material[c] == pieceLetters[King]) == (c == 0 || material[c - 1] == 'v'))
+                sides[side].push_back((unsigned char)(letter - pieceLetters));
+            else
+                return false;
+        }
+        if (side != 1 || sides[1].empty())
+            return false;
+
+        sides[0].erase(sides[0].begin());
+        sides[1].erase(sides[1].begin());
+        if ((int)(sides[0].size() + sides[1].size()) + 2 > Tablebases::maxPieces || materialName(sides[0], sides[1], nullptr) != material ||
+            (sides[0].empty() && sides[1].empty()))
+        {
+            return false;
+        }
+
+        *piece_count = 0;
+        pieces[(*piece_count)++] = King | White;
+        pieces[(*piece_count)++] = King | Black;
+        for (const auto piece: sides[0])
+            pieces[(*piece_count)++] = piece | White;
+        for (const auto piece: sides[1])
+            pieces[(*piece_count)++] = piece | Black;
+        return true;
+    }
+
+    static bool hasPawns(const unsigned char* pieces, int piece_count)
+    {
+        for (int p = 0; p < piece_count; ++p)
+        {
+            if ((pieces[p] & PieceMask) == Pawn)
+                return true;
+        }
+        return false;
+    }
+
+    static unsigned long long tablePositionCount(const unsigned char* pieces, int piece_count)
+    {
+        unsigned long long count = hasPawns(pieces, piece_count) ? BOARD_SIZE * BOARD_SIZE / 2 : sizeof(triangleSquares) / sizeof(triangleSquares[0]);
+        for (int p = 1; p < piece_count; ++p)
+            count *= ((pieces[p] & PieceMask) == Pawn) ? pawnSquares : BOARD_SIZE * BOARD_SIZE;
+        return count;
+    }
+
+    // turns the board so that the white king (squares[0]) gets where the index wants it
+    static void normalizeSquares(bool pawns, int piece_count, int* squares)
+    {
+        const RowCol king = idxToRowCol(squares[0]);
+        const bool mirror_cols = king.col > COLD;
+        const bool mirror_rows = !pawns && king.row > ROW4;
+        const bool transpose = !pawns && (mirror_rows ? ROW8 - king.row : king.row) > (mirror_cols ? COLH - king.col : king.col);
+        if (!mirror_cols && !mirror_rows && !transpose)
+            return;
+
+        for (int p = 0; p < piece_count; ++p)
+        {
+            RowCol square = idxToRowCol(squares[p]);
+            if (mirror_cols)
+                square.col = COLH - square.col;
+            if (mirror_rows)
+                square.row = ROW8 - square.row;
+            if (transpose)
+                std::swap(square.row, square.col);
+            squares[p] = rowColToIdx(square.row, square.col);
+        }
+    }
+
+    // the squares must be normalized
+    static unsigned long long squaresToIndex(const unsigned char* pieces, int piece_count, const int* squares)
+    {
+        const RowCol king = idxToRowCol(squares[0]);
+        const bool pawns = hasPawns(pieces, piece_count);
+        unsigned long long index = pawns ? king.row * BOARD_SIZE / 2 + king.col : triangleRowOffsets[king.row] + king.col - king.row;
+        for (int p = 1; p < piece_count; ++p)
+        {
+            if ((pieces[p] & PieceMask) == Pawn)
+                index = index * pawnSquares + squares[p] - BOARD_SIZE;
+            else
+                index = index * BOARD_SIZE * BOARD_SIZE + squares[p];
+        }
+        return index;
+    }
+
+    static void indexToSquares(const unsigned char* pieces, int piece_count, unsigned long long index, int* squares)
+    {
+        for (int p = piece_count - 1; p > 0; --p)
+        {
+            if ((pieces[p] & PieceMask) == Pawn)
+            {
+                squares[p] = (int)(index % pawnSquares) + BOARD_SIZE;
+                index /= pawnSquares;
+            }
+            else
+            {
+                squares[p] = (int)(index % (BOARD_SIZE * BOARD_SIZE));
+                index /= BOARD_SIZE * BOARD_SIZE;
+            }
+        }
+
+        if (hasPawns(pieces, piece_count))
+            squares[0] = rowColToIdx((int)index / (BOARD_SIZE / 2), (int)index % (BOARD_SIZE / 2));
+        else
+            squares[0] = triangleSquares[index];
+    }
+
+    // the squares of the position's pieces in the index order, the colors flipped (and the
+    // board upside down) if flip is set. Returns false if the material is not the table's one
+    static bool positionSquares(const Position& pos, bool flip, const unsigned char* pieces, int piece_count, int* squares)
+    {
+        bool assigned[Tablebases::maxPieces] = {};
+        for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+        {
+            const int pos_s_idx = flip ? (s_idx ^ ((BOARD_SIZE - 1) * BOARD_SIZE)) : s_idx;
+            const Square& square = pos.square(pos_s_idx / BOARD_SIZE, pos_s_idx % BOARD_SIZE);
+            if (square.piece() == Empty)
+                continue;
+
+            const unsigned char piece = flip ? (square.pieceWithColor() ^ ColorMask) : square.pieceWithColor();
+            int p = 0;
+            while (p < piece_count && (assigned[p] || pieces[p] != piece))
+                ++p;
+            if (p == piece_count)
+                return false;
+            assigned[p] = true;
+            squares[p] = s_idx;
+        }
+
+        return std::find(assigned, assigned + piece_count, false) == assigned + piece_count;
+    }
+
+    static void setupPosition(const unsigned char* pieces, int piece_count, const int* squares, bool white_turn, Position* pos)
+    {
+        pos->setEmpty();
+        for (int p = 0; p < piece_count; ++p)
+            pos->square(squares[p] / BOARD_SIZE, squares[p] % BOARD_SIZE) = pieces[p];
+        pos->setWhiteTurn(white_turn);
+    }
+
+    // the side to move has a pawn that can take the one that has just made a double move
+    static bool enPassantCapturePossible(const Position& pos)
+    {
+        const bool white_turn = pos.isWhiteTurn();
+        const int en_passant_row = white_turn ? ROW6 : ROW3;
+        const int capture_row = white_turn ? ROW5 : ROW4;
+        const unsigned char capturer = Pawn | (white_turn ? White : Black);
+        for (int col = COLA; col <= COLH; ++col)
+        {
+            if (!pos.square(en_passant_row, col).isFlagSet(EnPassant))
+                continue;
+            if ((col > COLA && pos.square(capture_row, col - 1).pieceWithColor() == capturer) ||
+                (col < COLH && pos.square(capture_row, col + 1).pieceWithColor() == capturer))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // the legal en passant captures of the side to move
+    static std::vector<Move> enPassantCaptures(const Position& pos)
+    {
+        std::vector<Move> captures;
+        if (!enPassantCapturePossible(pos))
+            return captures;
+        for (const auto move: pos.possibleMoves())
+        {
+            if (pos.square(move.fields.src_row, move.fields.src_col).piece() == Pawn && move.fields.src_col != move.fields.dst_col &&
+                pos.square(move.fields.dst_row, move.fields.dst_col).piece() == Empty)
+            {
+                captures.push_back(move);
+            }
+        }
+        return captures;
+    }
+
+    // a double pawn move, the only kind an en passant capture can answer
+    static bool isDoubleStep(const Position& pos, Move move)
+    {
+        return pos.square(move.fields.src_row, move.fields.src_col).piece() == Pawn &&
+               std::abs((int)move.fields.dst_row - (int)move.fields.src_row) == 2;
+    }
+
+    // the results of two moves for the side making them: whether a is the better one, the
+    // fastest win, a draw or the longest loss
+    static bool isBetterResult(int wdl_a, int distance_a, int wdl_b, int distance_b)
+    {
+        if (wdl_a != wdl_b)
+            return wdl_a > wdl_b;
+        return (wdl_a > 0) ? distance_a < distance_b : distance_a > distance_b;
+    }
+
+    // a value of a table: wdl and the distance to mate from the code
+    static void decodeValue(unsigned char value, int* wdl, int* distance)
+    {
+        *distance = value ? value - 1 : 0;
+        *wdl = value ? ((*distance & 1) ? 1 : -1) : 0;
+    }
+
+    std::vector<std::string> Tablebases::materials(int piece_count)
+    {
+        struct Material
+        {
+            int pieces;
+            int pawns;
+            std::string name;
+        };
+        std::vector<Material> materials;
+
+        piece_count = std::min(piece_count, maxPieces);
+        for (int pieces = 3; pieces <= piece_count; ++pieces)
+        {
+            for (int white_count = 0; white_count <= pieces - 2; ++white_count)
+            {
+                std::vector<unsigned char> set;
+                std::vector<std::vector<unsigned char>> white_sets;
+                std::vector<std::vector<unsigned char>> black_sets;
+                pieceSets(white_count, Queen, &set, &white_sets);
+                pieceSets(pieces - 2 - white_count, Queen, &set, &black_sets);
+                for (const auto& white: white_sets)
+                {
+                    for (const auto& black: black_sets)
+                    {
+                        if (isStronger(black, white))
+                            continue;
+                        const int pawns = (int)(std::count(white.begin(), white.end(), Pawn) + std::count(black.begin(), black.end(), Pawn));
+                        materials.push_back(Material{pieces, pawns, materialName(white, black, nullptr)});
+                    }
+                }
+            }
+        }
+
+        // a promotion leads to a table with as many pieces and a pawn less
+        std::stable_sort(materials.begin(), materials.end(), [](const Material& a, const Material& b) {
+            return (a.pieces != b.pieces) ? a.pieces < b.pieces : a.pawns < b.pawns;
+        });
+        std::vector<std::string> names;
+        for (const auto& material: materials)
+            names.push_back(material.name);
+        return names;
+    }
+
+    std::string Tablebases::material(const Position& pos, bool* flipped)
+    {
+        std::vector<unsigned char> sides[2];
+        for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+        {
+            const Square& square = pos.square(s_idx / BOARD_SIZE, s_idx % BOARD_SIZE);
+            if (square.piece() != Empty && square.piece() != King)
+                sides[square.isWhite() ? 0 : 1].push_back(square.piece());
+        }
+        return materialName(sides[0], sides[1], flipped);
+    }
+
+    size_t Tablebases::open(const std::string& directory)
+    {
+        for (const auto& material: materials())
+            add(directory + "/" + material + fileExtension);
+        return m_tables.size();
+    }
+
+    bool Tablebases::add(const std::string& path)
+    {
+        Table table;
+        table.file.reset(new MappedFile());
+        if (!table.file->open(path) || table.file->size() < tableHeaderSize ||
+            std::memcmp(table.file->data(), tableMagic, sizeof(tableMagic)) != 0)
+        {
+            return false;
+        }
+
+        const unsigned char* header = table.file->data() + sizeof(tableMagic);
+        const unsigned char* name = header + 8;
+        table.material.assign((const char*)name, (const char*)std::find(name, name + materialNameSize, 0));
+        if (getU32(header) != tableVersion || !parseMaterial(table.material, table.pieces, &table.piece_count) ||
+            (int)getU32(header + 4) != table.piece_count)
+        {
+            return false;
+        }
+
+        table.position_count = getU64(name + materialNameSize);
+        if (table.position_count != tablePositionCount(table.pieces, table.piece_count) ||
+            table.file->size() != tableHeaderSize + 2 * table.position_count)
+        {
+            return false;
+        }
+        table.values = table.file->data() + tableHeaderSize;
+
+        // a newer file of the same table takes the place of the old one
+        auto existing = std::find_if(m_tables.begin(), m_tables.end(), [&table](const Table& t) { return t.material == table.material; });
+        if (existing != m_tables.end())
+            *existing = std::move(table);
+        else
+            m_tables.push_back(std::move(table));
+        return true;
+    }
+
+    const Tablebases::Table* Tablebases::findTable(const std::string& material) const
+    {
+        for (const auto& table: m_tables)
+        {
+            if (table.material == material)
+                return &table;
+        }
+        return nullptr;
+    }
+
+    bool Tablebases::probe(const Position& pos, int* wdl, int* distance) const
+    {
+        int piece_count = 0;
+        for (int s_idx = 0; s_idx < BOARD_SIZE * BOARD_SIZE; ++s_idx)
+        {
+            const Square& square = pos.square(s_idx / BOARD_SIZE, s_idx % BOARD_SIZE);
+            if (square.isFlagSet(CanCastle) || (square.piece() != Empty && ++piece_count > maxPieces))
+                return false;
+        }
+
+        if (piece_count == 2)
+        {
+            *wdl = 0;
+            *distance = 0;
+            return true;
+        }
+
+        // the tables know nothing of en passant, a ply is searched then. The capture leaves the
+        // table, the positions after the other moves have no en passant squares
+        if (enPassantCapturePossible(pos))
+            return !bestMove(pos, wdl, distance).isEmpty();
+
+        bool flipped = false;
+        const Table* table = findTable(material(pos, &flipped));
+        int squares[maxPieces];
+        if (!table || !positionSquares(pos, flipped, table->pieces, table->piece_count, squares))
+            return false;
+
+        normalizeSquares(hasPawns(table->pieces, table->piece_count), table->piece_count, squares);
+        const bool white_turn = (pos.isWhiteTurn() != flipped);
+        const unsigned long long index = squaresToIndex(table->pieces, table->piece_count, squares);
+        decodeValue(table->values[(white_turn ? 0 : table->position_count) + index], wdl, distance);
+        return true;
+    }
+
+    Move Tablebases::bestMove(const Position& pos, int* wdl, int* distance) const
+    {
+        Move best_move;
+        int best_wdl = -1;
+        int best_distance = -1;
+        for (const auto move: pos.possibleMoves())
+        {
+            int move_wdl = 0;
+            int move_distance = 0;
+            if (!probe(Position(pos, move), &move_wdl, &move_distance))
+                return Move();
+
+            // from the point of view of the side to move here
+            move_wdl = -move_wdl;
+            move_distance = move_wdl ? move_distance + 1 : 0;
+            if (best_move.isEmpty() || isBetterResult(move_wdl, move_distance, best_wdl, best_distance))
+            {
+                best_move = move;
+                best_wdl = move_wdl;
+                best_distance = move_distance;
+            }
+        }
+
+        if (!best_move.isEmpty())
+        {
+            *wdl = best_wdl;
+            *distance = best_distance;
+        }
+        return best_move;
+    }
+
+    // fn(begin, end) on thread_count threads for all of [0, count), a few thousand positions at a time
+    template <class Fn>
+    static void parallelRanges(unsigned long long count, unsigned int thread_count, Fn fn)
+    {
+        static constexpr unsigned long long rangeSize = 1 << 12;
+        std::atomic<unsigned long long> next_range(0);
+        auto worker = [&]()
+        {
+            for (unsigned long long begin = next_range++ * rangeSize; begin < count; begin = next_range++ * rangeSize)
+                fn(begin, std::min(begin + rangeSize, count));
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned int t = 1; t < thread_count; ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& thread: threads)
+            thread.join();
+    }
+
+    TablebaseGenerator::TablebaseGenerator(const Tablebases& subtables):
+        m_subtables(subtables),
+        m_win_count(0),
+        m_loss_count(0),
+        m_longest_mate(0)
+    {
+    }
+
+    bool TablebaseGenerator::generate(const std::string& material, unsigned int thread_count)
+    {
+        m_material.clear();
+        m_values.clear();
+        m_win_count = m_loss_count = 0;
+        m_longest_mate = 0;
+
+        unsigned char pieces[Tablebases::maxPieces];
+        int piece_count = 0;
+        if (!parseMaterial(material, pieces, &piece_count))
+            return false;
+
+        // the tables the captures and the promotions lead to, the kings alone need none
+        for (int p = 2; p < piece_count; ++p)
+        {
+            std::vector<unsigned char> sides[2];
+            for (int other = 2; other < piece_count; ++other)
+            {
+                if (other != p)
+                    sides[(pieces[other] & ColorMask) ? 0 : 1].push_back(pieces[other] & PieceMask);
+            }
+            if ((!sides[0].empty() || !sides[1].empty()) && !m_subtables.hasTable(materialName(sides[0], sides[1], nullptr)))
+                return false;
+
+            if ((pieces[p] & PieceMask) != Pawn)
+                continue;
+            for (unsigned char promoted_to = Knight; promoted_to <= Queen; ++promoted_to)
+            {
+                std::vector<unsigned char> promoted_sides[2] = { sides[0], sides[1] };
+                promoted_sides[(pieces[p] & ColorMask) ? 0 : 1].push_back(promoted_to);
+                if (!m_subtables.hasTable(materialName(promoted_sides[0], promoted_sides[1], nullptr)))
+                    return false;
+            }
+        }
+
+        const bool pawns = hasPawns(pieces, piece_count);
+        const unsigned long long count = tablePositionCount(pieces, piece_count);
+        thread_count = std::max(1u, thread_count);
+
+        // only a pawn of each side makes an en passant capture possible
+        bool en_passant = false;
+        for (int p = 2; p < piece_count; ++p)
+        {
+            for (int other = 2; other < piece_count; ++other)
+                en_passant = en_passant || (pieces[p] == (Pawn | White) && pieces[other] == (Pawn | Black));
+        }
+
+        // white to move first, then black to move. The values are 0 until they're known,
+        // which is left for the draws at the end. exits have the best result of the moves
+        // that leave the table, exitInvalid for the positions that can't happen
+        std::unique_ptr<std::atomic<unsigned char>[]> values(new std::atomic<unsigned char>[2 * count]);
+        std::vector<unsigned char> exits(2 * count);
+        std::atomic<bool> failed(false);
+
+        // the double pawn moves an en passant capture can answer don't lead to the table's
+        // position without the en passant square: the side to move there has the captures too.
+        // They're scored like the moves leaving the table, from that position's value and the
+        // best capture's result
+        struct EnPassantMove
+        {
+            unsigned long long  entry;
+            unsigned long long  next_entry;
+            // the best capture, for the side to move after the double move
+            int                 capture_wdl;
+            int                 capture_distance;
+            // the captures are all the moves there
+            bool                captures_only;
+        };
+        std::vector<EnPassantMove> en_passant_moves;
+        std::mutex en_passant_mutex;
+
+        // the entry of the position a move leads to in the table
+        auto entryOf = [&](const Position& pos) -> unsigned long long
+        {
+            int squares[Tablebases::maxPieces];
+            positionSquares(pos, false, pieces, piece_count, squares);
+            normalizeSquares(pawns, piece_count, squares);
+            return (pos.isWhiteTurn() ? 0 : count) + squaresToIndex(pieces, piece_count, squares);
+        };
+
+        // the best result of the moves to the subtables, for the side to move after the move
+        auto probeMoves = [&](const Position& pos, const std::vector<Move>& moves, int* best_wdl, int* best_distance) -> bool
+        {
+            for (const auto move: moves)
+            {
+                int wdl = 0;
+                int distance = 0;
+                if (!m_subtables.probe(Position(pos, move), &wdl, &distance) || distance >= Tablebases::maxDistance)
+                    return false;
+                wdl = -wdl;
+                distance = wdl ? distance + 1 : 0;
+                if (*best_wdl == -2 || isBetterResult(wdl, distance, *best_wdl, *best_distance))
+                {
+                    *best_wdl = wdl;
+                    *best_distance = distance;
+                }
+            }
+            return true;
+        };
+
+        // checkmates, stalemates, the positions that can't happen, and the moves leaving the table
+        parallelRanges(2 * count, thread_count, [&](unsigned long long begin, unsigned long long end)
+        {
+            Position pos;
+            int squares[Tablebases::maxPieces];
+            std::vector<EnPassantMove> local_en_passant_moves;
+            for (unsigned long long entry = begin; entry < end && !failed; ++entry)
+            {
+                values[entry].store(0, std::memory_order_relaxed);
+                exits[entry] = exitInvalid;
+
+                const bool white_turn = (entry < count);
+                indexToSquares(pieces, piece_count, entry % count, squares);
+                bool overlap = false;
+                for (int p = 1; p < piece_count; ++p)
+                    overlap = overlap || (std::find(squares, squares + p, squares[p]) != squares + p);
+                if (overlap)
+                    continue;
+
+                // the side that has just moved can't be in check
+                setupPosition(pieces, piece_count, squares, !white_turn, &pos);
+                if (pos.isCheck())
+                    continue;
+                pos.setWhiteTurn(white_turn);
+
+                exits[entry] = exitNone;
+                const auto moves = pos.possibleMoves();
+                if (moves.empty())
+                {
+                    values[entry].store(pos.isCheck() ? 1 : 0, std::memory_order_relaxed);
+                    continue;
+                }
+
+                std::vector<Move> exit_moves;
+                for (const auto move: moves)
+                {
+                    if (pos.isMoveCapture(move) || move.fields.promoted_to > Pawn)
+                    {
+                        exit_moves.push_back(move);
+                        continue;
+                    }
+                    if (!en_passant || !isDoubleStep(pos, move))
+                        continue;
+
+                    const Position next_pos(pos, move);
+                    const auto captures = enPassantCaptures(next_pos);
+                    if (captures.empty())
+                        continue;
+                    EnPassantMove en_passant_move{ entry, entryOf(next_pos), -2, 0, next_pos.possibleMoves().size() == captures.size() };
+                    if (!probeMoves(next_pos, captures, &en_passant_move.capture_wdl, &en_passant_move.capture_distance))
+                    {
+                        failed = true;
+                        return;
+                    }
+                    local_en_passant_moves.push_back(en_passant_move);
+                }
+
+                int best_wdl = -2;
+                int best_distance = 0;
+                if (!probeMoves(pos, exit_moves, &best_wdl, &best_distance))
+                {
+                    failed = true;
+                    return;
+                }
+                if (best_wdl == 0)
+                    exits[entry] = exitDraw;
+                else if (best_wdl != -2)
+                    exits[entry] = (unsigned char)(best_distance + 1);
+            }
+
+            std::lock_guard<std::mutex> lock(en_passant_mutex);
+            en_passant_moves.insert(en_passant_moves.end(), local_en_passant_moves.begin(), local_en_passant_moves.end());
+        });
+        if (failed)
+            return false;
+
+        // the double moves an en passant capture can answer are left out of the moves searched below
+        auto isEnPassantMove = [&](const Position& pos, Move move) -> bool
+        {
+            return en_passant && isDoubleStep(pos, move) && !enPassantCaptures(Position(pos, move)).empty();
+        };
+
+        // every move of a position to lose leads to a win of the other side no longer than distance
+        auto allMovesLose = [&](unsigned long long entry, int distance, Position* pos) -> bool
+        {
+            if (exits[entry] == exitDraw || (exits[entry] != exitNone && ((exits[entry] - 1) & 1)) ||
+                (exits[entry] != exitNone && exits[entry] - 1 > distance + 1))
+            {
+                return false;
+            }
+
+            int squares[Tablebases::maxPieces];
+            indexToSquares(pieces, piece_count, entry % count, squares);
+            setupPosition(pieces, piece_count, squares, entry < count, pos);
+            for (const auto move: pos->possibleMoves())
+            {
+                if (pos->isMoveCapture(move) || move.fields.promoted_to > Pawn || isEnPassantMove(*pos, move))
+                    continue;
+                const unsigned char value = values[entryOf(Position(*pos, move))].load(std::memory_order_relaxed);
+                if (!value || !((value - 1) & 1) || value - 1 > distance)
+                    return false;
+            }
+            return true;
+        };
+
+        // the values of a position and of its mirror image along the a1-h8 diagonal are the same.
+        // With the white king on the diagonal both are in the table, the mirror image is only
+        // reached from the positions its moves lead to if those are in the table as they are
+        auto setValue = [&](unsigned long long entry, int* squares, unsigned char value) -> bool
+        {
+            unsigned char unknown = 0;
+            if (!values[entry].compare_exchange_strong(unknown, value, std::memory_order_relaxed))
+                return false;
+
+            const RowCol king = idxToRowCol(squares[0]);
+            if (!pawns && king.row == king.col)
+            {
+                int mirrored[Tablebases::maxPieces];
+                for (int p = 0; p < piece_count; ++p)
+                {
+                    const RowCol square = idxToRowCol(squares[p]);
+                    mirrored[p] = rowColToIdx(square.col, square.row);
+                }
+                const unsigned long long mirrored_entry = (entry < count ? 0 : count) + squaresToIndex(pieces, piece_count, mirrored);
+                unknown = 0;
+                values[mirrored_entry].compare_exchange_strong(unknown, value, std::memory_order_relaxed);
+            }
+            return true;
+        };
+
+        // the result of an en passant move for the side making it, from the values found so far
+        // (none at first, as if the position it leads to were a draw)
+        auto enPassantExit = [&](const EnPassantMove& move) -> unsigned char
+        {
+            int wdl = move.capture_wdl;
+            int distance = move.capture_distance;
+            if (!move.captures_only)
+            {
+                int next_wdl = 0;
+                int next_distance = 0;
+                decodeValue(values[move.next_entry].load(std::memory_order_relaxed), &next_wdl, &next_distance);
+                if (isBetterResult(next_wdl, next_distance, wdl, distance))
+                {
+                    wdl = next_wdl;
+                    distance = next_distance;
+                }
+            }
+            return wdl ? (unsigned char)(distance + 2) : exitDraw;
+        };
+
+        static constexpr int kingSteps[8][2] = { { -1, -1 }, { -1, 0 }, { -1, 1 }, { 0, -1 }, { 0, 1 }, { 1, -1 }, { 1, 0 }, { 1, 1 } };
+        static constexpr int knightSteps[8][2] = { { -2, -1 }, { -2, 1 }, { -1, -2 }, { -1, 2 }, { 1, -2 }, { 1, 2 }, { 2, -1 }, { 2, 1 } };
+
+        // the en passant moves' results depend on the values they lead to, the table is generated
+        // again with the results of the last round until they don't change. A pawn moves forward
+        // only, so that takes a round or two more than there are pawns
+        const std::vector<unsigned char> move_exits = exits;
+        std::vector<unsigned char> en_passant_exits(en_passant_moves.size(), exitDraw);
+        std::vector<unsigned char> initial_values;
+        if (!en_passant_moves.empty())
+        {
+            initial_values.resize(2 * count);
+            for (unsigned long long entry = 0; entry < 2 * count; ++entry)
+                initial_values[entry] = values[entry].load(std::memory_order_relaxed);
+        }
+
+        for (int round = 0; ; ++round)
+        {
+            if (round > piece_count + 2)
+                return false;
+            if (round > 0)
+            {
+                for (unsigned long long entry = 0; entry < 2 * count; ++entry)
+                    values[entry].store(initial_values[entry], std::memory_order_relaxed);
+            }
+
+            exits = move_exits;
+            for (size_t m = 0; m < en_passant_moves.size(); ++m)
+            {
+                const unsigned char exit = en_passant_exits[m];
+                unsigned char& best_exit = exits[en_passant_moves[m].entry];
+                int wdl = 0;
+                int distance = 0;
+                int best_wdl = 0;
+                int best_distance = 0;
+                decodeValue((exit == exitDraw) ? 0 : exit, &wdl, &distance);
+                decodeValue((best_exit == exitDraw) ? 0 : best_exit, &best_wdl, &best_distance);
+                if (best_exit == exitNone || isBetterResult(wdl, distance, best_wdl, best_distance))
+                    best_exit = exit;
+            }
+
+            int longest_exit = 0;
+            for (unsigned long long entry = 0; entry < 2 * count; ++entry)
+            {
+                if (exits[entry] != exitInvalid && exits[entry] != exitDraw && exits[entry] != exitNone)
+                    longest_exit = std::max(longest_exit, exits[entry] - 1);
+            }
+
+            // pass after pass, the positions whose result is distance plies away make the positions
+            // a move before them known, a ply further away
+            for (int distance = 0; ; ++distance)
+            {
+                std::atomic<unsigned long long> changes(0);
+                parallelRanges(2 * count, thread_count, [&](unsigned long long begin, unsigned long long end)
+                {
+                    Position pos;
+                    int squares[Tablebases::maxPieces];
+                    int board[BOARD_SIZE * BOARD_SIZE];
+                    unsigned long long local_changes = 0;
+
+                    // a position a move before the current one, the moved piece back on from
+                    auto previous = [&](unsigned long long entry, int p, int from)
+                    {
+                        int previous_squares[Tablebases::maxPieces];
+                        std::copy(squares, squares + piece_count, previous_squares);
+                        previous_squares[p] = from;
+                        normalizeSquares(pawns, piece_count, previous_squares);
+                        const unsigned long long previous_entry = (entry < count ? count : 0) + squaresToIndex(pieces, piece_count, previous_squares);
+                        if (exits[previous_entry] == exitInvalid || values[previous_entry].load(std::memory_order_relaxed))
+                            return;
+
+                        // a move to a lost position wins, a position all of whose moves win for the other side is lost
+                        if (!(distance & 1) || allMovesLose(previous_entry, distance, &pos))
+                            local_changes += setValue(previous_entry, previous_squares, (unsigned char)(distance + 2));
+                    };
+
+                    for (unsigned long long entry = begin; entry < end; ++entry)
+                    {
+                        if (exits[entry] == exitInvalid)
+                            continue;
+
+                        const unsigned char value = values[entry].load(std::memory_order_relaxed);
+                        if (!value && exits[entry] == distance + 2 && exits[entry] != exitDraw)
+                        {
+                            // the best move leaving the table is as good as it gets now
+                            indexToSquares(pieces, piece_count, entry % count, squares);
+                            if (((distance + 1) & 1) || allMovesLose(entry, distance, &pos))
+                                local_changes += setValue(entry, squares, (unsigned char)(distance + 2));
+                            continue;
+                        }
+                        if (value != distance + 1)
+                            continue;
+
+                        indexToSquares(pieces, piece_count, entry % count, squares);
+                        std::fill(board, board + BOARD_SIZE * BOARD_SIZE, -1);
+                        for (int p = 0; p < piece_count; ++p)
+                            board[squares[p]] = p;
+
+                        // the pieces of the side that has just moved go back where they came from
+                        const unsigned char moved_color = (entry < count) ? Black : White;
+                        for (int p = 0; p < piece_count; ++p)
+                        {
+                            if ((pieces[p] & ColorMask) != moved_color)
+                                continue;
+
+                            const RowCol to = idxToRowCol(squares[p]);
+                            const unsigned char piece = pieces[p] & PieceMask;
+                            if (piece == Pawn)
+                            {
+                                // no promotions, those come from another table
+                                const int back = (moved_color == White) ? -1 : 1;
+                                const int from_row = to.row + back;
+                                if (from_row < ROW2 || from_row > ROW7 || board[rowColToIdx(from_row, to.col)] != -1)
+                                    continue;
+                                previous(entry, p, rowColToIdx(from_row, to.col));
+                                const int double_from_row = from_row + back;
+                                if (double_from_row != ((moved_color == White) ? ROW2 : ROW7) || board[rowColToIdx(double_from_row, to.col)] != -1)
+                                    continue;
+
+                                // not if an en passant capture can answer the double move, see EnPassantMove
+                                if (en_passant)
+                                {
+                                    setupPosition(pieces, piece_count, squares, entry < count, &pos);
+                                    pos.square(from_row, to.col).setFlagToOne(EnPassant);
+                                    if (!enPassantCaptures(pos).empty())
+                                        continue;
+                                }
+                                previous(entry, p, rowColToIdx(double_from_row, to.col));
+                            }
+                            else if (piece == King || piece == Knight)
+                            {
+                                const int (*steps)[2] = (piece == King) ? kingSteps : knightSteps;
+                                for (int s = 0; s < 8; ++s)
+                                {
+                                    const int from_row = to.row + steps[s][0];
+                                    const int from_col = to.col + steps[s][1];
+                                    if (from_row >= ROW1 && from_row <= ROW8 && from_col >= COLA && from_col <= COLH &&
+                                        board[rowColToIdx(from_row, from_col)] == -1)
+                                    {
+                                        previous(entry, p, rowColToIdx(from_row, from_col));
+                                    }
+                                }
+                            }
+                            else
+                            {
+                                // the sliders: the king steps are the directions, the bishop takes the
+                                // diagonal ones, the rook the others
+                                for (int s = 0; s < 8; ++s)
+                                {
+                                    const bool diagonal = kingSteps[s][0] && kingSteps[s][1];
+                                    if ((piece == Bishop && !diagonal) || (piece == Rook && diagonal))
+                                        continue;
+
+                                    int from_row = to.row + kingSteps[s][0];
+                                    int from_col = to.col + kingSteps[s][1];
+                                    while (from_row >= ROW1 && from_row <= ROW8 && from_col >= COLA && from_col <= COLH &&
+                                           board[rowColToIdx(from_row, from_col)] == -1)
+                                    {
+                                        previous(entry, p, rowColToIdx(from_row, from_col));
+                                        from_row += kingSteps[s][0];
+                                        from_col += kingSteps[s][1];
+                                    }
+                                }
+                            }
+                        }
+                    }
+                    changes += local_changes;
+                });
+
+                if (changes && distance + 1 > Tablebases::maxDistance)
+                    return false;
+                if (!changes && distance + 1 >= longest_exit)
+                    break;
+            }
+
+            bool settled = true;
+            for (size_t m = 0; m < en_passant_moves.size(); ++m)
+            {
+                const unsigned char exit = enPassantExit(en_passant_moves[m]);
+                settled = settled && (exit == en_passant_exits[m]);
+                en_passant_exits[m] = exit;
+            }
+            if (settled)
+                break;
+        }
+
+        m_material = material;
+        m_values.resize(2 * count);
+        for (unsigned long long entry = 0; entry < 2 * count; ++entry)
+        {
+            m_values[entry] = values[entry].load(std::memory_order_relaxed);
+            if (!m_values[entry])
+                continue;
+
+            const int distance = m_values[entry] - 1;
+            if (distance & 1)
+                ++m_win_count;
+            else
+                ++m_loss_count;
+            m_longest_mate = std::max(m_longest_mate, distance);
+        }
+        return true;
+    }
+
+    bool TablebaseGenerator::write(std::ostream& out) const
+    {
+        unsigned char pieces[Tablebases::maxPieces];
+        int piece_count = 0;
+        if (m_material.empty() || !parseMaterial(m_material, pieces, &piece_count))
+            return false;
+
+        std::vector<unsigned char> header(tableMagic, tableMagic + sizeof(tableMagic));
+        putU32(&header, tableVersion);
+        putU32(&header, (unsigned int)piece_count);
+        header.insert(header.end(), m_material.begin(), m_material.end());
+        header.resize(header.size() + materialNameSize - m_material.size(), 0);
+        putU64(&header, m_values.size() / 2);
+
+        out.write((const char*)header.data(), (std::streamsize)header.size());
+        out.write((const char*)m_values.data(), (std::streamsize)m_values.size());
+        return out.good();
+    }
+}   // namespace fatpup
@@ -1,26 +1,8 @@
+#include <algorithm>
 #include <limits>
 
 #include "capture_solver.h"
 
-class CaptureSolverPosition: public fatpup::Position
-{
-public:
-    CaptureSolverPosition(const fatpup::Position& prev_pos, fatpup::Move move):
-        Position(prev_pos)
-    {
-        moveDone(move);
-    }
-
-    int evaluateMaterial() const
-    {
-        int eval = 0;
-        for (int s_idx = 0; s_idx < fatpup::BOARD_SIZE * fatpup::BOARD_SIZE; ++s_idx)
-            eval += m_board[s_idx].value();
-
-        return eval;
-    }
-};
-
 CaptureSolver::CaptureSolver(const fatpup::Position& pos):
     _pos(pos)
 {
@@ -33,20 +15,17 @@ void CaptureSolver::moveDone(fatpup::Move move)
     findBestMove();
 }
 
+// the move winning the most material by static exchange evaluation, so a capture of a
+// defended piece only counts if it pays off after the recaptures
 void CaptureSolver::findBestMove()
 {
     const auto moves = _pos.possibleMoves();
     fatpup::Move bestMove;
     int bestMoveEval = std::numeric_limits<int>::lowest();
-    const bool reverseEval = !_pos.isWhiteTurn();
 
     for (auto move: moves)
     {
-        const CaptureSolverPosition pos(_pos, move);
-        int eval = pos.evaluateMaterial();
-        if (reverseEval)
-            eval = -eval;
-
+        const int eval = _pos.see(move);
         if (eval > bestMoveEval)
         {
             bestMoveEval = eval;
@@ -56,3 +35,24 @@ void CaptureSolver::findBestMove()
 
     _bestMove = bestMove;
 }
+
+// every move is a line of its own, the material it wins is the score
+std::vector<fatpup::SearchInfo> CaptureSolver::getBestLines(int num_lines)
+{
+    std::vector<fatpup::SearchInfo> lines;
+    for (auto move: _pos.possibleMoves())
+    {
+        fatpup::SearchInfo line;
+        line.depth = 1;
+        line.score = _pos.see(move) * 100 / fatpup::PawnValue;
+        line.pv.push_back(move);
+        lines.push_back(line);
+    }
+
+    std::stable_sort(lines.begin(), lines.end(), [](const fatpup::SearchInfo& a, const fatpup::SearchInfo& b) { return a.score > b.score; });
+    if ((int)lines.size() > num_lines)
+        lines.resize(num_lines);
+    for (size_t l = 0; l < lines.size(); ++l)
+        lines[l].multipv = (int)l + 1;
+    return lines;
+}
@@ -12,6 +12,7 @@ public:
     void stop() override {}
 
     fatpup::Move getBestMove() override { return _bestMove; }
+    std::vector<fatpup::SearchInfo> getBestLines(int num_lines) override;
     void moveDone(fatpup::Move move) override;
 
 private:
@@ -1,8 +1,15 @@
+#include <algorithm>
+
 #include "checkmate_solver.h"
 
+// the longest mate looked for and the nodes it may take, past those the first move is played
+static constexpr int maxMateMoves = 10;
+static constexpr unsigned long long mateNodeLimit = 1 << 20;
+
 CheckmateSolver::CheckmateSolver(const fatpup::Position& pos):
     _pos(pos)
 {
+    _solver.setNodeLimit(mateNodeLimit);
     findBestMove();
 }
 
@@ -15,16 +22,36 @@ void CheckmateSolver::moveDone(fatpup::Move move)
 void CheckmateSolver::findBestMove()
 {
     const auto moves = _pos.possibleMoves();
-    if (!moves.empty())
-        _bestMove = moves[0];   // just in case there's no checkmate
+    _bestMove = moves.empty() ? fatpup::Move() : moves[0];  // just in case there's no checkmate
+
+    _mateMoves = _solver.findMate(_pos, maxMateMoves, &_mateLine);
+    if (_mateMoves && !_mateLine.empty())
+        _bestMove = _mateLine[0];
+}
 
-    for (auto move: moves)
+// the mating line first, the other moves score nothing
+std::vector<fatpup::SearchInfo> CheckmateSolver::getBestLines(int num_lines)
+{
+    std::vector<fatpup::SearchInfo> lines;
+    for (auto move: _pos.possibleMoves())
     {
-        const fatpup::Position pos(_pos, move);
-        if (pos.getState() == fatpup::Position::State::Checkmate)
+        fatpup::SearchInfo line;
+        line.depth = 1;
+        if (_mateMoves && move == _bestMove)
         {
-            _bestMove = move;
-            break;
+            line.depth = 2 * _mateMoves - 1;
+            line.mate = _mateMoves;
+            line.pv = _mateLine;
         }
+        else
+            line.pv.push_back(move);
+        lines.push_back(line);
     }
+
+    std::stable_sort(lines.begin(), lines.end(), [](const fatpup::SearchInfo& a, const fatpup::SearchInfo& b) { return a.mate > b.mate; });
+    if ((int)lines.size() > num_lines)
+        lines.resize(num_lines);
+    for (size_t l = 0; l < lines.size(); ++l)
+        lines[l].multipv = (int)l + 1;
+    return lines;
 }
@@ -1,6 +1,7 @@
 #ifndef FATPUP_CLI_CHECKMATE_SOLVER_H
 #define FATPUP_CLI_CHECKMATE_SOLVER_H
 
+#include "fatpup/mate_solver.h"
 #include "solver.h"
 
 class CheckmateSolver: public Solver
@@ -12,13 +13,17 @@ public:
     void stop() override {}
 
     fatpup::Move getBestMove() override { return _bestMove; }
+    std::vector<fatpup::SearchInfo> getBestLines(int num_lines) override;
     void moveDone(fatpup::Move move) override;
 
 private:
     void findBestMove();
 
+    fatpup::MateSolver _solver;
     fatpup::Position _pos;
     fatpup::Move _bestMove;
+    int _mateMoves = 0;
+    std::vector<fatpup::Move> _mateLine;
 };
 
 #endif // FATPUP_CLI_CHECKMATE_SOLVER_H
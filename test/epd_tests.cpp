@@ -0,0 +1,117 @@
+#include <iostream>
+#include <sstream>
+
+#include "fatpup/epd.h"
+#include "color_scheme.h"
+#include "utils.h"
+
+#include "epd_tests.h"
+
+static bool checkSanRoundTrip(const fatpup::Position& pos)
+{
+    for (const auto move: pos.possibleMoves())
+    {
+        const std::string san = pos.moveToStringPGN(move);
+        if (pos.moveFromStringPGN(san) != move)
+        {
+            std::cout << "Error! SAN round trip failed for " << san << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool runEpdTests()
+{
+    std::cout << testTitleColor << "EPD Tests" << rang::fg::reset << std::endl;
+
+    // SAN parsing: every legal move along a few random games must parse back to itself
+    fatpup::Position initial_pos;
+    initial_pos.setInitial();
+    for (unsigned int seed = 1; seed <= 20; ++seed)
+    {
+        fatpup::Position pos = initial_pos;
+        for (const auto move: RandomGame(initial_pos, 200, seed))
+        {
+            if (!checkSanRoundTrip(pos))
+                return false;
+            pos += move;
+        }
+    }
+
+    // alternative notations seen in the wild
+    {
+        fatpup::Position pos;
+        pos.setFEN("1n2k3/P7/8/3pP3/8/8/8/R3K2R w KQ d6 0 1");
+        const struct { const char* san; const char* expected; } spellings[] =
+        {
+            { "axb8Q", "axb8=Q+" }, { "a7b8=N+", "axb8=N" }, { "exd6!?", "exd6" },
+            { "0-0", "O-O" }, { "0-0-0+", "O-O-O" }, { "Ra1-d1", "Rd1" }
+        };
+        for (const auto& spelling: spellings)
+        {
+            const fatpup::Move move = pos.moveFromStringPGN(spelling.san);
+            if (move.isEmpty() || pos.moveToStringPGN(move) != spelling.expected)
+            {
+                std::cout << "Error! Couldn't parse " << spelling.san << std::endl;
+                return false;
+            }
+        }
+
+        // illegal, ambiguous and malformed moves
+        for (const char* san: { "Ke3", "d4", "axb8=K", "Nf3", "Rxd6", "e9", "" })
+        {
+            if (!pos.moveFromStringPGN(san).isEmpty())
+            {
+                std::cout << "Error! " << san << " shall not parse" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    std::istringstream suite(
+        "# comment line\n"
+        "\n"
+        "1r4k1/5Npp/4Q3/8/8/8/6K1/8 w - - bm Nh6+; id \"smothered; mate\";\n"
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - am f3 g4; c0 \"fool's mate\"; acd 3;\n");
+
+    std::vector<fatpup::EpdRecord> records;
+    if (!fatpup::readEpd(suite, &records) || records.size() != 2)
+    {
+        std::cout << "Error! Couldn't read the EPD suite" << std::endl;
+        return false;
+    }
+
+    const auto& smothered = records[0];
+    if (smothered.id != "smothered; mate" || smothered.best_moves.size() != 1 ||
+        smothered.pos.moveToStringPGN(smothered.best_moves[0]) != "Nh6+" ||
+        !smothered.isSolvedBy(smothered.best_moves[0]) ||
+        smothered.isSolvedBy(smothered.pos.moveFromStringPGN("Qe8+")))
+    {
+        std::cout << "Error! Wrong bm/id in " << smothered.fen << std::endl;
+        return false;
+    }
+
+    const auto& opening = records[1];
+    if (opening.fen != "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -" ||
+        opening.avoid_moves.size() != 2 || opening.operation("acd") != "3" || opening.operation("c0") != "fool's mate" ||
+        opening.isSolvedBy(opening.pos.moveFromStringPGN("g4")) || !opening.isSolvedBy(opening.pos.moveFromStringPGN("e4")))
+    {
+        std::cout << "Error! Wrong am/operations in " << opening.fen << std::endl;
+        return false;
+    }
+
+    std::istringstream broken("8/8/8/8/8/8/8/K6k w - - id \"ok\";\n8/8/8/8/8/8/8/K6k w - - bm Qh8;\n");
+    size_t error_line = 0;
+    records.clear();
+    if (fatpup::readEpd(broken, &records, &error_line) || error_line != 2)
+    {
+        std::cout << "Error! Illegal bm move not reported" << std::endl;
+        return false;
+    }
+
+    std::cout << successMsgColor << "  Success, all EPD tests passed!" << rang::fg::reset << std::endl;
+
+    return true;
+}
@@ -0,0 +1,7 @@
+#ifndef FATPUP_TEST_EPD_TESTS_H
+#define FATPUP_TEST_EPD_TESTS_H
+
+// EPD parsing and SAN move parsing tests
+bool runEpdTests();
+
+#endif  // FATPUP_TEST_EPD_TESTS_H
@@ -3,24 +3,43 @@
 #include "fatpup/position.h"
 #include "possible_moves_tests.h"
 #include "performance_tests.h"
+#include "epd_tests.h"
 #include "fen_tests.h"
+#include "game_codec_tests.h"
+#include "mate_solver_tests.h"
 #include "minimax_tests.h"
+#include "nnue_tests.h"
+#include "packed_move_tests.h"
 #include "pgn_tests.h"
+#include "polyglot_tests.h"
+#include "position_index_tests.h"
+#include "see_tests.h"
+#include "tablebase_tests.h"
 
 int main(int argc, char *argv[])
 {
     runPossibleMovesTests(false);
 
-    //runEvaluationPerformanceTests();
-    //runEvaluationPerformanceTests();
+    runEvaluationPerformanceTests();
 
     //runFindBestMoveTests();
 
+    //runPgnWriterPerformanceTests();
+
     runFenTests();
     runPgnTests();
+    runGameCodecTests(true);
+    runPackedMoveTests();
+    runEpdTests();
+    runPolyglotTests();
+    runPositionIndexTests(true);
+    runSeeTests();
+    runMateSolverTests(true);
+    runTablebaseTests(true);
 
     // engine tests
     runMinimaxTests(true);
+    runNnueTests(true);
 
     return 0;
 }
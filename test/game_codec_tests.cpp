@@ -0,0 +1,175 @@
+#include <iostream>
+#include <sstream>
+
+#include "fatpup/game_codec.h"
+#include "color_scheme.h"
+#include "utils.h"
+
+#include "game_codec_tests.h"
+
+static bool roundTrip(const fatpup::Position& start_pos, const std::vector<fatpup::Move>& moves, fatpup::MoveCoding coding, size_t* encoded_size)
+{
+    fatpup::GameEncoder encoder(start_pos, coding);
+    for (const auto move: moves)
+    {
+        if (!encoder.addMove(move))
+        {
+            std::cout << "Error! GameEncoder rejected a legal move" << std::endl;
+            return false;
+        }
+    }
+    *encoded_size = encoder.data().size();
+
+    fatpup::GameDecoder decoder(start_pos, encoder.data().data(), encoder.data().size(), encoder.plyCount(), coding);
+    fatpup::Move move;
+    size_t ply = 0;
+    while (decoder.nextMove(&move))
+    {
+        if (ply >= moves.size() || move != moves[ply])
+        {
+            std::cout << "Error! GameDecoder returned a wrong move at ply " << ply << std::endl;
+            return false;
+        }
+        ++ply;
+    }
+
+    if (decoder.isCorrupted() || ply != moves.size() || decoder.position() != encoder.position())
+    {
+        std::cout << "Error! GameDecoder stopped at ply " << ply << " out of " << moves.size() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool runGameCodecTests(bool verbose)
+{
+    std::cout << testTitleColor << "Game Codec Tests" << rang::fg::reset << std::endl;
+
+    fatpup::Position initial_pos;
+    initial_pos.setInitial();
+
+    // illegal moves shall be rejected
+    {
+        fatpup::GameEncoder encoder(initial_pos);
+        if (encoder.addMove(fatpup::Move("e2e5")) || encoder.plyCount() != 0)
+        {
+            std::cout << "Error! GameEncoder accepted an illegal move" << std::endl;
+            return false;
+        }
+    }
+
+    static constexpr int numGames = 40;
+    size_t total_plies = 0;
+    size_t total_bytes[2] = { 0, 0 };
+    std::vector<std::vector<fatpup::Move>> games;
+    for (int g = 0; g < numGames; ++g)
+    {
+        games.push_back(RandomGame(initial_pos, 300, g + 1));
+        total_plies += games.back().size();
+
+        for (int c = 0; c < 2; ++c)
+        {
+            size_t encoded_size = 0;
+            if (!roundTrip(initial_pos, games.back(), c ? fatpup::MoveCoding::Bits : fatpup::MoveCoding::Bytes, &encoded_size))
+                return false;
+            total_bytes[c] += encoded_size;
+        }
+    }
+
+    if (verbose)
+    {
+        std::cout << total_plies << " plies, " << total_bytes[0] << " bytes byte-coded, " << total_bytes[1] << " bytes bit-coded (" <<
+            (total_bytes[1] * 8.0 / total_plies) << " bits per ply), " << total_plies * 5 << " bytes as UCI strings" << std::endl;
+    }
+
+    // truncated record
+    {
+        fatpup::GameEncoder encoder(initial_pos);
+        for (const auto move: games[0])
+            encoder.addMove(move);
+
+        fatpup::GameDecoder decoder(initial_pos, encoder.data().data(), encoder.data().size() / 2, encoder.plyCount());
+        fatpup::Move move;
+        while (decoder.nextMove(&move))
+            ;
+        if (!decoder.isCorrupted())
+        {
+            std::cout << "Error! GameDecoder didn't detect a truncated record" << std::endl;
+            return false;
+        }
+    }
+
+    // archive with a mix of the initial and custom start positions
+    {
+        fatpup::Position custom_pos;
+        if (!custom_pos.setFEN("r3k2r/pp3ppp/8/3pP3/8/8/PP3PPP/R3K2R w KQkq d6 0 1"))
+            return false;
+        const auto custom_game = RandomGame(custom_pos, 100, 777);
+
+        std::ostringstream out;
+        {
+            fatpup::GameArchiveWriter writer(out);
+            for (const auto& game: games)
+            {
+                if (!writer.addGame(initial_pos, game))
+                    return false;
+            }
+            if (!writer.addGame(custom_pos, custom_game))
+                return false;
+        }
+
+        const std::string image = out.str();
+        fatpup::GameArchiveReader reader;
+        if (!reader.open((const unsigned char*)image.data(), image.size()) || reader.gameCount() != games.size() + 1)
+        {
+            std::cout << "Error! GameArchiveReader failed to open the archive" << std::endl;
+            return false;
+        }
+
+        fatpup::Position start_pos;
+        std::vector<fatpup::Move> moves;
+        for (size_t g = 0; g < games.size(); ++g)
+        {
+            if (!reader.readGame(g, &start_pos, &moves) || start_pos != initial_pos || moves != games[g])
+            {
+                std::cout << "Error! Game " << g << " read from the archive doesn't match" << std::endl;
+                return false;
+            }
+        }
+        if (!reader.readGame(games.size(), &start_pos, &moves) || start_pos != custom_pos || moves != custom_game)
+        {
+            std::cout << "Error! Custom start position game read from the archive doesn't match" << std::endl;
+            return false;
+        }
+
+        if (reader.open((const unsigned char*)image.data(), image.size() - 1))
+        {
+            std::cout << "Error! GameArchiveReader opened a damaged archive" << std::endl;
+            return false;
+        }
+    }
+
+    // a record whose ply count doesn't fit its data: byte-coded, 2^56 - 1 plies in 1 byte
+    {
+        const unsigned char image[] =
+        {
+            0, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f, 1, 0,    // the game
+            0, 0, 0, 0, 0, 0, 0, 0,                                     // index
+            11, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 'F', 'P', 'G', 'A', 1, 0, 0, 0
+        };
+        fatpup::GameArchiveReader reader;
+        fatpup::GameDecoder decoder;
+        fatpup::Position start_pos;
+        std::vector<fatpup::Move> moves;
+        if (!reader.open(image, sizeof(image)) || reader.gameDecoder(0, &decoder) || reader.readGame(0, &start_pos, &moves))
+        {
+            std::cout << "Error! GameArchiveReader accepted a record with more plies than its data holds" << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << successMsgColor << "  Success, all game codec tests passed!" << rang::fg::reset << std::endl;
+
+    return true;
+}
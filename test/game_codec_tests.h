@@ -0,0 +1,7 @@
+#ifndef FATPUP_TEST_GAME_CODEC_TESTS_H
+#define FATPUP_TEST_GAME_CODEC_TESTS_H
+
+// GameEncoder/GameDecoder and the game archive container tests
+bool runGameCodecTests(bool verbose = false);
+
+#endif  // FATPUP_TEST_GAME_CODEC_TESTS_H
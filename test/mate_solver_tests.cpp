@@ -0,0 +1,123 @@
+#include <chrono>
+#include <iostream>
+
+#include "fatpup/mate_solver.h"
+#include "color_scheme.h"
+
+#include "mate_solver_tests.h"
+
+struct MatePuzzle
+{
+    const char* fen;
+    bool checks_only;
+    int mate;               // 0 if there's no mate in max_moves
+    int max_moves;
+};
+
+static const MatePuzzle matePuzzles[] =
+{
+    { "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", true, 1, 3 },                                        // back rank
+    { "r1bqkbnr/pppp1ppp/2n5/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 0 1", true, 1, 3 },         // scholar's mate
+    { "1r4k1/5Npp/4Q3/8/8/8/6K1/8 w - - 0 1", true, 2, 4 },                                     // smothered mate
+    { "1k1r4/pp1b4/3q4/8/8/8/1PP2B2/2K5 b - - 0 1", true, 3, 5 },                               // queen sacrifice
+    { "r5k1/6pp/8/6N1/8/8/8/2Q3K1 w - - 0 1", true, 5, 6 },                                     // Philidor's legacy
+    { "8/8/8/3k4/8/8/8/QR4K1 w - - 0 1", true, 5, 6 },                                          // ladder mate
+    { "8/8/3k4/8/8/8/8/QR4K1 w - - 0 1", true, 6, 8 },
+    { "8/8/2kN4/8/8/8/3r2r1/2K5 b - - 0 1", false, 2, 3 },                                      // quiet first move
+    { "3n4/ppB5/1P6/8/K1k5/P7/1r6/8 b - - 0 1", false, 3, 3 },
+    { "8/8/2kN4/8/8/8/3r2r1/2K5 b - - 0 1", true, 0, 3 },                                       // checks only miss them
+    { "3n4/ppB5/1P6/8/K1k5/P7/1r6/8 b - - 0 1", true, 0, 3 },
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", true, 0, 3 },                  // no mate at all
+    { "7k/8/5K2/8/8/8/8/1R6 w - - 0 1", true, 0, 1 }                                            // a check, but no mate
+};
+
+// the line must be legal, alternate sides and end in a mate at the attacker's mate-th move
+static bool checkMateLine(const fatpup::Position& start_pos, const std::vector<fatpup::Move>& line, int mate)
+{
+    if ((int)line.size() != 2 * mate - 1)
+        return false;
+
+    fatpup::Position pos = start_pos;
+    for (auto move: line)
+    {
+        bool legal = false;
+        for (auto possible_move: pos.possibleMoves())
+            legal = legal || (possible_move == move);
+        if (!legal)
+            return false;
+        pos += move;
+    }
+    return pos.getState() == fatpup::Position::State::Checkmate;
+}
+
+bool runMateSolverTests(bool verbose)
+{
+    std::cout << testTitleColor << "Mate Solver Tests" << rang::fg::reset << std::endl;
+
+    fatpup::MateSolver solver;
+    for (const auto& puzzle: matePuzzles)
+    {
+        fatpup::Position pos;
+        if (!pos.setFEN(puzzle.fen))
+        {
+            std::cout << errorMsgColor << "Error! Couldn't parse " << puzzle.fen << rang::fg::reset << std::endl;
+            return false;
+        }
+
+        solver.setChecksOnly(puzzle.checks_only);
+        std::vector<fatpup::Move> line;
+        const int mate = solver.findMate(pos, puzzle.max_moves, &line);
+        if (mate != puzzle.mate || (mate && !checkMateLine(pos, line, mate)) || (!mate && !line.empty()))
+        {
+            std::cout << errorMsgColor << "Error! Mate in " << mate << " (" << line.size() << " plies) found in " <<
+                puzzle.fen << " instead of mate in " << puzzle.mate << rang::fg::reset << std::endl;
+            return false;
+        }
+
+        if (verbose && mate)
+        {
+            std::cout << "  mate in " << mate << ", " << solver.nodeCount() << " nodes:";
+            for (auto move: line)
+            {
+                std::cout << " " << pos.moveToStringPGN(move);
+                pos += move;
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    // the node limit stops the search without a mate
+    fatpup::Position pos;
+    pos.setFEN("8/8/3k4/8/8/8/8/QR4K1 w - - 0 1");
+    solver.setChecksOnly(true);
+    solver.setNodeLimit(100);
+    if (solver.findMate(pos, 8) || !solver.nodeLimitReached())
+    {
+        std::cout << errorMsgColor << "Error! Mate solver node limit ignored" << rang::fg::reset << std::endl;
+        return false;
+    }
+    solver.setNodeLimit(0);
+
+    if (verbose)
+    {
+        static constexpr int numLoops = 5;
+        int solved = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numLoops; ++i)
+        {
+            for (const auto& puzzle: matePuzzles)
+            {
+                pos.setFEN(puzzle.fen);
+                solver.setChecksOnly(puzzle.checks_only);
+                solver.findMate(pos, puzzle.max_moves);
+                ++solved;
+            }
+        }
+        const auto executedIn = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << solved << " puzzles in " << executedIn << " ms, " << (solved * 1000 / (executedIn ? executedIn : 1)) <<
+            " puzzles/s" << std::endl;
+    }
+
+    std::cout << successMsgColor << "  Success, all mate solver tests passed!" << rang::fg::reset << std::endl;
+    return true;
+}
@@ -0,0 +1,7 @@
+#ifndef FATPUP_TEST_MATE_SOLVER_TESTS_H
+#define FATPUP_TEST_MATE_SOLVER_TESTS_H
+
+// MateSolver tests, the verbose ones also time the puzzles
+bool runMateSolverTests(bool verbose = false);
+
+#endif  // FATPUP_TEST_MATE_SOLVER_TESTS_H
@@ -2,55 +2,235 @@
     #error Wrong build configuration: BUILD_TESTS not defined, but the file is included in build
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
 #include <iostream>
+#include <string>
+#include <thread>
 
+#include "fatpup/epd.h"
 #include "../engines/minimax.h"
 
 #include "color_scheme.h"
 
 bool runMinimaxTests(bool verbose)
 {
-    struct Test
+    // bm lists all the moves that are equally good (e.g. mates of the same length), acd is the search depth
+    static const char* tests[] =
     {
-        std::string fen;
-        std::string bestMove;
-        int searchDepth;
-    };
-
-    static const Test tests[] =
-    {
-        { "1r4k1/5Npp/4Q3/8/8/8/6K1/8 w - -",                       "f7d8", 3  },
-        { "8/8/2kN4/8/8/8/3r2r1/2K5 b - -",                         "d2f2", 3  },
-        { "8/8/5q2/8/4N3/2r1k3/8/4K3 w - -",                        "e4c3", 3  },
-        { "3n4/ppB5/1P6/8/K1k5/P7/1r6/8 b - -",                     "b2b6", 5  },
-        { "8/8/pp2r3/1kprpP2/3p4/1KPP4/8/2B5 w - -",                "c3c4", 5  },
-        { "k7/1pK5/1P1PP3/8/8/8/8/8 w - -",                         "c7d7", 4  },
-        { "3k4/8/4K3/3P4/8/8/8/8 w - - 0 1",                        "e6d6", 9  },
-        { "1k1r4/pp1b4/3q4/8/8/8/1PP2B2/2K5 b - -",                 "d6d1", 5  }
+        "1r4k1/5Npp/4Q3/8/8/8/6K1/8 w - - bm Nd8+; acd 3;",
+        "8/8/2kN4/8/8/8/3r2r1/2K5 b - - bm Rdf2 Rxd6; acd 3;",
+        "8/8/5q2/8/4N3/2r1k3/8/4K3 w - - bm Nxc3; acd 3;",
+        "3n4/ppB5/1P6/8/K1k5/P7/1r6/8 b - - bm Rxb6; acd 5;",
+        "8/8/pp2r3/1kprpP2/3p4/1KPP4/8/2B5 w - - bm c4+; acd 5;",
+        "k7/1pK5/1P1PP3/8/8/8/8/8 w - - bm Kd7; acd 4;",
+        "3k4/8/4K3/3P4/8/8/8/8 w - - bm Kd6; acd 9;",
+        "1k1r4/pp1b4/3q4/8/8/8/1PP2B2/2K5 b - - bm Qd1+; acd 5;"
     };
     static const int numTests = sizeof(tests) / sizeof(tests[0]);
 
-    fatpup::Position pos;
     int eval = 0;
     fatpup::Move bestMove;
+    fatpup::MinimaxEngine engine;
+
+    // with no hash table first and then with the default one, then with each selective search
+    // technique turned off in turn: the node counts show what each one saves
+    struct Configuration
+    {
+        const char* description;
+        const char* option;
+        const char* value;
+        const char* restoredValue;
+    };
+    static const Configuration configurations[] =
+    {
+        { "0 MB hash", "Hash", "0", "16" },
+        { "16 MB hash", "Hash", "16", "16" },
+        { "no null move", "NullMove", "false", "true" },
+        { "no late move reductions", "LateMoveReductions", "false", "true" },
+        { "no futility pruning", "Futility", "false", "true" }
+    };
+    for (const auto& configuration: configurations)
+    {
+        engine.SetOption("Clear Hash", "");
+        if (!engine.SetOption(configuration.option, configuration.value))
+        {
+            std::cout << errorMsgColor << "Minimax option " << configuration.option << " rejected" << rang::fg::reset << std::endl;
+            return false;
+        }
+
+        unsigned long long totalNodes = 0;
+        const auto statsBefore = engine.GetSearchStats();
+        for (int t = 0; t < numTests; ++t)
+        {
+            fatpup::EpdRecord test;
+            if (!fatpup::parseEpd(tests[t], &test))
+            {
+                std::cout << errorMsgColor << "Minimax position " << (t + 1) << " load failed" << rang::fg::reset << std::endl;
+                return false;
+            }
+
+            const unsigned long long nodesBefore = engine.GetNodeCount();
+            bestMove = engine.FindBestMove(test.pos, eval, 1, std::atoi(test.operation("acd").c_str()));
+            const unsigned long long nodes = engine.GetNodeCount() - nodesBefore;
+            totalNodes += nodes;
+            if (!test.isSolvedBy(bestMove))
+            {
+                std::cout << errorMsgColor << "Minimax test " << (t + 1) << " (" << configuration.description << ") failed, expected " <<
+                    test.operation("bm") << ", got " << test.pos.moveToStringPGN(bestMove) << rang::fg::reset << std::endl;
+                return false;
+            }
+            if (verbose)
+                std::cout << successMsgColor << "Minimax test " << (t + 1) << "/" << numTests << " (" << configuration.description << ") passed, " <<
+                    nodes << " nodes" << rang::fg::reset << std::endl;
+        }
+        engine.SetOption(configuration.option, configuration.restoredValue);
+
+        if (verbose)
+        {
+            const auto& stats = engine.GetSearchStats();
+            const unsigned long long cutoffs = stats.cutoffs - statsBefore.cutoffs;
+            const unsigned long long firstMoveCutoffs = stats.firstMoveCutoffs - statsBefore.firstMoveCutoffs;
+            const unsigned long long pawnProbes = stats.pawnProbes - statsBefore.pawnProbes;
+            const unsigned long long pawnHits = stats.pawnHits - statsBefore.pawnHits;
+            std::cout << totalNodes << " nodes in total with " << configuration.description << ", " << cutoffs << " cutoffs, " <<
+                (cutoffs ? firstMoveCutoffs * 100 / cutoffs : 0) << "% by the first move, pawn table hits " <<
+                (pawnProbes ? pawnHits * 100 / pawnProbes : 0) << "%" << std::endl;
+        }
+    }
+
+    // same positions through the iterative deepening search, it must come to the same conclusions.
+    // The PV reported for the last iteration starts with the best move and is a line of legal moves
+    std::vector<fatpup::Move> pv;
+    engine.SetInfoCallback([&pv](const fatpup::SearchInfo& info) { pv = info.pv; });
     for (int t = 0; t < numTests; ++t)
     {
-        if (!pos.setFEN(tests[t].fen))
+        fatpup::EpdRecord test;
+        fatpup::parseEpd(tests[t], &test);
+
+        fatpup::SearchLimits limits;
+        limits.depth = std::atoi(test.operation("acd").c_str());
+        engine.SetSearchLimits(limits);
+        engine.SetPosition(test.pos);
+        bestMove = engine.GetBestMove();
+        if (!test.isSolvedBy(bestMove))
         {
-            std::cout << errorMsgColor << "Minimax position " << (t + 1) << " load failed" << rang::fg::reset << std::endl;
+            std::cout << errorMsgColor << "Minimax iterative deepening test " << (t + 1) << " failed, expected " << test.operation("bm") <<
+                ", got " << test.pos.moveToStringPGN(bestMove) << rang::fg::reset << std::endl;
             return false;
         }
-        bestMove = fatpup::MinimaxEngine::FindBestMove(pos, eval, 1, tests[t].searchDepth);
-        if (bestMove != fatpup::Move(tests[t].bestMove))
+
+        fatpup::Position pvPos = test.pos;
+        std::string pvText;
+        bool pvLegal = !pv.empty() && pv.front() == bestMove && pv == engine.GetPrincipalVariation();
+        for (size_t m = 0; m < pv.size() && pvLegal; ++m)
+        {
+            const auto moves = pvPos.possibleMoves();
+            pvLegal = (std::find(moves.begin(), moves.end(), pv[m]) != moves.end());
+            if (pvLegal)
+            {
+                pvText += " " + pvPos.moveToStringPGN(pv[m]);
+                pvPos += pv[m];
+            }
+        }
+        if (!pvLegal)
         {
-            std::cout << errorMsgColor << "Minimax test " << (t + 1) << " failed, expected " << pos.moveToString(tests[t].bestMove) <<
-                ", got " << pos.moveToString(bestMove) << rang::fg::reset << std::endl;
+            std::cout << errorMsgColor << "Minimax PV test " << (t + 1) << " failed," << pvText << rang::fg::reset << std::endl;
             return false;
         }
         if (verbose)
-            std::cout << successMsgColor << "Minimax test " << (t + 1) << "/" << numTests << " passed" << rang::fg::reset << std::endl;
+            std::cout << successMsgColor << "Minimax PV test " << (t + 1) << "/" << numTests << " passed:" << pvText << rang::fg::reset << std::endl;
+    }
+    engine.SetInfoCallback(nullptr);
+
+    // the node limit stops the search, but only after the first iteration has provided a move
+    fatpup::SearchLimits nodeLimits;
+    nodeLimits.nodes = 1000;
+    engine.SetSearchLimits(nodeLimits);
+    fatpup::Position initialPos;
+    initialPos.setInitial();
+    engine.SetPosition(initialPos);
+    bestMove = engine.GetBestMove();
+    if (bestMove.isEmpty() || engine.GetNodeCount() > nodeLimits.nodes)
+    {
+        std::cout << errorMsgColor << "Minimax node limit test failed, " << engine.GetNodeCount() << " nodes searched" << rang::fg::reset << std::endl;
+        return false;
+    }
+
+    // an infinite search in the background only reports its move once stopped
+    fatpup::SearchLimits infiniteLimits;
+    infiniteLimits.infinite = true;
+    engine.SetSearchLimits(infiniteLimits);
+    engine.SetPosition(initialPos);
+    std::atomic<int> bestMoveCount{0};
+    engine.Start([&bestMove, &bestMoveCount](fatpup::Move move) { bestMove = move; ++bestMoveCount; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const bool reportedEarly = (bestMoveCount != 0);
+    engine.Stop();
+    if (reportedEarly || bestMoveCount != 1 || bestMove.isEmpty())
+    {
+        std::cout << errorMsgColor << "Minimax asynchronous search test failed" << rang::fg::reset << std::endl;
+        return false;
+    }
+
+    // pondering doesn't end before PonderHit() either, then the depth limit applies
+    fatpup::SearchLimits ponderLimits;
+    ponderLimits.ponder = true;
+    ponderLimits.depth = 2;
+    engine.SetSearchLimits(ponderLimits);
+    engine.SetPosition(initialPos);
+    std::promise<fatpup::Move> ponderResult;
+    engine.Start([&ponderResult](fatpup::Move move) { ponderResult.set_value(move); });
+    auto ponderMove = ponderResult.get_future();
+    const bool ponderedEarly = (ponderMove.wait_for(std::chrono::milliseconds(50)) == std::future_status::ready);
+    engine.PonderHit();
+    bestMove = ponderMove.get();
+    engine.Stop();
+    if (ponderedEarly || bestMove.isEmpty())
+    {
+        std::cout << errorMsgColor << "Minimax pondering test failed" << rang::fg::reset << std::endl;
+        return false;
+    }
+
+    // MultiPV: the lines start with different moves and come best first, the first one is the
+    // move played. The lines share the hash table, so three of them cost much less than three searches
+    fatpup::SearchLimits multiPvLimits;
+    multiPvLimits.depth = 6;
+    engine.SetSearchLimits(multiPvLimits);
+    engine.SetOption("Clear Hash", "");
+    engine.SetPosition(initialPos);
+    bestMove = engine.GetBestMove();
+    const unsigned long long singleLineNodes = engine.GetNodeCount();
+    const size_t numLines = 3;
+    engine.SetOption("Clear Hash", "");
+    engine.SetOption("MultiPV", std::to_string(numLines));
+    bestMove = engine.GetBestMove();
+    const unsigned long long multiPvNodes = engine.GetNodeCount();
+    const auto lines = engine.GetBestLines();
+    engine.SetOption("MultiPV", "1");
+    // mates first, then by score
+    auto lineValue = [](const fatpup::SearchInfo& line) { return line.mate ? (line.mate > 0 ? 1000000 - line.mate : -1000000 - line.mate) : line.score; };
+    bool linesValid = (lines.size() == numLines && !bestMove.isEmpty() && lines.front().pv.front() == bestMove &&
+                       multiPvNodes < numLines * singleLineNodes);
+    for (size_t l = 0; l < lines.size() && linesValid; ++l)
+    {
+        linesValid = !lines[l].pv.empty() && lines[l].multipv == (int)l + 1 && lines[l].depth == multiPvLimits.depth;
+        for (size_t prev = 0; prev < l && linesValid; ++prev)
+            linesValid = (lines[prev].pv.front() != lines[l].pv.front() && lineValue(lines[prev]) >= lineValue(lines[l]));
+    }
+    if (!linesValid)
+    {
+        std::cout << errorMsgColor << "Minimax MultiPV test failed, " << lines.size() << " lines, " << multiPvNodes << " nodes" << rang::fg::reset << std::endl;
+        return false;
     }
+    if (verbose)
+        std::cout << successMsgColor << "Minimax MultiPV test passed, " << numLines << " lines in " << multiPvNodes << " nodes, one line in " <<
+            singleLineNodes << rang::fg::reset << std::endl;
 
+    engine.SetSearchLimits(fatpup::SearchLimits());
     std::cout << successMsgColor << "  Success, all Minimax tests passed!" << rang::fg::reset << std::endl;
 
     return true;
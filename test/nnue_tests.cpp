@@ -0,0 +1,173 @@
+#if !defined(BUILD_TESTS)
+    #error Wrong build configuration: BUILD_TESTS not defined, but the file is included in build
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include "../engines/minimax.h"
+#include "../engines/nnue.h"
+
+#include "color_scheme.h"
+#include "utils.h"
+
+#include "nnue_tests.h"
+
+// the squares whose piece differs between the positions, like MinimaxPosition records them
+static int boardChanges(const fatpup::Position& before, const fatpup::Position& after, fatpup::SquareChange* changes)
+{
+    int numChanges = 0;
+    for (int s_idx = 0; s_idx < fatpup::BOARD_SIZE * fatpup::BOARD_SIZE; ++s_idx)
+    {
+        const unsigned char pieceBefore = before.square(s_idx / fatpup::BOARD_SIZE, s_idx % fatpup::BOARD_SIZE).pieceWithColor();
+        const unsigned char pieceAfter = after.square(s_idx / fatpup::BOARD_SIZE, s_idx % fatpup::BOARD_SIZE).pieceWithColor();
+        if (pieceBefore == pieceAfter)
+            continue;
+        if (numChanges == fatpup::maxSquareChanges)
+            return -1;
+        changes[numChanges++] = fatpup::SquareChange{ (unsigned char)s_idx, pieceBefore, pieceAfter };
+    }
+    return numChanges;
+}
+
+bool runNnueTests(bool verbose)
+{
+    std::cout << testTitleColor << "NNUE Tests" << rang::fg::reset << std::endl;
+
+    fatpup::Position initial_pos;
+    initial_pos.setInitial();
+
+    fatpup::NnueNetwork network;
+    network.Randomize(1);
+
+    // the accumulator updated move by move shall always be the one computed from scratch
+    static constexpr int numGames = 20;
+    size_t total_plies = 0;
+    for (int g = 0; g < numGames; ++g)
+    {
+        fatpup::Position pos = initial_pos;
+        fatpup::NnueNetwork::Accumulator acc;
+        network.Refresh(pos, &acc);
+        for (const auto move: RandomGame(initial_pos, 300, g + 1))
+        {
+            const fatpup::Position prev_pos = pos;
+            pos += move;
+
+            fatpup::SquareChange changes[fatpup::maxSquareChanges];
+            const int numChanges = boardChanges(prev_pos, pos, changes);
+            if (numChanges < 0)
+            {
+                std::cout << errorMsgColor << "Error! Move " << prev_pos.moveToString(move) << " changes too many squares" << rang::fg::reset << std::endl;
+                return false;
+            }
+            network.Update(acc, changes, numChanges, &acc);
+
+            fatpup::NnueNetwork::Accumulator full;
+            network.Refresh(pos, &full);
+            if (std::memcmp(&acc, &full, sizeof(acc)) != 0 ||
+                network.Evaluate(acc, pos.isWhiteTurn()) != network.Evaluate(full, pos.isWhiteTurn()))
+            {
+                std::cout << errorMsgColor << "Error! Incremental NNUE accumulator differs after " << prev_pos.moveToString(move) <<
+                    " in game " << (g + 1) << rang::fg::reset << std::endl;
+                return false;
+            }
+            ++total_plies;
+        }
+    }
+    if (verbose)
+        std::cout << "Incremental accumulator checked over " << total_plies << " plies" << std::endl;
+
+    // the evaluation is from the side to move's point of view, so the mirrored position shall get the same one
+    {
+        fatpup::Position pos;
+        fatpup::Position mirrored_pos;
+        if (!pos.setFEN("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4") ||
+            !mirrored_pos.setFEN("rnbqk2r/pppp1ppp/5n2/2b1p3/4P3/2N2N2/PPPP1PPP/R1BQKB1R b KQkq - 4 4"))
+            return false;
+
+        fatpup::NnueNetwork::Accumulator acc;
+        fatpup::NnueNetwork::Accumulator mirrored_acc;
+        network.Refresh(pos, &acc);
+        network.Refresh(mirrored_pos, &mirrored_acc);
+        if (network.Evaluate(acc, true) != network.Evaluate(mirrored_acc, false))
+        {
+            std::cout << errorMsgColor << "Error! NNUE evaluation of a mirrored position differs" << rang::fg::reset << std::endl;
+            return false;
+        }
+    }
+
+    // weights file round trip, and the engine playing with it
+    const char* network_path = "fatpup_test.nnue";
+    if (!network.Save(network_path))
+    {
+        std::cout << errorMsgColor << "Error! Couldn't save the network" << rang::fg::reset << std::endl;
+        return false;
+    }
+
+    fatpup::NnueNetwork loaded;
+    const bool network_loaded = loaded.Load(network_path);
+    fatpup::MinimaxEngine engine;
+    const bool option_set = engine.SetOption("EvalFile", network_path);
+    std::remove(network_path);
+
+    fatpup::NnueNetwork::Accumulator acc;
+    fatpup::NnueNetwork::Accumulator loaded_acc;
+    network.Refresh(initial_pos, &acc);
+    loaded.Refresh(initial_pos, &loaded_acc);
+    if (!network_loaded || !option_set || std::memcmp(&acc, &loaded_acc, sizeof(acc)) != 0 ||
+        network.Evaluate(acc, true) != loaded.Evaluate(loaded_acc, true))
+    {
+        std::cout << errorMsgColor << "Error! The network read back doesn't match the saved one" << rang::fg::reset << std::endl;
+        return false;
+    }
+
+    // neither a truncated file nor a missing one is a network
+    {
+        std::ofstream bad_file(network_path, std::ios::binary);
+        bad_file << "FPNN";
+    }
+    const bool bad_loaded = loaded.Load(network_path) || engine.SetOption("EvalFile", network_path);
+    std::remove(network_path);
+    if (bad_loaded || loaded.Load(network_path))
+    {
+        std::cout << errorMsgColor << "Error! A broken network file was accepted" << rang::fg::reset << std::endl;
+        return false;
+    }
+
+    // no "nnue" engine without its network
+    if (!std::ifstream(fatpup::NnueNetwork::defaultFile))
+    {
+        std::unique_ptr<fatpup::Engine> nnue_engine(fatpup::Engine::Create("nnue"));
+        if (nnue_engine)
+        {
+            std::cout << errorMsgColor << "Error! The nnue engine was created without " << fatpup::NnueNetwork::defaultFile <<
+                rang::fg::reset << std::endl;
+            return false;
+        }
+    }
+
+    // the engine searching with the network (the debug builds check every accumulator it uses)
+    fatpup::Position pos;
+    pos.setFEN("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4");
+    int eval = 0;
+    const fatpup::Move bestMove = engine.FindBestMove(pos, eval, 1, 4);
+    bool legal = false;
+    for (const auto move: pos.possibleMoves())
+        legal = legal || move == bestMove;
+    if (!legal)
+    {
+        std::cout << errorMsgColor << "Error! The NNUE search returned an illegal move" << rang::fg::reset << std::endl;
+        return false;
+    }
+    if (verbose)
+        std::cout << "NNUE search: " << pos.moveToStringPGN(bestMove) << " (" << eval << "), " << engine.GetNodeCount() << " nodes" << std::endl;
+
+    if (!engine.SetOption("EvalFile", "<empty>"))
+        return false;
+
+    std::cout << successMsgColor << "  Success, all NNUE tests passed!" << rang::fg::reset << std::endl;
+    return true;
+}
@@ -0,0 +1,7 @@
+#ifndef FATPUP_TEST_NNUE_TESTS_H
+#define FATPUP_TEST_NNUE_TESTS_H
+
+// NnueNetwork and the NNUE evaluation of MinimaxEngine tests
+bool runNnueTests(bool verbose = false);
+
+#endif  // FATPUP_TEST_NNUE_TESTS_H
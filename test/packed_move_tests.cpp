@@ -0,0 +1,78 @@
+#include <iostream>
+
+#include "fatpup/packed_move.h"
+#include "color_scheme.h"
+#include "utils.h"
+
+#include "packed_move_tests.h"
+
+static bool checkAllMoves(const fatpup::Position& pos)
+{
+    for (const auto move: pos.possibleMoves())
+    {
+        const fatpup::PackedMove packed(pos, move);
+        if (packed.toMove() != move || fatpup::PackedMove(move).toMove() != move)
+        {
+            std::cout << "Error! PackedMove round trip failed for " << pos.moveToString(move) << std::endl;
+            return false;
+        }
+
+        const bool castling = (move.fields.rook_src_col != move.fields.rook_dst_col);
+        const bool en_passant = pos.square(move.fields.dst_row, move.fields.dst_col).piece() == fatpup::Empty && pos.isMoveCapture(move);
+        if (castling != (packed.type() == fatpup::PackedMove::Castling) ||
+            en_passant != (packed.type() == fatpup::PackedMove::EnPassantCapture) ||
+            (int)move.fields.promoted_to != packed.promotedTo())
+        {
+            std::cout << "Error! Wrong PackedMove type for " << pos.moveToString(move) << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool runPackedMoveTests()
+{
+    std::cout << testTitleColor << "Packed Move Tests" << rang::fg::reset << std::endl;
+
+    static_assert(fatpup::PackedMove(fatpup::E2, fatpup::E4).dst() == fatpup::E4, "constexpr accessors");
+    static_assert(fatpup::PackedMove(fatpup::A7, fatpup::B8, fatpup::PackedMove::Promotion, fatpup::Queen).promotedTo() == fatpup::Queen, "constexpr accessors");
+
+    if (!fatpup::PackedMove(fatpup::Move()).isEmpty() || !fatpup::PackedMove().toMove().isEmpty())
+    {
+        std::cout << "Error! Empty move doesn't map to empty PackedMove" << std::endl;
+        return false;
+    }
+
+    // castlings both ways, promotions and en passant
+    static const char* fens[] =
+    {
+        "r3k2r/pppppppp/8/8/8/8/PPPPPPPP/R3K2R w KQkq - 0 1",
+        "r3k2r/pppppppp/8/8/8/8/PPPPPPPP/R3K2R b KQkq - 0 1",
+        "1n2k3/P7/8/3pP3/8/8/6p1/4K2N w - d6 0 1",
+        "1n2k3/P7/8/8/3pP3/8/6p1/4K2N b - e3 0 1"
+    };
+    for (const auto fen: fens)
+    {
+        fatpup::Position pos;
+        if (!pos.setFEN(fen) || !checkAllMoves(pos))
+            return false;
+    }
+
+    fatpup::Position initial_pos;
+    initial_pos.setInitial();
+    for (unsigned int seed = 1; seed <= 20; ++seed)
+    {
+        fatpup::Position pos = initial_pos;
+        for (const auto move: RandomGame(initial_pos, 200, seed))
+        {
+            if (!checkAllMoves(pos))
+                return false;
+            pos += move;
+        }
+    }
+
+    std::cout << successMsgColor << "  Success, all packed move tests passed!" << rang::fg::reset << std::endl;
+
+    return true;
+}
@@ -0,0 +1,7 @@
+#ifndef FATPUP_TEST_PACKED_MOVE_TESTS_H
+#define FATPUP_TEST_PACKED_MOVE_TESTS_H
+
+// PackedMove <-> Move conversion tests
+bool runPackedMoveTests();
+
+#endif  // FATPUP_TEST_PACKED_MOVE_TESTS_H
@@ -1,12 +1,15 @@
 #include <iostream>
+#include <sstream>
 #include <chrono>
 
+#include "fatpup/pgn_writer.h"
 #include "fatpup/position.h"
+#include "../engines/minimax.h"
 #include "solver.h"
+#include "utils.h"
 
 void runEvaluationPerformanceTests()
 {
-/*
     static constexpr int numPositions = 2;
     fatpup::Position positions[numPositions];
 
@@ -40,22 +43,56 @@ void runEvaluationPerformanceTests()
 
     positions[1].setWhiteTurn(false);
 
-    static constexpr int numLoops = 8 * 1000 * 1000;
-    float evalAcc = 0;
+    static constexpr int numLoops = 1000 * 1000;
+    int evalAcc = 0;
     auto start = std::chrono::system_clock::now();
     for (int i = 0; i < numLoops; ++i)
     {
-        evalAcc += positions[0].evaluate();
-        evalAcc -= positions[1].evaluate();
-        evalAcc -= positions[0].evaluate();
-        evalAcc += positions[1].evaluate();
+        evalAcc += fatpup::MinimaxEngine::Evaluate(positions[0]);
+        evalAcc -= fatpup::MinimaxEngine::Evaluate(positions[1]);
+        evalAcc -= fatpup::MinimaxEngine::Evaluate(positions[0]);
+        evalAcc += fatpup::MinimaxEngine::Evaluate(positions[1]);
     }
     auto finish = std::chrono::system_clock::now();
     auto executedIn = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start).count();
 
     std::cout << "Total evaluation time " << executedIn << " ms, check result: " << evalAcc <<
-    ", keps: " << (numLoops * 4 / executedIn) << std::endl;
-*/
+    ", keps: " << (numLoops * 4 / (executedIn ? executedIn : 1)) << std::endl;
+
+    // NNUE with a random network: from scratch, and updated by a move like the search does it
+    fatpup::NnueNetwork network;
+    network.Randomize(1);
+    fatpup::NnueNetwork::Accumulator acc;
+    evalAcc = 0;
+    start = std::chrono::system_clock::now();
+    for (int i = 0; i < numLoops; ++i)
+    {
+        network.Refresh(positions[i & 1], &acc);
+        evalAcc += network.Evaluate(acc, positions[i & 1].isWhiteTurn());
+    }
+    finish = std::chrono::system_clock::now();
+    executedIn = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start).count();
+    std::cout << "NNUE refresh evaluation time " << executedIn << " ms, check result: " << evalAcc <<
+    ", keps: " << (numLoops / (executedIn ? executedIn : 1)) << std::endl;
+
+    // the queen going back and forth d5-d8: two changed squares per move
+    const fatpup::SquareChange changes[2][2] =
+    {
+        { { fatpup::D5, fatpup::Queen | fatpup::Black, fatpup::Empty }, { fatpup::D8, fatpup::Empty, fatpup::Queen | fatpup::Black } },
+        { { fatpup::D8, fatpup::Queen | fatpup::Black, fatpup::Empty }, { fatpup::D5, fatpup::Empty, fatpup::Queen | fatpup::Black } }
+    };
+    network.Refresh(positions[1], &acc);
+    evalAcc = 0;
+    start = std::chrono::system_clock::now();
+    for (int i = 0; i < numLoops; ++i)
+    {
+        network.Update(acc, changes[i & 1], 2, &acc);
+        evalAcc += network.Evaluate(acc, (i & 1) != 0);
+    }
+    finish = std::chrono::system_clock::now();
+    executedIn = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start).count();
+    std::cout << "NNUE incremental evaluation time " << executedIn << " ms, check result: " << evalAcc <<
+    ", keps: " << (numLoops / (executedIn ? executedIn : 1)) << std::endl;
 }
 
 void runPossibleMovesPerformanceTests()
@@ -141,9 +178,75 @@ void runFindBestMoveTests()
             {
                 const fatpup::Move bestMove = solver->getBestMove();
                 std::cout << "[" << solverName << " solver] best move (" << (wb == 0 ? "white" : "black") << "): " << pos.moveToString(bestMove) << std::endl;
+                for (const auto& line: solver->getBestLines(3))
+                {
+                    std::cout << "    " << line.multipv << ". " << pos.moveToString(line.pv.front());
+                    if (line.mate)
+                        std::cout << " mate " << line.mate << std::endl;
+                    else
+                        std::cout << " cp " << line.score << std::endl;
+                }
 
                 delete solver;
             }
         }
     }
 }
+
+void runPgnWriterPerformanceTests()
+{
+    // synthetic corpus: random games, most of them are long enough to hit the ply limit
+    static constexpr int numGames = 500;
+    static constexpr int maxPlies = 160;
+
+    fatpup::Position startPos;
+    startPos.setInitial();
+
+    std::vector<std::vector<fatpup::Move>> games;
+    games.reserve(numGames);
+    for (int g = 0; g < numGames; ++g)
+        games.push_back(RandomGame(startPos, maxPlies, g + 1));
+
+    const std::vector<fatpup::PgnTag> tags = { { "Event", "fatpup benchmark" }, { "White", "random" }, { "Black", "random" }, { "Result", "*" } };
+
+    // the old way: moveToStringPGN() per move, concatenated into a string per game
+    std::ostringstream concatOut;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& game: games)
+    {
+        std::string pgn;
+        for (const auto& tag: tags)
+            pgn += "[" + tag.name + " \"" + tag.value + "\"]\n";
+        pgn += "\n";
+
+        fatpup::Position pos = startPos;
+        int moveNumber = 1;
+        for (const auto move: game)
+        {
+            if (pos.isWhiteTurn())
+                pgn += std::to_string(moveNumber) + ". ";
+            else
+                ++moveNumber;
+            pgn += pos.moveToStringPGN(move) + " ";
+            pos += move;
+        }
+        pgn += "*\n\n";
+        concatOut << pgn;
+    }
+    auto finish = std::chrono::steady_clock::now();
+    const auto concatMs = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start).count();
+
+    std::ostringstream writerOut;
+    start = std::chrono::steady_clock::now();
+    {
+        fatpup::PgnWriter writer(writerOut);
+        for (const auto& game: games)
+            writer.writeGame(tags, startPos, game);
+    }
+    finish = std::chrono::steady_clock::now();
+    const auto writerMs = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start).count();
+
+    std::cout << "PGN export of " << numGames << " games, moveToStringPGN: " << concatMs << " ms (" <<
+        (numGames * 1000LL / (concatMs ? concatMs : 1)) << " games/s), PgnWriter: " << writerMs << " ms (" <<
+        (numGames * 1000LL / (writerMs ? writerMs : 1)) << " games/s, " << writerOut.str().size() << " bytes)" << std::endl;
+}
@@ -4,5 +4,6 @@
 void runEvaluationPerformanceTests();
 void runPossibleMovesPerformanceTests();
 void runFindBestMoveTests();
+void runPgnWriterPerformanceTests();
 
 #endif  // FATPUP_CLI_PERFORMANCE_TESTS_H
@@ -1,7 +1,13 @@
 #include <iostream>
+#include <sstream>
 
+#include "fatpup/pgn_reader.h"
+#include "fatpup/pgn_writer.h"
 #include "fatpup/position.h"
 #include "color_scheme.h"
+#include "utils.h"
+
+#include "pgn_tests.h"
 
 static bool expectPgn(
     const std::string& fen,
@@ -111,5 +117,208 @@ bool runPgnTests()
         return false;
 
     std::cout << successMsgColor << "  Success, all PGN SAN tests passed!" << rang::fg::reset << std::endl;
+
+    return runPgnWriterTests();
+}
+
+bool runPgnWriterTests()
+{
+    std::cout << testTitleColor << "PGN Writer Tests" << rang::fg::reset << std::endl;
+
+    {
+        fatpup::Position pos;
+        pos.setInitial();
+
+        std::vector<fatpup::Move> moves;
+        fatpup::Position game_pos = pos;
+        for (const auto uci: { "e2e4", "e7e5", "g1f3", "b8c6", "f1b5", "a7a6", "b5c6", "d7c6", "e1g1", "f7f6" })
+        {
+            const std::string move_str = uci;
+            const auto candidates = game_pos.possibleMoves(fatpup::symbolToRowIdx(move_str[1]), fatpup::symbolToColumnIdx(move_str[0]),
+                                                           fatpup::symbolToRowIdx(move_str[3]), fatpup::symbolToColumnIdx(move_str[2]));
+            if (candidates.empty())
+            {
+                std::cout << "Error! Move not found in possibleMoves: " << move_str << std::endl;
+                return false;
+            }
+            moves.push_back(candidates[0]);
+            game_pos += candidates[0];
+        }
+
+        std::ostringstream out;
+        {
+            fatpup::PgnWriter writer(out);
+            writer.setLineLength(24);
+            writer.writeGame({ { "Event", "Ruy \"Lopez\"" }, { "Result", "*" } }, pos, moves);
+        }
+
+        const std::string expected =
+            "[Event \"Ruy \\\"Lopez\\\"\"]\n"
+            "[Result \"*\"]\n"
+            "\n"
+            "1. e4 e5 2. Nf3 Nc6 3.\n"
+            "Bb5 a6 4. Bxc6 dxc6 5.\n"
+            "O-O f6 *\n"
+            "\n";
+        if (out.str() != expected)
+        {
+            std::cout << "Error! PgnWriter output mismatch. Expected:\n" << expected << "got:\n" << out.str() << std::endl;
+            return false;
+        }
+    }
+
+    {
+        // black to move, no tags
+        fatpup::Position pos;
+        if (!pos.setFEN("4k3/8/8/8/8/8/8/R3K2R b KQ - 0 1"))
+            return false;
+
+        const auto moves = pos.possibleMoves(fatpup::ROW8, fatpup::COLE, fatpup::ROW8, fatpup::COLD);
+        if (moves.empty())
+            return false;
+
+        std::ostringstream out;
+        {
+            fatpup::PgnWriter writer(out);
+            writer.writeGame({}, pos, { moves[0] }, "1/2-1/2");
+        }
+        if (out.str() != "1... Kd8 1/2-1/2\n\n")
+        {
+            std::cout << "Error! PgnWriter output mismatch, got '" << out.str() << "'" << std::endl;
+            return false;
+        }
+    }
+
+    // SAN produced by the writer shall match moveToStringPGN() move by move
+    for (unsigned int seed = 1; seed <= 64; ++seed)
+    {
+        fatpup::Position pos;
+        pos.setInitial();
+        const auto moves = RandomGame(pos, 200, seed);
+
+        std::string expected_san;
+        for (const auto move: moves)
+        {
+            if (!expected_san.empty())
+                expected_san += ' ';
+            expected_san += pos.moveToStringPGN(move);
+            pos += move;
+        }
+
+        std::ostringstream out;
+        {
+            fatpup::PgnWriter writer(out);
+            writer.setLineLength(1 << 30);
+            pos.setInitial();
+            writer.writeGame({}, pos, moves);
+        }
+
+        // strip the move numbers and compare SAN only
+        std::istringstream tokens(out.str());
+        std::string token, san;
+        while (tokens >> token)
+        {
+            if (token.back() == '.' || token == "*")
+                continue;
+            if (!san.empty())
+                san += ' ';
+            san += token;
+        }
+
+        if (san != expected_san)
+        {
+            std::cout << "Error! PgnWriter SAN mismatch for random game " << seed << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << successMsgColor << "  Success, all PGN writer tests passed!" << rang::fg::reset << std::endl;
+    return runPgnReaderTests();
+}
+
+bool runPgnReaderTests()
+{
+    std::cout << testTitleColor << "PGN Reader Tests" << rang::fg::reset << std::endl;
+
+    std::vector<fatpup::PgnTag> tags;
+    fatpup::Position start_pos;
+    std::vector<fatpup::Move> moves;
+    std::string result;
+
+    {
+        // comments, variations, NAGs, glued move numbers, a game with no result and a broken one
+        std::istringstream in(
+            "% escaped line\n"
+            "[Event \"Ruy \\\"Lopez\\\"\"]\n"
+            "[Result \"1-0\"]\n"
+            "\n"
+            "1. e4 {best by test} e5 2.Nf3 (2. f4 exf4 (2... d5)) 2... Nc6 $1 3. Bb5!? ; line comment 3. d4\n"
+            "a6 1-0\n"
+            "\n"
+            "[FEN \"4k3/8/8/8/8/8/8/R3K2R b KQ - 0 1\"]\n"
+            "1... Kd8 2. O-O\n"
+            "[Event \"broken\"]\n"
+            "1. e4 e5 2. Ke3 Nc6 0-1\n");
+        fatpup::PgnReader reader(in);
+
+        if (!reader.readGame(&tags, &start_pos, &moves, &result) || tags.size() != 2 || tags[0].value != "Ruy \"Lopez\"" ||
+            result != "1-0" || moves.size() != 6 || start_pos.moveToStringPGN(moves[0]) != "e4")
+        {
+            std::cout << "Error! PgnReader failed on the first game" << std::endl;
+            return false;
+        }
+
+        fatpup::Position fen_pos;
+        fen_pos.setFEN("4k3/8/8/8/8/8/8/R3K2R b KQ - 0 1");
+        if (!reader.readGame(&tags, &start_pos, &moves, &result) || start_pos != fen_pos || !result.empty() || moves.size() != 2)
+        {
+            std::cout << "Error! PgnReader failed on the FEN game" << std::endl;
+            return false;
+        }
+
+        if (!reader.readGame(&tags, &start_pos, &moves, &result) || result != "0-1" || moves.size() != 2 || reader.errorCount() != 1)
+        {
+            std::cout << "Error! PgnReader failed on the broken game" << std::endl;
+            return false;
+        }
+
+        if (reader.readGame(&tags, &start_pos, &moves, &result) || reader.gameCount() != 3)
+        {
+            std::cout << "Error! PgnReader read past the end" << std::endl;
+            return false;
+        }
+    }
+
+    // whatever PgnWriter writes shall be read back as is
+    std::ostringstream out;
+    std::vector<std::vector<fatpup::Move>> games;
+    {
+        fatpup::PgnWriter writer(out);
+        for (unsigned int seed = 1; seed <= 64; ++seed)
+        {
+            fatpup::Position pos;
+            pos.setInitial();
+            games.push_back(RandomGame(pos, 200, seed));
+            writer.writeGame({ { "Event", "random" }, { "Round", std::to_string(seed) } }, pos, games.back(), "1/2-1/2");
+        }
+    }
+
+    std::istringstream in(out.str());
+    fatpup::PgnReader reader(in);
+    for (const auto& game: games)
+    {
+        if (!reader.readGame(&tags, &start_pos, &moves, &result) || moves != game || result != "1/2-1/2")
+        {
+            std::cout << "Error! PgnReader didn't read back what PgnWriter wrote" << std::endl;
+            return false;
+        }
+    }
+    if (reader.readGame(&tags, &start_pos, &moves, &result) || reader.errorCount() != 0)
+    {
+        std::cout << "Error! PgnReader round trip failed" << std::endl;
+        return false;
+    }
+
+    std::cout << successMsgColor << "  Success, all PGN reader tests passed!" << rang::fg::reset << std::endl;
     return true;
 }
@@ -2,5 +2,7 @@
 #define FATPUP_CLI_PGN_TESTS_H
 
 bool runPgnTests();
+bool runPgnWriterTests();
+bool runPgnReaderTests();
 
 #endif  // FATPUP_CLI_PGN_TESTS_H
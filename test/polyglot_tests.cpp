@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "fatpup/polyglot.h"
+#include "color_scheme.h"
+#include "utils.h"
+
+#include "polyglot_tests.h"
+
+static void appendEntry(std::vector<unsigned char>* book, unsigned long long key, unsigned short move, unsigned short weight)
+{
+    for (int b = 7; b >= 0; --b)
+        book->push_back((unsigned char)(key >> (b * 8)));
+    book->push_back((unsigned char)(move >> 8));
+    book->push_back((unsigned char)move);
+    book->push_back((unsigned char)(weight >> 8));
+    book->push_back((unsigned char)weight);
+    for (int b = 0; b < 4; ++b)
+        book->push_back(0);
+}
+
+static unsigned short polyglotMove(const char* uci_move)
+{
+    return (unsigned short)((uci_move[0] - 'a') << 6 | (uci_move[1] - '1') << 9 | (uci_move[2] - 'a') | (uci_move[3] - '1') << 3);
+}
+
+bool runPolyglotTests()
+{
+    std::cout << testTitleColor << "Polyglot Tests" << rang::fg::reset << std::endl;
+
+    // test vectors from the Polyglot book format description
+    struct KeyTest
+    {
+        const char* moves[7];
+        unsigned long long key;
+    };
+    static const KeyTest keyTests[] =
+    {
+        { { nullptr }, 0x463b96181691fc9cULL },
+        { { "e2e4", nullptr }, 0x823c9b50fd114196ULL },
+        { { "e2e4", "d7d5", nullptr }, 0x0756b94461c50fb0ULL },
+        { { "e2e4", "d7d5", "e4e5", nullptr }, 0x662fafb965db29d4ULL },
+        { { "e2e4", "d7d5", "e4e5", "f7f5", nullptr }, 0x22a48b5a8e47ff78ULL },
+        { { "e2e4", "d7d5", "e4e5", "f7f5", "e1e2", nullptr }, 0x652a607ca3f242c1ULL },
+        { { "e2e4", "d7d5", "e4e5", "f7f5", "e1e2", "e8f7", nullptr }, 0x00fdd303c946bdd9ULL },
+        { { "a2a4", "b7b5", "h2h4", "b5b4", "c2c4", nullptr }, 0x3c8123ea7b067637ULL },
+        { { "a2a4", "b7b5", "h2h4", "b5b4", "c2c4", "b4c3", "a1a3" }, 0x5c3f9b829b279560ULL }
+    };
+
+    for (const auto& test: keyTests)
+    {
+        fatpup::Position pos;
+        pos.setInitial();
+        for (int m = 0; m < 7 && test.moves[m]; ++m)
+            pos += fatpup::Move(test.moves[m]);
+
+        if (fatpup::polyglotKey(pos) != test.key)
+        {
+            std::cout << "Error! Wrong Polyglot key: " << std::hex << fatpup::polyglotKey(pos) << " instead of " << test.key << std::dec << std::endl;
+            return false;
+        }
+    }
+
+    fatpup::Position initial_pos;
+    initial_pos.setInitial();
+
+    // the incremental key must match the full one after every move (and every alternative
+    // to it) of random games, they have plenty of captures, promotions, castlings and en passants
+    for (unsigned int seed = 1; seed <= 20; ++seed)
+    {
+        fatpup::Position pos = initial_pos;
+        unsigned long long key = fatpup::polyglotKey(pos);
+        for (const auto move: RandomGame(initial_pos, 300, seed))
+        {
+            for (const auto alternative: pos.possibleMoves())
+            {
+                const fatpup::Position new_pos(pos, alternative);
+                if (fatpup::polyglotKeyAfterMove(pos, key, alternative, new_pos) != fatpup::polyglotKey(new_pos))
+                {
+                    std::cout << "Error! Incremental Polyglot key mismatch after " << pos.moveToStringPGN(alternative) << " in random game " << seed << std::endl;
+                    return false;
+                }
+            }
+
+            const fatpup::Position new_pos(pos, move);
+            key = fatpup::polyglotKeyAfterMove(pos, key, move, new_pos);
+            pos = new_pos;
+        }
+    }
+
+    // the pawn key only depends on the pawns
+    {
+        fatpup::Position pos;
+        fatpup::Position other_pieces_pos;
+        fatpup::Position other_pawns_pos;
+        pos.setFEN("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4");
+        other_pieces_pos.setFEN("4k3/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/4K3 b - - 0 1");
+        other_pawns_pos.setFEN("r1bqkb1r/pppp1ppp/2n2n2/4p3/2BPP3/5N2/PPP2PPP/RNBQK2R b KQkq - 0 4");
+        if (fatpup::polyglotPawnKey(pos) != fatpup::polyglotPawnKey(other_pieces_pos) ||
+            fatpup::polyglotPawnKey(pos) == fatpup::polyglotPawnKey(other_pawns_pos))
+        {
+            std::cout << "Error! Wrong Polyglot pawn key" << std::endl;
+            return false;
+        }
+    }
+
+    fatpup::Position castling_pos;
+    castling_pos.setFEN("r3k2r/pppppppp/8/8/8/8/PPPPPPPP/R3K2R w KQkq - 0 1");
+
+    // entries sorted by key, the initial position has two weighted moves and an illegal one
+    std::vector<std::pair<unsigned long long, std::vector<std::pair<unsigned short, unsigned short>>>> positions =
+    {
+        { fatpup::polyglotKey(initial_pos), { { polyglotMove("e2e4"), 3 }, { polyglotMove("d2d4"), 1 }, { polyglotMove("e2e5"), 100 } } },
+        { fatpup::polyglotKey(castling_pos), { { polyglotMove("e1h1"), 1 }, { polyglotMove("e1a1"), 1 } } },
+        { 1, { { polyglotMove("a2a3"), 1 } } },
+        { ~0ULL, { { polyglotMove("a2a3"), 1 } } }
+    };
+    std::sort(positions.begin(), positions.end());
+
+    std::vector<unsigned char> image;
+    for (const auto& position: positions)
+    {
+        for (const auto& entry: position.second)
+            appendEntry(&image, position.first, entry.first, entry.second);
+    }
+
+    const char* book_path = "fatpup_test_book.bin";
+    {
+        std::ofstream book_file(book_path, std::ios::binary);
+        book_file.write((const char*)image.data(), (std::streamsize)image.size());
+    }
+
+    fatpup::PolyglotBook book;
+    const bool opened = book.open(book_path);
+    std::remove(book_path);     // fine with the file mapped
+    if (!opened || book.entryCount() != image.size() / fatpup::PolyglotBook::entrySize)
+    {
+        std::cout << "Error! Couldn't open the book" << std::endl;
+        return false;
+    }
+
+    const auto initial_moves = book.findMoves(initial_pos);
+    if (initial_moves.size() != 2 || initial_moves[0].move != fatpup::Move("e2e4") || initial_moves[0].weight != 3 ||
+        initial_moves[1].move != fatpup::Move("d2d4"))
+    {
+        std::cout << "Error! Wrong book moves for the initial position" << std::endl;
+        return false;
+    }
+
+    int e4_count = 0;
+    for (unsigned int random = 0; random < 400; ++random)
+    {
+        if (book.pickMove(initial_pos, random) == fatpup::Move("e2e4"))
+            ++e4_count;
+    }
+    if (e4_count != 300)
+    {
+        std::cout << "Error! Book move weights are not respected" << std::endl;
+        return false;
+    }
+
+    const auto castlings = book.findMoves(castling_pos);
+    if (castlings.size() != 2 || castling_pos.moveToStringPGN(castlings[0].move) != "O-O" ||
+        castling_pos.moveToStringPGN(castlings[1].move) != "O-O-O")
+    {
+        std::cout << "Error! Book castlings not decoded" << std::endl;
+        return false;
+    }
+
+    fatpup::Position out_of_book = initial_pos;
+    out_of_book += fatpup::Move("g1f3");
+    if (!book.pickMove(out_of_book, 0).isEmpty())
+    {
+        std::cout << "Error! Move found for a position not in the book" << std::endl;
+        return false;
+    }
+
+    // builder: two threads' worth of games merged, then written and read back
+    {
+        fatpup::PolyglotBookBuilder builders[2];
+        builders[0].addGame(initial_pos, { fatpup::Move("e2e4"), fatpup::Move("e7e5") }, 20, 2, 0);
+        builders[1].addGame(initial_pos, { fatpup::Move("d2d4"), fatpup::Move("d7d5") }, 20, 1, 1);
+        builders[1].addGame(initial_pos, { fatpup::Move("e2e4"), fatpup::Move("c7c5") }, 1, 1, 1);
+        builders[1].addGame(castling_pos, { castling_pos.moveFromStringPGN("O-O-O") }, 20, 5, 5);
+        builders[0].merge(builders[1]);
+
+        std::ostringstream built;
+        if (!builders[0].write(built))
+        {
+            std::cout << "Error! Book builder failed" << std::endl;
+            return false;
+        }
+
+        // e7e5 has zero weight and is dropped, c7c5 is past the ply limit
+        const std::string image_str = built.str();
+        if (image_str.size() != 4 * fatpup::PolyglotBook::entrySize)
+        {
+            std::cout << "Error! Wrong number of built book entries" << std::endl;
+            return false;
+        }
+
+        {
+            std::ofstream book_file(book_path, std::ios::binary);
+            book_file.write(image_str.data(), (std::streamsize)image_str.size());
+        }
+        const bool built_opened = book.open(book_path);
+        std::remove(book_path);
+
+        const auto built_moves = book.findMoves(initial_pos);
+        const auto built_castling = book.findMoves(castling_pos);
+        if (!built_opened || built_moves.size() != 2 || built_moves[0].move != fatpup::Move("e2e4") || built_moves[0].weight != 3 ||
+            built_moves[1].move != fatpup::Move("d2d4") || built_moves[1].weight != 1 ||
+            built_castling.size() != 1 || castling_pos.moveToStringPGN(built_castling[0].move) != "O-O-O")
+        {
+            std::cout << "Error! Built book doesn't match the games" << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << successMsgColor << "  Success, all Polyglot tests passed!" << rang::fg::reset << std::endl;
+
+    return true;
+}
@@ -0,0 +1,7 @@
+#ifndef FATPUP_TEST_POLYGLOT_TESTS_H
+#define FATPUP_TEST_POLYGLOT_TESTS_H
+
+// Polyglot key and opening book tests
+bool runPolyglotTests();
+
+#endif  // FATPUP_TEST_POLYGLOT_TESTS_H
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <sstream>
+
+#include "fatpup/polyglot.h"
+#include "fatpup/position_index.h"
+#include "color_scheme.h"
+#include "utils.h"
+
+#include "position_index_tests.h"
+
+bool runPositionIndexTests(bool verbose)
+{
+    std::cout << testTitleColor << "Position Index Tests" << rang::fg::reset << std::endl;
+
+    fatpup::Position initial_pos;
+    initial_pos.setInitial();
+
+    // the games go through an archive, like they would in real life
+    static constexpr int numGames = 60;
+    std::vector<std::vector<fatpup::Move>> games;
+    std::ostringstream archive_out;
+    {
+        fatpup::GameArchiveWriter writer(archive_out);
+        for (int g = 0; g < numGames; ++g)
+        {
+            // a few short games, so that some positions repeat across the games
+            games.push_back(RandomGame(initial_pos, (g % 3) ? 120 : 4, g % 40 + 1));
+            writer.addGame(initial_pos, games.back());
+        }
+    }
+
+    const std::string archive_image = archive_out.str();
+    fatpup::GameArchiveReader archive;
+    fatpup::PositionIndexBuilder builder;
+    if (!archive.open((const unsigned char*)archive_image.data(), archive_image.size()) || !builder.addArchive(archive, 1000))
+    {
+        std::cout << "Error! Couldn't index the archive" << std::endl;
+        return false;
+    }
+
+    std::ostringstream index_out;
+    const size_t entry_count = builder.entryCount();
+    if (!builder.write(index_out))
+        return false;
+
+    const std::string index_image = index_out.str();
+    fatpup::PositionIndexReader index;
+    if (!index.open((const unsigned char*)index_image.data(), index_image.size()) || index.entryCount() != entry_count)
+    {
+        std::cout << "Error! Couldn't open the position index" << std::endl;
+        return false;
+    }
+
+    if (verbose)
+        std::cout << entry_count << " positions, " << index_image.size() << " bytes (" << (double)index_image.size() / entry_count << " per position)" << std::endl;
+
+    // every position of every game must be found along with all its other occurrences
+    for (int g = 0; g < numGames; g += 7)
+    {
+        fatpup::Position pos = initial_pos;
+        for (size_t ply = 0; ply <= games[g].size(); ++ply)
+        {
+            const unsigned long long key = fatpup::polyglotKey(pos);
+
+            std::vector<fatpup::PositionIndexEntry> expected;
+            for (int other = 0; other < numGames; ++other)
+            {
+                fatpup::Position other_pos = initial_pos;
+                for (size_t other_ply = 0; other_ply <= games[other].size(); ++other_ply)
+                {
+                    if (fatpup::polyglotKey(other_pos) == key)
+                        expected.push_back(fatpup::PositionIndexEntry{key, 1000u + other, (unsigned int)other_ply});
+                    if (other_ply < games[other].size())
+                        other_pos += games[other][other_ply];
+                }
+            }
+
+            const auto found = index.find(pos);
+            bool same = (found.size() == expected.size());
+            for (size_t e = 0; same && e < found.size(); ++e)
+                same = found[e].key == key && found[e].game_id == expected[e].game_id && found[e].ply == expected[e].ply;
+            if (!same)
+            {
+                std::cout << "Error! Wrong occurrences for ply " << ply << " of game " << g << std::endl;
+                return false;
+            }
+
+            if (ply < games[g].size())
+                pos += games[g][ply];
+        }
+    }
+
+    if (index.find(initial_pos).size() < (size_t)numGames || !index.find(0x0123456789abcdefULL).empty())
+    {
+        std::cout << "Error! Position index query failed" << std::endl;
+        return false;
+    }
+
+    // truncated or damaged images shall be rejected
+    if (index.open((const unsigned char*)index_image.data(), index_image.size() - 1) ||
+        index.open((const unsigned char*)archive_image.data(), archive_image.size()))
+    {
+        std::cout << "Error! Invalid position index accepted" << std::endl;
+        return false;
+    }
+
+    std::cout << successMsgColor << "  Success, all position index tests passed!" << rang::fg::reset << std::endl;
+
+    return true;
+}
@@ -0,0 +1,7 @@
+#ifndef FATPUP_TEST_POSITION_INDEX_TESTS_H
+#define FATPUP_TEST_POSITION_INDEX_TESTS_H
+
+// position index build/query tests
+bool runPositionIndexTests(bool verbose = false);
+
+#endif  // FATPUP_TEST_POSITION_INDEX_TESTS_H
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 
 #include "fatpup/position.h"
@@ -39,6 +40,12 @@ bool runPossibleMovesTests(bool verbose)
     if (!runStalemateTests(verbose))
         return false;
 
+    if (!runPossibleCapturesTests(verbose))
+        return false;
+
+    if (!runPossibleChecksTests(verbose))
+        return false;
+
     std::cout << successMsgColor << "  Success, all move tests passed!" << rang::fg::reset << std::endl;
 
     return true;
@@ -1368,3 +1375,108 @@ bool runStalemateTests(bool verbose)
 
     return true;
 }
+
+bool runPossibleCapturesTests(bool verbose)
+{
+    std::cout << testTitleColor << "Possible Captures Test" << rang::fg::reset << std::endl;
+
+    // possibleCaptures() must be exactly the captures of possibleMoves(), order aside
+    fatpup::Position initial_pos;
+    initial_pos.setInitial();
+    size_t totalCaptures = 0;
+    for (unsigned int seed = 1; seed <= 50; ++seed)
+    {
+        fatpup::Position pos = initial_pos;
+        for (const auto move: RandomGame(initial_pos, 300, seed))
+        {
+            std::vector<fatpup::Move> expected;
+            for (const auto candidate: pos.possibleMoves())
+            {
+                if (pos.isMoveCapture(candidate))
+                    expected.push_back(candidate);
+            }
+
+            const auto captures = pos.possibleCaptures();
+            bool same = (captures.size() == expected.size());
+            for (size_t c = 0; same && c < captures.size(); ++c)
+                same = (std::find(expected.begin(), expected.end(), captures[c]) != expected.end());
+            if (!same)
+            {
+                std::cout << "Error! possibleCaptures() mismatch in random game " << seed << ": " << captures.size() <<
+                    " captures instead of " << expected.size() << std::endl;
+                return false;
+            }
+
+            totalCaptures += captures.size();
+            pos += move;
+        }
+    }
+
+    if (verbose)
+        std::cout << totalCaptures << " captures checked" << std::endl;
+
+    return true;
+}
+
+bool runPossibleChecksTests(bool verbose)
+{
+    std::cout << testTitleColor << "Possible Checks Test" << rang::fg::reset << std::endl;
+
+    // possibleChecks() must be exactly the checking moves of possibleMoves(), order aside. Castling,
+    // en passant (a discovered check), promotion and discovered checks first, then random games
+    static const char* fens[] =
+    {
+        "5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+        "8/8/8/k1pP3R/8/8/8/4K3 w - c6 0 1",
+        "3k4/1P6/8/8/8/8/8/4K3 w - - 0 1",
+        "7k/8/8/8/3N4/8/1B6/4K3 w - - 0 1"
+    };
+    std::vector<fatpup::Position> positions;
+    for (const auto fen: fens)
+    {
+        fatpup::Position pos;
+        pos.setFEN(fen);
+        positions.push_back(pos);
+    }
+    fatpup::Position initial_pos;
+    initial_pos.setInitial();
+    for (unsigned int seed = 1; seed <= 50; ++seed)
+    {
+        fatpup::Position pos = initial_pos;
+        for (const auto move: RandomGame(initial_pos, 300, seed))
+        {
+            positions.push_back(pos);
+            pos += move;
+        }
+    }
+
+    size_t totalChecks = 0;
+    for (size_t p = 0; p < positions.size(); ++p)
+    {
+        const fatpup::Position& pos = positions[p];
+        std::vector<fatpup::Move> expected;
+        for (const auto candidate: pos.possibleMoves())
+        {
+            if (fatpup::Position(pos, candidate).isCheck())
+                expected.push_back(candidate);
+        }
+
+        const auto checks = pos.possibleChecks();
+        bool same = (checks.size() == expected.size());
+        for (size_t c = 0; same && c < checks.size(); ++c)
+            same = (std::find(expected.begin(), expected.end(), checks[c]) != expected.end());
+        if (!same || (p < sizeof(fens) / sizeof(fens[0]) && checks.empty()))
+        {
+            std::cout << "Error! possibleChecks() mismatch in position " << p << ": " << checks.size() <<
+                " checks instead of " << expected.size() << std::endl;
+            return false;
+        }
+
+        totalChecks += checks.size();
+    }
+
+    if (verbose)
+        std::cout << totalChecks << " checks checked" << std::endl;
+
+    return true;
+}
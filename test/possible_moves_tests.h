@@ -14,5 +14,7 @@ bool runPossibleCastlingMovesTests(bool verbose = false);
 bool runCheckTests(bool verbose = false);
 bool runCheckmateTests(bool verbose = false);
 bool runStalemateTests(bool verbose = false);
+bool runPossibleCapturesTests(bool verbose = false);
+bool runPossibleChecksTests(bool verbose = false);
 
 #endif  // FATPUP_CLI_POSSIBLE_MOVES_TESTS_H
@@ -0,0 +1,54 @@
+#include <iostream>
+
+#include "fatpup/position.h"
+#include "color_scheme.h"
+
+#include "see_tests.h"
+
+bool runSeeTests()
+{
+    std::cout << testTitleColor << "Static Exchange Tests" << rang::fg::reset << std::endl;
+
+    struct SeeTest
+    {
+        const char* fen;
+        const char* move;
+        int see;
+    };
+
+    static const SeeTest tests[] =
+    {
+        { "4k3/8/8/3p4/4P3/8/8/4K3 w - - 0 1", "exd5", 1 },                // free pawn
+        { "4k3/8/2p5/3p4/4P3/8/8/4K3 w - - 0 1", "exd5", 0 },              // pawn for pawn
+        { "4k3/8/2p5/3p4/8/4N3/8/4K3 w - - 0 1", "Nxd5", -2 },             // knight for pawn
+        { "4k3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1", "Rxd5", 1 },             // the second rook behind the first one
+        { "3rk3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1", "Rxd5", -4 },           // one defender too many
+        { "4k3/8/8/3p4/8/8/8/2Q1K3 w - - 0 1", "Qc4", -9 },                // quiet move to an attacked square
+        { "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "exd6", 1 },                // en passant
+        { "1r2k3/P7/8/8/8/8/8/4K3 w - - 0 1", "axb8=Q", 13 },              // capturing promotion
+        { "4k3/4p3/8/8/8/8/8/4QK2 w - - 0 1", "Qxe7", -8 },                // the king defends
+        { "4k3/8/8/3q4/4P3/8/8/4K3 b - - 0 1", "Qxe4", 1 },                // black's point of view
+        { "4k3/8/5n2/3q4/4P3/3P4/8/4K3 b - - 0 1", "Qxe4", -7 }           // the queen is lost, the pawn won back
+    };
+
+    for (const auto& test: tests)
+    {
+        fatpup::Position pos;
+        if (!pos.setFEN(test.fen))
+        {
+            std::cout << errorMsgColor << "Error! Couldn't parse " << test.fen << rang::fg::reset << std::endl;
+            return false;
+        }
+
+        const fatpup::Move move = pos.moveFromStringPGN(test.move);
+        if (move.isEmpty() || pos.see(move) != test.see)
+        {
+            std::cout << errorMsgColor << "Error! SEE of " << test.move << " in " << test.fen << " is " <<
+                (move.isEmpty() ? 0 : pos.see(move)) << " instead of " << test.see << rang::fg::reset << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << successMsgColor << "  Success, all static exchange tests passed!" << rang::fg::reset << std::endl;
+    return true;
+}
@@ -0,0 +1,7 @@
+#ifndef FATPUP_TEST_SEE_TESTS_H
+#define FATPUP_TEST_SEE_TESTS_H
+
+// Position::see() tests
+bool runSeeTests();
+
+#endif  // FATPUP_TEST_SEE_TESTS_H
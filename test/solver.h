@@ -2,7 +2,9 @@
 #define FATPUP_CLI_SOLVER_H
 
 #include <string>
+#include <vector>
 
+#include "fatpup/engine.h"
 #include "fatpup/position.h"
 
 class Solver
@@ -18,7 +20,8 @@ public:
     virtual fatpup::Move getBestMove() = 0;
     virtual void moveDone(fatpup::Move move) = 0;
 
-    // to-do: analysis/kibitzing mode API (return best lines with evaluations)
+    // analysis/kibitzing: up to num_lines best lines with their evaluations, best first
+    virtual std::vector<fatpup::SearchInfo> getBestLines(int num_lines) = 0;
 };
 
 #endif // FATPUP_CLI_SOLVER_H
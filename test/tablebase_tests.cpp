@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include "fatpup/tablebase.h"
+#include "../engines/minimax.h"
+#include "../engines/parallel.h"
+#include "color_scheme.h"
+#include "utils.h"
+
+#include "tablebase_tests.h"
+
+struct TableTest
+{
+    const char* material;
+    int longest_mate;       // in plies
+};
+
+// in the order they're generated: the pawn tables need the tables of the promotions, so KPvKP,
+// where en passant captures are possible, takes all the 4-piece tables of a piece each side
+static const TableTest tableTests[] =
+{
+    { "KQvK", 20 },
+    { "KRvK", 32 },
+    { "KBvK", 0 },
+    { "KNvK", 0 },
+    { "KPvK", 56 },
+    { "KQvKQ", 25 },
+    { "KQvKR", 70 },
+    { "KQvKB", 34 },
+    { "KQvKN", 42 },
+    { "KRvKR", 38 },
+    { "KRvKB", 58 },
+    { "KRvKN", 80 },
+    { "KBvKB", 1 },
+    { "KBvKN", 1 },
+    { "KNvKN", 1 },
+    { "KQvKP", 57 },
+    { "KRvKP", 85 },
+    { "KBvKP", 57 },
+    { "KNvKP", 57 },
+    { "KPvKP", 66 }
+};
+
+struct ProbeTest
+{
+    const char* fen;
+    bool probed;
+    int wdl;
+    int distance;
+};
+
+static const ProbeTest probeTests[] =
+{
+    { "7k/8/6K1/8/8/8/8/1Q6 w - - 0 1", true, 1, 1 },            // Qb8#
+    { "7K/8/6k1/8/8/8/8/1q6 b - - 0 1", true, 1, 1 },            // the same with the colors flipped
+    { "Q6k/8/6K1/8/8/8/8/8 b - - 0 1", true, -1, 0 },            // checkmated
+    { "3k4/3P4/3K4/8/8/8/8/8 b - - 0 1", true, 0, 0 },           // stalemate
+    { "8/8/8/4k3/8/8/8/4K3 w - - 0 1", true, 0, 0 },             // the kings alone
+    { "8/8/8/8/8/8/8/KBk5 w - - 0 1", true, 0, 0 },              // no mate with a bishop
+    { "8/8/8/8/2k5/8/1p6/1K6 w - - 0 1", true, 0, 0 },           // Kxb2
+    { "8/8/8/8/3pP3/8/8/k1K5 b - e3 0 1", true, 0, 0 },          // dxe3 e.p. draws
+    { "7K/8/8/8/3p4/8/2Pk4/8 w - - 0 1", true, -1, 24 },         // lost, c4 is answered by dxc3 e.p.
+    { "4k3/8/8/8/8/8/8/R3K3 w Q - 0 1", false, 0, 0 },           // castling rights
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", false, 0, 0 }
+};
+
+// a random legal position of the table's material with the stronger side as white or black
+static void randomPosition(const char* material, bool flipped, std::mt19937& rng, fatpup::Position* pos)
+{
+    for (;;)
+    {
+        pos->setEmpty();
+        bool white = !flipped;
+        bool placed = true;
+        for (const char* c = material; *c && placed; ++c)
+        {
+            if (*c == 'v')
+            {
+                white = flipped;
+                continue;
+            }
+
+            const unsigned char piece = (*c == 'K') ? fatpup::King : (*c == 'Q') ? fatpup::Queen : (*c == 'R') ? fatpup::Rook :
+                                        (*c == 'B') ? fatpup::Bishop : (*c == 'N') ? fatpup::Knight : fatpup::Pawn;
+            const int row = rng() % fatpup::BOARD_SIZE;
+            const int col = rng() % fatpup::BOARD_SIZE;
+            placed = pos->square(row, col).piece() == fatpup::Empty &&
+                     !(piece == fatpup::Pawn && (row == 0 || row == fatpup::BOARD_SIZE - 1));
+            pos->square(row, col) = piece | (white ? fatpup::White : fatpup::Black);
+        }
+        // the turn is a flag of a square, so it goes after the pieces
+        pos->setWhiteTurn((rng() & 1) != 0);
+
+        // the side that has just moved can't be in check
+        fatpup::Position other = *pos;
+        other.toggleTurn();
+        if (placed && !other.isCheck())
+            return;
+    }
+}
+
+// the position's value must be the best one its moves lead to, a ply further
+static bool checkConsistency(const fatpup::Tablebases& tablebases, const fatpup::Position& pos)
+{
+    int wdl = 0;
+    int distance = 0;
+    if (!tablebases.probe(pos, &wdl, &distance))
+        return false;
+
+    if (pos.possibleMoves().empty())
+        return pos.isCheck() ? (wdl == -1 && distance == 0) : (wdl == 0);
+
+    int best_wdl = 0;
+    int best_distance = 0;
+    const fatpup::Move best_move = tablebases.bestMove(pos, &best_wdl, &best_distance);
+    if (best_move.isEmpty() || best_wdl != wdl || best_distance != distance)
+        return false;
+
+    int next_wdl = 0;
+    int next_distance = 0;
+    return tablebases.probe(fatpup::Position(pos, best_move), &next_wdl, &next_distance) &&
+           next_wdl == -wdl && (wdl == 0 || next_distance == distance - 1);
+}
+
+static void removeTables()
+{
+    for (const auto& test: tableTests)
+        std::remove((std::string(test.material) + fatpup::Tablebases::fileExtension).c_str());
+}
+
+static bool runTablebaseChecks(bool verbose)
+{
+    // the tables are written to the current directory, the engine loads them from there
+    fatpup::Tablebases tablebases;
+    for (const auto& test: tableTests)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fatpup::TablebaseGenerator generator(tablebases);
+        const std::string path = std::string(test.material) + fatpup::Tablebases::fileExtension;
+        bool written = generator.generate(test.material, fatpup::DefaultThreadCount());
+        if (written)
+        {
+            std::ofstream out(path, std::ios::binary);
+            written = out && generator.write(out);
+        }
+        if (!written || !tablebases.add(path) || generator.longestMate() != test.longest_mate ||
+            (test.longest_mate == 0 && generator.winCount() != 0))
+        {
+            std::cout << errorMsgColor << "Error! " << test.material << " table: longest mate " << generator.longestMate() <<
+                " plies instead of " << test.longest_mate << rang::fg::reset << std::endl;
+            return false;
+        }
+
+        if (verbose)
+        {
+            const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "  " << test.material << ": " << generator.positionCount() << " positions, " << generator.winCount() <<
+                " won, longest mate " << generator.longestMate() << " plies, " << ms << " ms" << std::endl;
+        }
+    }
+
+    // a table whose subtables are missing, and names that are no table's
+    {
+        fatpup::TablebaseGenerator generator(tablebases);
+        if (generator.generate("KPPvK") || generator.generate("KvKQ") || generator.generate("KXvK") || generator.generate(""))
+        {
+            std::cout << errorMsgColor << "Error! A table was generated from a wrong name or without its subtables" << rang::fg::reset << std::endl;
+            return false;
+        }
+    }
+
+    for (const auto& test: probeTests)
+    {
+        fatpup::Position pos;
+        if (!pos.setFEN(test.fen))
+        {
+            std::cout << errorMsgColor << "Error! Couldn't parse " << test.fen << rang::fg::reset << std::endl;
+            return false;
+        }
+
+        int wdl = 0;
+        int distance = 0;
+        const bool probed = tablebases.probe(pos, &wdl, &distance);
+        if (probed != test.probed || (probed && (wdl != test.wdl || distance != test.distance)))
+        {
+            std::cout << errorMsgColor << "Error! Probing " << test.fen << " gave " << wdl << " in " << distance <<
+                " plies" << (probed ? "" : " (no table)") << rang::fg::reset << std::endl;
+            return false;
+        }
+    }
+
+    // random positions of every table, the stronger side either white or black
+    static constexpr int numPositions = 2000;
+    std::mt19937 rng(1);
+    for (const auto& test: tableTests)
+    {
+        for (int p = 0; p < numPositions; ++p)
+        {
+            fatpup::Position pos;
+            randomPosition(test.material, (p & 1) != 0, rng, &pos);
+            if (!checkConsistency(tablebases, pos))
+            {
+                std::cout << errorMsgColor << "Error! The value of this " << test.material << " position doesn't follow from its moves" <<
+                    rang::fg::reset << std::endl;
+                PrintPosition(pos);
+                return false;
+            }
+        }
+    }
+    if (verbose)
+        std::cout << "  " << numPositions * sizeof(tableTests) / sizeof(tableTests[0]) << " random positions consistent" << std::endl;
+
+    // the engine finds the only winning move at depth 1 and reports the mate from the tables
+    fatpup::MinimaxEngine engine;
+    if (engine.SetOption("TablebasePath", "fatpup_no_such_directory") || !engine.SetOption("TablebasePath", "."))
+    {
+        std::cout << errorMsgColor << "Error! TablebasePath option" << rang::fg::reset << std::endl;
+        return false;
+    }
+
+    fatpup::SearchInfo last_info;
+    engine.SetInfoCallback([&last_info](const fatpup::SearchInfo& info) { last_info = info; });
+    fatpup::SearchLimits limits;
+    limits.depth = 1;
+    engine.SetSearchLimits(limits);
+    fatpup::Position pos;
+    pos.setFEN("3k4/8/4K3/3P4/8/8/8/8 w - - 0 1");
+    engine.SetPosition(pos);
+    const fatpup::Move best_move = engine.GetBestMove();
+
+    fatpup::Position pv_pos = pos;
+    bool pv_legal = true;
+    for (const auto move: last_info.pv)
+    {
+        const auto moves = pv_pos.possibleMoves();
+        pv_legal = pv_legal && std::find(moves.begin(), moves.end(), move) != moves.end();
+        if (pv_legal)
+            pv_pos += move;
+    }
+    if (pos.moveToStringPGN(best_move) != "Kd6" || last_info.mate <= 0 || !pv_legal ||
+        pv_pos.getState() != fatpup::Position::State::Checkmate)
+    {
+        std::cout << errorMsgColor << "Error! The engine played " << pos.moveToStringPGN(best_move) << " (mate " << last_info.mate <<
+            ", " << last_info.pv.size() << " plies PV) with the tables" << rang::fg::reset << std::endl;
+        return false;
+    }
+    if (verbose)
+        std::cout << "  engine: " << pos.moveToStringPGN(best_move) << ", mate in " << last_info.mate << std::endl;
+
+    return engine.SetOption("TablebasePath", "<empty>");
+}
+
+bool runTablebaseTests(bool verbose)
+{
+    std::cout << testTitleColor << "Tablebase Tests" << rang::fg::reset << std::endl;
+
+    const bool passed = runTablebaseChecks(verbose);
+    removeTables();
+    if (!passed)
+        return false;
+
+    std::cout << successMsgColor << "  Success, all tablebase tests passed!" << rang::fg::reset << std::endl;
+    return true;
+}
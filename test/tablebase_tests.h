@@ -0,0 +1,7 @@
+#ifndef FATPUP_TEST_TABLEBASE_TESTS_H
+#define FATPUP_TEST_TABLEBASE_TESTS_H
+
+// generates the 3-piece tables and the ones KPvKP needs, and probes them, the verbose ones also time the generation
+bool runTablebaseTests(bool verbose = false);
+
+#endif  // FATPUP_TEST_TABLEBASE_TESTS_H
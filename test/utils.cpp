@@ -1,7 +1,7 @@
 #include <iostream>
 
 #include "color_scheme.h"
-#include "fatpup/position.h"
+#include "utils.h"
 
 void PrintPosition(const fatpup::Position& pos)
 {
@@ -37,4 +37,31 @@ void PrintPosition(const fatpup::Position& pos)
         std::cout << "\n";
     }
     std::cout << "  ABCDEFGH" << std::endl;
-}
\ No newline at end of file
+}
+
+std::vector<fatpup::Move> RandomGame(const fatpup::Position& pos, int max_plies, unsigned int seed)
+{
+    std::vector<fatpup::Move> game;
+    game.reserve(max_plies);
+
+    // xorshift32, std::uniform_int_distribution isn't the same on all platforms
+    unsigned int state = seed ? seed : 0x9e3779b9u;
+
+    fatpup::Position game_pos = pos;
+    for (int ply = 0; ply < max_plies; ++ply)
+    {
+        const auto moves = game_pos.possibleMoves();
+        if (moves.empty())
+            break;
+
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        const auto move = moves[state % moves.size()];
+        game.push_back(move);
+        game_pos += move;
+    }
+
+    return game;
+}
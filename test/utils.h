@@ -1,6 +1,14 @@
 #ifndef FATPUP_CLI_UTILS_H
 #define FATPUP_CLI_UTILS_H
 
+#include <vector>
+
+#include "fatpup/position.h"
+
 void PrintPosition(const fatpup::Position& pos);
 
+// plays random legal moves from pos until the game is over or max_plies is reached,
+// the same seed always gives the same game
+std::vector<fatpup::Move> RandomGame(const fatpup::Position& pos, int max_plies, unsigned int seed);
+
 #endif // FATPUP_CLI_UTILS_H